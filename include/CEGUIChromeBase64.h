@@ -0,0 +1,106 @@
+/***********************************************************************
+    filename:   CEGUIChromeBase64.h
+    created:    16/10/2026
+    author:     Martin Preisler
+*************************************************************************/
+/***************************************************************************
+ *   Copyright (C) 2011 Martin Preisler
+ *
+ *   Permission is hereby granted, free of charge, to any person obtaining
+ *   a copy of this software and associated documentation files (the
+ *   "Software"), to deal in the Software without restriction, including
+ *   without limitation the rights to use, copy, modify, merge, publish,
+ *   distribute, sublicense, and/or sell copies of the Software, and to
+ *   permit persons to whom the Software is furnished to do so, subject to
+ *   the following conditions:
+ *
+ *   The above copyright notice and this permission notice shall be
+ *   included in all copies or substantial portions of the Software.
+ *
+ *   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ *   EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ *   MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ *   IN NO EVENT SHALL THE AUTHORS BE LIABLE FOR ANY CLAIM, DAMAGES OR
+ *   OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+ *   ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ *   OTHER DEALINGS IN THE SOFTWARE.
+ ***************************************************************************/
+
+#ifndef _CEGUIChromeBase64_h_
+#define _CEGUIChromeBase64_h_
+
+#include "CEGUIChromePrerequisites.h"
+
+#include <atomic>
+
+namespace CEGUI
+{
+
+/*!
+\brief
+    Base64 encoder used to build data URIs
+
+\par
+    The output is written as bytes to a buffer of exactly ChromeBase64::getEncodedSize bytes, padding included.
+    There is a scalar reference implementation and vectorised implementations for SSSE3 and AVX2,
+    the best one the CPU supports is picked at runtime. All implementations give identical results.
+*/
+class CHROMED_CEGUI_API ChromeBase64
+{
+public:
+    //! instruction sets the encoder can be implemented with
+    enum InstructionSet
+    {
+        IS_Scalar, //!< plain C++, always available
+        IS_SSSE3,
+        IS_AVX2
+    };
+
+    //! retrieves how many bytes encoding given amount of bytes produces
+    static size_t getEncodedSize(size_t size);
+
+    /*!
+    \brief encodes given bytes using the best available implementation
+
+    \param destination
+        where to write the encoded bytes, has to have room for ChromeBase64::getEncodedSize(size) bytes,
+        no terminating zero is written
+    \param source
+        bytes to encode
+    \param size
+        how many bytes to encode
+    */
+    static void encode(char* destination, const uint8* source, size_t size);
+
+    /*!
+    \brief encodes given bytes using given instruction set
+
+    \return
+        false if there is no such implementation or the CPU doesn't support it, nothing is written then
+    */
+    static bool encode(char* destination, const uint8* source, size_t size, InstructionSet instructionSet);
+
+    //! checks whether the CPU we are running on supports given instruction set, \see ChromeCPUFeatures
+    static bool isInstructionSetSupported(InstructionSet instructionSet);
+
+    //! retrieves the instruction set used by default
+    static InstructionSet getInstructionSet();
+
+    /*!
+    \brief overrides the instruction set used by default
+
+    Falls back to the scalar implementation if the CPU doesn't support given instruction set.
+    */
+    static void setInstructionSet(InstructionSet instructionSet);
+
+private:
+    //! detects the best instruction set on the first call, may be called from any thread
+    static void ensureDetected();
+
+    //! instruction set used by default
+    static std::atomic<InstructionSet> ds_instructionSet;
+};
+
+}
+
+#endif
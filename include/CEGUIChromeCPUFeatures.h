@@ -0,0 +1,64 @@
+/***********************************************************************
+    filename:   CEGUIChromeCPUFeatures.h
+    created:    16/10/2026
+    author:     Martin Preisler
+*************************************************************************/
+/***************************************************************************
+ *   Copyright (C) 2011 Martin Preisler
+ *
+ *   Permission is hereby granted, free of charge, to any person obtaining
+ *   a copy of this software and associated documentation files (the
+ *   "Software"), to deal in the Software without restriction, including
+ *   without limitation the rights to use, copy, modify, merge, publish,
+ *   distribute, sublicense, and/or sell copies of the Software, and to
+ *   permit persons to whom the Software is furnished to do so, subject to
+ *   the following conditions:
+ *
+ *   The above copyright notice and this permission notice shall be
+ *   included in all copies or substantial portions of the Software.
+ *
+ *   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ *   EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ *   MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ *   IN NO EVENT SHALL THE AUTHORS BE LIABLE FOR ANY CLAIM, DAMAGES OR
+ *   OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+ *   ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ *   OTHER DEALINGS IN THE SOFTWARE.
+ ***************************************************************************/
+
+
+#ifndef _CEGUIChromeCPUFeatures_h_
+#define _CEGUIChromeCPUFeatures_h_
+
+#include "CEGUIChromePrerequisites.h"
+
+namespace CEGUI
+{
+
+/*!
+\brief
+    Tells which vector instruction sets the CPU we are running on supports
+
+\par
+    The CPU is only probed on the first call, the result is cached and can be read from any thread.
+    ChromePixelKernels and ChromeBase64 pick their implementations with this.
+*/
+class CHROMED_CEGUI_API ChromeCPUFeatures
+{
+public:
+    //! CPU features we can check for
+    enum Feature
+    {
+        CF_SSE2,
+        CF_SSSE3,
+        CF_AVX2, //!< only reported if the OS saves YMM registers too
+        CF_NEON
+    };
+
+    //! checks whether the CPU supports given feature
+    static bool isSupported(Feature feature);
+};
+
+}
+
+#endif
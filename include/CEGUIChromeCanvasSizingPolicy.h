@@ -0,0 +1,199 @@
+/***********************************************************************
+    filename:   CEGUIChromeCanvasSizingPolicy.h
+    created:    16/10/2026
+    author:     Martin Preisler
+*************************************************************************/
+/***************************************************************************
+ *   Copyright (C) 2011 Martin Preisler
+ *
+ *   Permission is hereby granted, free of charge, to any person obtaining
+ *   a copy of this software and associated documentation files (the
+ *   "Software"), to deal in the Software without restriction, including
+ *   without limitation the rights to use, copy, modify, merge, publish,
+ *   distribute, sublicense, and/or sell copies of the Software, and to
+ *   permit persons to whom the Software is furnished to do so, subject to
+ *   the following conditions:
+ *
+ *   The above copyright notice and this permission notice shall be
+ *   included in all copies or substantial portions of the Software.
+ *
+ *   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ *   EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ *   MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ *   IN NO EVENT SHALL THE AUTHORS BE LIABLE FOR ANY CLAIM, DAMAGES OR
+ *   OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+ *   ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ *   OTHER DEALINGS IN THE SOFTWARE.
+ ***************************************************************************/
+
+#ifndef _CEGUIChromeCanvasSizingPolicy_h_
+#define _CEGUIChromeCanvasSizingPolicy_h_
+
+#include "CEGUIChromePrerequisites.h"
+#include "CEGUISize.h"
+
+namespace CEGUI
+{
+
+/*!
+\brief
+    Decides how big the canvas texture of a Chrome widget should be and when to reallocate it
+
+\par
+    Canvas sizes are quantised to buckets, either multiples of a quantum or powers of two, so that
+    small size changes don't cause reallocations. Growing happens right away when the canvas doesn't
+    fit anymore. Shrinking only happens once the texture has been bigger than the shrink threshold allows
+    for the whole shrink delay.
+
+\par
+    Shrinking is always judged against the size the policy would allocate for the current canvas,
+    so a freshly allocated texture is never considered too big and no setting can make the policy
+    reallocate over and over.
+*/
+class CHROMED_CEGUI_API ChromeCanvasSizingPolicy :
+    public AllocatedObject<ChromeCanvasSizingPolicy>
+{
+public:
+    //! what should be done with the canvas texture
+    enum Decision
+    {
+        D_Keep, //!< the current texture is fine
+        D_Grow, //!< the canvas doesn't fit, a bigger texture is needed
+        D_Shrink //!< the texture has been too big for long enough, a smaller one should be used
+    };
+
+    /*!
+    \brief Constructor
+    */
+    ChromeCanvasSizingPolicy();
+
+    /*!
+    \brief sets the size quantum in pixels
+
+    \param pixels
+        Canvas sizes are rounded up to multiples of this. Defaults to 64, values smaller than 1 are treated as 1.
+    */
+    void setQuantum(uint pixels);
+
+    //! retrieves the size quantum in pixels
+    uint getQuantum() const;
+
+    /*!
+    \brief sets whether canvas sizes are rounded up to powers of two instead of multiples of the quantum
+
+    Powers of two waste more memory but make reallocations even less frequent. Disabled by default.
+    */
+    void setPowerOfTwoEnabled(bool enabled);
+
+    //! checks whether canvas sizes are rounded up to powers of two
+    bool isPowerOfTwoEnabled() const;
+
+    /*!
+    \brief sets how much extra space is allocated on top of the canvas size before quantising
+
+    \param ratio
+        If this is 0.1, 10% more than necessary is allocated. Defaults to 0.0, negative values are treated as 0.
+    */
+    void setGrowHeadroom(float ratio);
+
+    //! retrieves how much extra space is allocated on top of the canvas size
+    float getGrowHeadroom() const;
+
+    /*!
+    \brief sets how much bigger than the allocation size the texture may be before it's shrunk
+
+    \param ratio
+        If this is 0.25, the texture is shrunk once any of its sides is more than 25% bigger than what would
+        be allocated for the current canvas. Defaults to 0.25, negative values are treated as 0.
+    */
+    void setShrinkThreshold(float ratio);
+
+    //! retrieves the shrink threshold
+    float getShrinkThreshold() const;
+
+    /*!
+    \brief sets how long the texture has to stay too big before it's shrunk
+
+    \param seconds
+        Defaults to 1.0, negative values are treated as 0
+    */
+    void setShrinkDelay(float seconds);
+
+    //! retrieves the shrink delay in seconds
+    float getShrinkDelay() const;
+
+    /*!
+    \brief computes the texture size that would be allocated for given canvas size
+    */
+    Sizef getAllocationSize(const Sizef& canvasSize) const;
+
+    /*!
+    \brief computes the biggest texture size that isn't considered too big for given canvas size
+    */
+    Sizef getMaximumSize(const Sizef& canvasSize) const;
+
+    /*!
+    \brief decides what to do with the current texture for given canvas size
+
+    Counts the reallocation if the decision isn't D_Keep, the caller is expected to follow it.
+    */
+    Decision evaluate(const Sizef& canvasSize, const Sizef& textureSize);
+
+    /*!
+    \brief lets the policy know which texture was actually allocated
+
+    Renderers are free to give us bigger textures than we ask for. If shrinking can't give us a smaller
+    texture than the one we have, the policy doesn't ask for it.
+
+    \param requestedSize
+        the size that was asked for, usually ChromeCanvasSizingPolicy::getAllocationSize
+    \param textureSize
+        the size of the texture the renderer created
+    */
+    void notifyAllocated(const Sizef& requestedSize, const Sizef& textureSize);
+
+    /*!
+    \brief advances the shrink delay timer
+    */
+    void update(float elapsed);
+
+    /*!
+    \brief checks whether a pending shrink has waited long enough
+
+    When this returns true, the canvas should be evaluated again.
+    */
+    bool isShrinkDue() const;
+
+    //! retrieves how many times evaluate asked for a reallocation
+    size_t getReallocationCount() const;
+
+private:
+    //! rounds one side up to the bucket it belongs to
+    float quantise(float value) const;
+
+    //! \see ChromeCanvasSizingPolicy::setQuantum
+    uint d_quantum;
+    //! \see ChromeCanvasSizingPolicy::setPowerOfTwoEnabled
+    bool d_powerOfTwoEnabled;
+    //! \see ChromeCanvasSizingPolicy::setGrowHeadroom
+    float d_growHeadroom;
+    //! \see ChromeCanvasSizingPolicy::setShrinkThreshold
+    float d_shrinkThreshold;
+    //! \see ChromeCanvasSizingPolicy::setShrinkDelay
+    float d_shrinkDelay;
+
+    //! if true, the texture was too big the last time it was evaluated
+    bool d_shrinkPending;
+    //! for how long the texture has been too big
+    float d_shrinkTimer;
+    //! how many reallocations have been asked for
+    size_t d_reallocationCount;
+    //! size requested by the last allocation
+    Sizef d_lastRequestedSize;
+    //! size of the texture the last allocation got
+    Sizef d_lastTextureSize;
+};
+
+}
+
+#endif
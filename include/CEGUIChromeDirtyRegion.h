@@ -0,0 +1,136 @@
+/***********************************************************************
+    filename:   CEGUIChromeDirtyRegion.h
+    created:    16/10/2026
+    author:     Martin Preisler
+*************************************************************************/
+/***************************************************************************
+ *   Copyright (C) 2011 Martin Preisler
+ *
+ *   Permission is hereby granted, free of charge, to any person obtaining
+ *   a copy of this software and associated documentation files (the
+ *   "Software"), to deal in the Software without restriction, including
+ *   without limitation the rights to use, copy, modify, merge, publish,
+ *   distribute, sublicense, and/or sell copies of the Software, and to
+ *   permit persons to whom the Software is furnished to do so, subject to
+ *   the following conditions:
+ *
+ *   The above copyright notice and this permission notice shall be
+ *   included in all copies or substantial portions of the Software.
+ *
+ *   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ *   EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ *   MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ *   IN NO EVENT SHALL THE AUTHORS BE LIABLE FOR ANY CLAIM, DAMAGES OR
+ *   OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+ *   ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ *   OTHER DEALINGS IN THE SOFTWARE.
+ ***************************************************************************/
+
+#ifndef _CEGUIChromeDirtyRegion_h_
+#define _CEGUIChromeDirtyRegion_h_
+
+#include "CEGUIChromePrerequisites.h"
+#include "CEGUIRect.h"
+#include "CEGUISize.h"
+
+#include <vector>
+
+namespace CEGUI
+{
+
+/*!
+\brief
+    Accumulates dirty rectangles of a canvas and merges them to as few rectangles as possible
+
+\par
+    Two rectangles are merged into their union when uploading the union costs no more pixels
+    than uploading both of them separately. Once the dirty rectangles cover more than the
+    coverage threshold of the canvas, the whole canvas is considered dirty.
+*/
+class CHROMED_CEGUI_API ChromeDirtyRegion :
+    public AllocatedObject<ChromeDirtyRegion>
+{
+public:
+    //! type of the container holding merged dirty rectangles
+    typedef std::vector<Rectf CEGUI_VECTOR_ALLOC(Rectf)> RectList;
+
+    /*!
+    \brief Constructor
+    */
+    ChromeDirtyRegion();
+
+    /*!
+    \brief sets the extents of the canvas, clears all dirty rectangles
+
+    \param size
+        size of the canvas in pixels, dirty rectangles will be clipped to it
+    */
+    void setBounds(const Sizef& size);
+
+    /*!
+    \brief retrieves extents of the canvas
+    */
+    const Sizef& getBounds() const;
+
+    /*!
+    \brief sets the ratio of canvas area above which the whole canvas is considered dirty
+
+    \param ratio
+        If this is 0.75, once dirty rectangles cover 75% of the canvas, they are replaced by one
+        rectangle covering the entire canvas. 1.0 disables the full canvas fallback.
+    */
+    void setCoverageThreshold(float ratio);
+
+    /*!
+    \brief retrieves the coverage threshold
+
+    \see ChromeDirtyRegion::setCoverageThreshold
+    */
+    float getCoverageThreshold() const;
+
+    /*!
+    \brief marks given rectangle as dirty
+
+    The rectangle gets clipped to canvas bounds and merged with previously added rectangles
+    */
+    void addRect(const Rectf& rect);
+
+    /*!
+    \brief marks the whole canvas as dirty
+    */
+    void addAll();
+
+    //! clears all dirty rectangles
+    void clear();
+
+    //! checks whether there is anything dirty at all
+    bool isEmpty() const;
+
+    //! checks whether the whole canvas is dirty
+    bool isFull() const;
+
+    //! retrieves the merged dirty rectangles
+    const RectList& getRects() const;
+
+    //! retrieves how many rectangles were added since the last clear
+    size_t getAddedRectCount() const;
+
+private:
+    //! area of given rectangle, 0 for empty or inverted rectangles
+    static float getArea(const Rectf& rect);
+
+    //! canvas extents
+    Sizef d_bounds;
+    //! coverage ratio above which the whole canvas is considered dirty
+    float d_coverageThreshold;
+    //! merged dirty rectangles
+    RectList d_rects;
+    //! how many rectangles were added since last clear
+    size_t d_addedRectCount;
+    //! if true, d_rects contains just one rect covering the whole canvas
+    bool d_full;
+};
+
+}
+
+#endif
@@ -81,7 +81,53 @@ public:
     */
     void setContent(const String& markupCode);
 
+    /*!
+    \brief
+        Updates the content XHTML/HTML code, patching the loaded page where possible
+
+    \par
+        The markup is compared to the previous one. When they only differ inside elements with
+        an id attribute, those elements get their innerHTML replaced by a script and the page isn't
+        reloaded. When anything else differs, more than the patch threshold of the markup changed or
+        the page hasn't finished loading, this falls back to ChromeHTML::setContent.
+
+    \param markupCode
+        Entire XHTML/HTML markup to set as content of this widget
+    */
+    void updateContent(const String& markupCode);
+
+    /*!
+    \brief sets how much of the markup may change before updateContent reloads the page
+
+    \param ratio
+        portion of the new markup's size, defaults to 0.5
+    */
+    void setContentPatchThreshold(float ratio);
+
+    //! retrieves how much of the markup may change before updateContent reloads the page
+    float getContentPatchThreshold() const;
+
+    //! retrieves how many times updateContent patched the page
+    size_t getContentPatchCount() const;
+
+    //! retrieves how many times the page was loaded from markup, setting the markup that is shown already doesn't count
+    size_t getContentReloadCount() const;
+
 protected:
+    //! the markup currently shown, UTF-8
+    std::string d_content;
+    //! navigation generation d_content was loaded with, \see ChromeWidget::getNavigationGeneration
+    uint d_contentNavigation;
+    //! \see ChromeHTML::setContentPatchThreshold
+    float d_contentPatchThreshold;
+    //! \see ChromeHTML::getContentPatchCount
+    size_t d_contentPatchCount;
+    //! \see ChromeHTML::getContentReloadCount
+    size_t d_contentReloadCount;
+
+    //! \copydoc ChromeWidget::onDeferredNavigationNeeded
+    virtual void onDeferredNavigationNeeded();
+
 	/*!
 	\brief
 		Return whether this window was inherited from the given class name at some point in the inheritance hierarchy.
@@ -30,6 +30,7 @@
 #define _CEGUIChromeImage_h_
 
 #include "CEGUIChromeWidget.h"
+#include "CEGUIChromeRasterCache.h"
 
 namespace CEGUI
 {
@@ -86,8 +87,62 @@ public:
         loading the image file.
     */
     void loadFromFile(const String& mimeSubtype, const String& filename, const String& resourceGroup = "");
-    
+
+    /*!
+    \brief sets whether raster images are decoded by CEGUI instead of Chrome
+
+    \par
+        When enabled, loadFromFile decodes png, jpeg and gif images with the renderer's image codec
+        straight into a texture, no Berkelium window is involved at all. Chrome is still used for svg
+        and anything else the image codec can't know about. Enabled by default.
+    */
+    void setNativeRasterEnabled(bool enabled);
+
+    //! checks whether raster images are decoded by CEGUI instead of Chrome
+    bool isNativeRasterEnabled() const;
+
+    //! checks whether the image currently shown was decoded by CEGUI
+    bool isNativeRasterActive() const;
+
 protected:
+    //! checks whether images of given mime subtype can be decoded by CEGUI
+    static bool isNativeRasterSubtype(const String& mimeSubtype);
+
+    //! decodes given raster image to a texture and shows it instead of Chrome's output
+    void loadNativeRaster(const String& filename, const String& resourceGroup);
+
+    //! \copydoc ChromeWidget::onNativeContentTextureReleased
+    virtual void onNativeContentTextureReleased(Texture& texture);
+
+    /*!
+    \brief loads given svg image, painted canvases come from the raster cache if possible
+
+    The svg is loaded from its file so that it can refer to files next to it. Those files
+    aren't part of the cache key, \see ChromeRasterCache.
+
+    \see ChromeSystem::getRasterCache
+    */
+    void loadCachedVector(const String& filename, const String& resourceGroup);
+
+    //! fills the raster cache key of the current svg and canvas size, false if there is nothing to cache
+    bool getVectorCacheKey(ChromeRasterCache::Key& key) const;
+
+    //! \copydoc ChromeWidget::restoreRenderingCanvas
+    virtual bool restoreRenderingCanvas();
+
+    //! \copydoc ChromeWidget::onRenderingCanvasSettled
+    virtual void onRenderingCanvasSettled();
+
+    //! \see ChromeImage::setNativeRasterEnabled
+    bool d_nativeRasterEnabled;
+    //! hash of the svg loaded through the raster cache, 0 if the widget shows anything else
+    ChromeSystem::PayloadHash d_vectorContentHash;
+    //! if true, the canvas goes to the raster cache once Chrome is done painting it
+    bool d_vectorStorePending;
+
+    //! used to give raster textures unique names
+    static uint ds_rasterTextureCounter;
+
 	/*!
 	\brief
 		Return whether this window was inherited from the given class name at some point in the inheritance hierarchy.
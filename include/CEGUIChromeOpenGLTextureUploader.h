@@ -0,0 +1,70 @@
+/***********************************************************************
+    filename:   CEGUIChromeOpenGLTextureUploader.h
+    created:    16/10/2026
+    author:     Martin Preisler
+*************************************************************************/
+/***************************************************************************
+ *   Copyright (C) 2011 Martin Preisler
+ *
+ *   Permission is hereby granted, free of charge, to any person obtaining
+ *   a copy of this software and associated documentation files (the
+ *   "Software"), to deal in the Software without restriction, including
+ *   without limitation the rights to use, copy, modify, merge, publish,
+ *   distribute, sublicense, and/or sell copies of the Software, and to
+ *   permit persons to whom the Software is furnished to do so, subject to
+ *   the following conditions:
+ *
+ *   The above copyright notice and this permission notice shall be
+ *   included in all copies or substantial portions of the Software.
+ *
+ *   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ *   EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ *   MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ *   IN NO EVENT SHALL THE AUTHORS BE LIABLE FOR ANY CLAIM, DAMAGES OR
+ *   OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+ *   ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ *   OTHER DEALINGS IN THE SOFTWARE.
+ ***************************************************************************/
+
+#ifndef _CEGUIChromeOpenGLTextureUploader_h_
+#define _CEGUIChromeOpenGLTextureUploader_h_
+
+#include "CEGUIChromeTextureUploader.h"
+
+namespace CEGUI
+{
+
+/*!
+\brief
+    Texture uploader for the OpenGL renderer, uploads straight from pitched memory using GL_UNPACK_ROW_LENGTH
+
+\par
+    Pixels are uploaded as GL_BGRA, the driver swaps the channels so we don't have to.
+
+\note
+    Only built when CHROMED_CEGUI_BUILD_OPENGL_UPLOADER is enabled in CMake, ChromeSystem picks it up
+    automatically if CEGUI uses the OpenGL renderer.
+*/
+class CHROMED_CEGUI_API ChromeOpenGLTextureUploader : public ChromeTextureUploader
+{
+public:
+    /*!
+    \brief Constructor
+    */
+    ChromeOpenGLTextureUploader();
+
+    /*!
+    \brief Destructor
+    */
+    virtual ~ChromeOpenGLTextureUploader();
+
+    //! \copydoc ChromeTextureUploader::blitFromMemory
+    virtual void blitFromMemory(Texture& texture, const void* source, size_t sourcePitch, const Rectf& area);
+
+    //! \copydoc ChromeTextureUploader::getPixelLayout
+    virtual ChromePixelKernels::PixelLayout getPixelLayout() const;
+};
+
+}
+
+#endif
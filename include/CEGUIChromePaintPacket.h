@@ -0,0 +1,90 @@
+/***********************************************************************
+    filename:   CEGUIChromePaintPacket.h
+    created:    16/10/2026
+    author:     Martin Preisler
+*************************************************************************/
+/***************************************************************************
+ *   Copyright (C) 2011 Martin Preisler
+ *
+ *   Permission is hereby granted, free of charge, to any person obtaining
+ *   a copy of this software and associated documentation files (the
+ *   "Software"), to deal in the Software without restriction, including
+ *   without limitation the rights to use, copy, modify, merge, publish,
+ *   distribute, sublicense, and/or sell copies of the Software, and to
+ *   permit persons to whom the Software is furnished to do so, subject to
+ *   the following conditions:
+ *
+ *   The above copyright notice and this permission notice shall be
+ *   included in all copies or substantial portions of the Software.
+ *
+ *   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ *   EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ *   MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ *   IN NO EVENT SHALL THE AUTHORS BE LIABLE FOR ANY CLAIM, DAMAGES OR
+ *   OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+ *   ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ *   OTHER DEALINGS IN THE SOFTWARE.
+ ***************************************************************************/
+
+#ifndef _CEGUIChromePaintPacket_h_
+#define _CEGUIChromePaintPacket_h_
+
+#include "CEGUIChromePrerequisites.h"
+#include "CEGUIRect.h"
+
+#include <vector>
+
+namespace CEGUI
+{
+
+/*!
+\brief
+    One paint delivered by Chrome, copied out of Berkelium's buffer so that it can be applied later
+
+\par
+    Used when Berkelium is updated on a separate thread, packets are pooled by ChromeSystem
+    and their buffers are reused. A packet carrying host messages carries nothing else,
+    \see ChromeWidget::setHostMessagesEnabled
+*/
+class CHROMED_CEGUI_API ChromePaintPacket :
+    public AllocatedObject<ChromePaintPacket>
+{
+public:
+    //! one copied area of the canvas
+    struct CopyRect
+    {
+        //! where in the canvas should the pixels go
+        Rectf d_area;
+        //! where in d_pixels the pixels start, rows are packed without any padding
+        size_t d_offset;
+    };
+
+    //! type of the container holding the copied areas
+    typedef std::vector<CopyRect CEGUI_VECTOR_ALLOC(CopyRect)> CopyRectList;
+    //! type of the container holding the pixels
+    typedef std::vector<uint8 CEGUI_VECTOR_ALLOC(uint8)> PixelBuffer;
+
+    ChromePaintPacket();
+
+    //! clears the packet for reuse, keeps the buffers allocated
+    void clear();
+
+    //! id of the widget this paint belongs to, \see ChromeSystem::registerWidget
+    uint d_widgetId;
+    //! horizontal scroll offset, 0 if Chrome didn't scroll
+    int d_dx;
+    //! vertical scroll offset, 0 if Chrome didn't scroll
+    int d_dy;
+    //! area of the canvas that scrolled
+    Rectf d_scrollRect;
+    //! copied areas
+    CopyRectList d_copyRects;
+    //! pixels of all copied areas, 4 bytes per pixel in Chrome's layout
+    PixelBuffer d_pixels;
+    //! framed messages the page sent to the host, empty for paints
+    PixelBuffer d_hostMessages;
+};
+
+}
+
+#endif
@@ -0,0 +1,145 @@
+/***********************************************************************
+    filename:   CEGUIChromePixelKernels.h
+    created:    16/10/2026
+    author:     Martin Preisler
+*************************************************************************/
+/***************************************************************************
+ *   Copyright (C) 2011 Martin Preisler
+ *
+ *   Permission is hereby granted, free of charge, to any person obtaining
+ *   a copy of this software and associated documentation files (the
+ *   "Software"), to deal in the Software without restriction, including
+ *   without limitation the rights to use, copy, modify, merge, publish,
+ *   distribute, sublicense, and/or sell copies of the Software, and to
+ *   permit persons to whom the Software is furnished to do so, subject to
+ *   the following conditions:
+ *
+ *   The above copyright notice and this permission notice shall be
+ *   included in all copies or substantial portions of the Software.
+ *
+ *   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ *   EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ *   MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ *   IN NO EVENT SHALL THE AUTHORS BE LIABLE FOR ANY CLAIM, DAMAGES OR
+ *   OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+ *   ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ *   OTHER DEALINGS IN THE SOFTWARE.
+ ***************************************************************************/
+
+#ifndef _CEGUIChromePixelKernels_h_
+#define _CEGUIChromePixelKernels_h_
+
+#include "CEGUIChromePrerequisites.h"
+
+#include <atomic>
+
+namespace CEGUI
+{
+
+/*!
+\brief
+    Pixel conversion kernels used when copying Chrome's output to the canvas
+
+\par
+    All kernels work with 4 bytes per pixel, alpha always being the last byte. Every kernel has a scalar
+    reference implementation and vectorised implementations for SSE2, AVX2 and NEON where it makes sense,
+    the best one the CPU supports is picked at runtime. All implementations give bit exact results.
+*/
+class CHROMED_CEGUI_API ChromePixelKernels
+{
+public:
+    //! memory layouts of pixels
+    enum PixelLayout
+    {
+        PL_BGRAPremultiplied, //!< what Chrome (Berkelium) outputs
+        PL_RGBAPremultiplied,
+        PL_BGRA,
+        PL_RGBA //!< what CEGUI's Texture::blitFromMemory expects
+    };
+
+    //! conversions between pixel layouts
+    enum Conversion
+    {
+        PC_Copy, //!< pixels are just copied
+        PC_Swizzle, //!< swaps first and third byte of every pixel (BGRA <-> RGBA)
+        PC_Premultiply, //!< multiplies colour channels by alpha
+        PC_SwizzlePremultiply, //!< PC_Swizzle and PC_Premultiply combined
+        PC_Unpremultiply, //!< divides colour channels by alpha
+        PC_SwizzleUnpremultiply, //!< PC_Swizzle and PC_Unpremultiply combined
+
+        PC_Count //!< number of conversions, not a valid conversion
+    };
+
+    //! instruction sets kernels can be implemented with
+    enum InstructionSet
+    {
+        IS_Scalar, //!< plain C++, always available
+        IS_SSE2,
+        IS_AVX2,
+        IS_NEON
+    };
+
+    /*!
+    \brief converts one row of pixels
+
+    \param destination
+        where to write the pixels, may be the same as source but mustn't overlap otherwise
+    \param source
+        pixels to convert
+    \param pixelCount
+        how many pixels to convert
+    */
+    typedef void (*RowKernel)(uint8* destination, const uint8* source, size_t pixelCount);
+
+    //! figures out which conversion is needed to get from one layout to another
+    static Conversion getConversion(PixelLayout from, PixelLayout to);
+
+    /*!
+    \brief converts a rectangle of pixels using the best available kernel
+
+    \param destinationPitch
+        how many bytes there are between the starts of 2 consecutive rows in the destination
+    \param sourcePitch
+        how many bytes there are between the starts of 2 consecutive rows in the source
+    */
+    static void convert(Conversion conversion,
+                        uint8* destination, size_t destinationPitch,
+                        const uint8* source, size_t sourcePitch,
+                        size_t width, size_t height);
+
+    //! retrieves the best kernel for given conversion
+    static RowKernel getKernel(Conversion conversion);
+
+    /*!
+    \brief retrieves kernel for given conversion implemented with given instruction set
+
+    \return
+        the kernel or 0 if there is no such implementation or the CPU doesn't support it
+    */
+    static RowKernel getKernel(Conversion conversion, InstructionSet instructionSet);
+
+    //! checks whether the CPU we are running on supports given instruction set, \see ChromeCPUFeatures
+    static bool isInstructionSetSupported(InstructionSet instructionSet);
+
+    //! retrieves the instruction set used by default
+    static InstructionSet getInstructionSet();
+
+    /*!
+    \brief overrides the instruction set used by default
+
+    Kernels that aren't implemented in given instruction set fall back to a lesser one.
+    You can use this to compare implementations or to work around a broken one.
+    */
+    static void setInstructionSet(InstructionSet instructionSet);
+
+private:
+    //! detects the best instruction set on the first call, may be called from any thread
+    static void ensureDetected();
+
+    //! instruction set used by default, read from the pump thread as well
+    static std::atomic<InstructionSet> ds_instructionSet;
+};
+
+}
+
+#endif
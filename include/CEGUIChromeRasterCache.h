@@ -0,0 +1,211 @@
+/***********************************************************************
+    filename:   CEGUIChromeRasterCache.h
+    created:    16/10/2026
+    author:     Martin Preisler
+*************************************************************************/
+/***************************************************************************
+ *   Copyright (C) 2011 Martin Preisler
+ *
+ *   Permission is hereby granted, free of charge, to any person obtaining
+ *   a copy of this software and associated documentation files (the
+ *   "Software"), to deal in the Software without restriction, including
+ *   without limitation the rights to use, copy, modify, merge, publish,
+ *   distribute, sublicense, and/or sell copies of the Software, and to
+ *   permit persons to whom the Software is furnished to do so, subject to
+ *   the following conditions:
+ *
+ *   The above copyright notice and this permission notice shall be
+ *   included in all copies or substantial portions of the Software.
+ *
+ *   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ *   EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ *   MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ *   IN NO EVENT SHALL THE AUTHORS BE LIABLE FOR ANY CLAIM, DAMAGES OR
+ *   OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+ *   ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ *   OTHER DEALINGS IN THE SOFTWARE.
+ ***************************************************************************/
+#ifndef _CEGUIChromeRasterCache_h_
+#define _CEGUIChromeRasterCache_h_
+
+#include "CEGUIChromePrerequisites.h"
+#include "CEGUIChromeSystem.h"
+
+#include <map>
+#include <string>
+#include <ctime>
+
+namespace CEGUI
+{
+
+/*!
+\brief
+    Keeps canvases painted by Chrome on disk so that they don't have to be painted again
+
+\par
+    Every entry is one file, a 32 byte header followed by the canvas pixels exactly as the canvas
+    texture holds them, row after row without any padding. Entries are memory mapped when they
+    are loaded and copied to the canvas straight from the mapping.
+
+\par
+    The cache is disabled until it gets a directory. Once the entries take more than the capacity,
+    the least recently used ones are deleted. Main thread only.
+
+\par
+    An entry is only as fresh as its Key. The content hash covers the bytes of the page itself,
+    not what the page loads, so an svg that refers to images or stylesheets next to it keeps
+    its cached canvas when only those files change. Clear the cache after changing such files,
+    \see ChromeRasterCache::clear.
+
+\see ChromeSystem::getRasterCache
+*/
+class CHROMED_CEGUI_API ChromeRasterCache :
+    public AllocatedObject<ChromeRasterCache>
+{
+public:
+    //! identifies a painted canvas
+    struct Key
+    {
+        //! hash of the content Chrome painted, \see ChromeSystem::hashPayload
+        ChromeSystem::PayloadHash d_contentHash;
+        //! size of the canvas in pixels
+        uint d_width;
+        uint d_height;
+        //! rendering detail ratio the canvas was painted with
+        float d_detailRatio;
+        //! whether the canvas was painted with transparency
+        bool d_transparent;
+        //! ChromePixelKernels::PixelLayout of the pixels, \see ChromeTextureUploader::getPixelLayout
+        uint d_pixelLayout;
+    };
+
+    /*!
+    \brief Constructor
+    */
+    ChromeRasterCache();
+
+    /*!
+    \brief Destructor
+    */
+    ~ChromeRasterCache();
+
+    /*!
+    \brief sets the directory the cache keeps its entries in
+
+    \param directory
+        The directory has to exist, entries already in it are reused. An empty string disables the cache.
+    */
+    void setDirectory(const String& directory);
+
+    //! retrieves the directory the cache keeps its entries in, empty if disabled
+    const String& getDirectory() const;
+
+    //! checks whether the cache has a directory
+    bool isEnabled() const;
+
+    /*!
+    \brief sets how many bytes the entries may take on disk
+
+    \param bytes
+        Defaults to 64MB
+    */
+    void setCapacity(size_t bytes);
+
+    //! retrieves how many bytes the entries may take on disk
+    size_t getCapacity() const;
+
+    //! retrieves how many bytes the entries take on disk right now
+    size_t getSize() const;
+
+    //! retrieves how many canvases were loaded from the cache
+    size_t getHitCount() const;
+
+    //! retrieves how many canvases were looked up but weren't in the cache
+    size_t getMissCount() const;
+
+    //! checks whether there is an entry for given key, doesn't count as a hit or a miss
+    bool contains(const Key& key) const;
+
+    /*!
+    \brief maps the entry of given key to memory
+
+    \param pitch
+        receives the size of one row of pixels in bytes
+
+    \return
+        0 if there is no such entry, otherwise the pixels, valid until ChromeRasterCache::unmap
+    */
+    const uint8* map(const Key& key, size_t& pitch);
+
+    //! unmaps the entry mapped by ChromeRasterCache::map
+    void unmap();
+
+    /*!
+    \brief stores given pixels as the entry of given key, replaces the entry if there is one
+
+    \param pixels
+        key.d_width x key.d_height pixels, 4 bytes each
+    \param pitch
+        size of one row of pixels in bytes
+    */
+    void store(const Key& key, const uint8* pixels, size_t pitch);
+
+    //! deletes all entries
+    void clear();
+
+private:
+    //! what we know about one entry
+    struct Entry
+    {
+        //! size of the file in bytes
+        size_t d_size;
+        //! when the entry was last stored or loaded
+        time_t d_lastUse;
+    };
+
+    typedef std::map<std::string, Entry> EntryMap;
+
+    //! file name of the entry of given key
+    static std::string getEntryName(const Key& key);
+
+    //! finds all entries in the directory
+    void scanDirectory();
+
+    //! deletes least recently used entries until they fit given size
+    void trim(size_t size);
+
+    //! deletes the entry file and forgets about it
+    void removeEntry(EntryMap::iterator it);
+
+    // ChromeRasterCache is not copyable
+    ChromeRasterCache(const ChromeRasterCache&);
+    ChromeRasterCache& operator=(const ChromeRasterCache&);
+
+    //! \see ChromeRasterCache::setDirectory
+    String d_directory;
+    //! d_directory with a trailing slash, empty if disabled
+    std::string d_path;
+    //! \see ChromeRasterCache::setCapacity
+    size_t d_capacity;
+    //! \see ChromeRasterCache::getSize
+    size_t d_size;
+    //! \see ChromeRasterCache::getHitCount
+    size_t d_hitCount;
+    //! \see ChromeRasterCache::getMissCount
+    size_t d_missCount;
+    //! entries in the directory
+    EntryMap d_entries;
+
+    //! the mapped entry, 0 if there is none
+    void* d_mappedData;
+    //! size of the mapping in bytes
+    size_t d_mappedSize;
+#ifdef _WIN32
+    //! the mapping object of the mapped entry
+    void* d_mappingHandle;
+#endif
+};
+
+}
+
+#endif
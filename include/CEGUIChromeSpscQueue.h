@@ -0,0 +1,154 @@
+/***********************************************************************
+    filename:   CEGUIChromeSpscQueue.h
+    created:    16/10/2026
+    author:     Martin Preisler
+*************************************************************************/
+/***************************************************************************
+ *   Copyright (C) 2011 Martin Preisler
+ *
+ *   Permission is hereby granted, free of charge, to any person obtaining
+ *   a copy of this software and associated documentation files (the
+ *   "Software"), to deal in the Software without restriction, including
+ *   without limitation the rights to use, copy, modify, merge, publish,
+ *   distribute, sublicense, and/or sell copies of the Software, and to
+ *   permit persons to whom the Software is furnished to do so, subject to
+ *   the following conditions:
+ *
+ *   The above copyright notice and this permission notice shall be
+ *   included in all copies or substantial portions of the Software.
+ *
+ *   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ *   EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ *   MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ *   IN NO EVENT SHALL THE AUTHORS BE LIABLE FOR ANY CLAIM, DAMAGES OR
+ *   OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+ *   ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ *   OTHER DEALINGS IN THE SOFTWARE.
+ ***************************************************************************/
+
+#ifndef _CEGUIChromeSpscQueue_h_
+#define _CEGUIChromeSpscQueue_h_
+
+#include "CEGUIChromePrerequisites.h"
+
+#include <atomic>
+
+namespace CEGUI
+{
+
+/*!
+\brief
+    Unbounded lock-free queue with exactly one producer thread and one consumer thread
+
+\par
+    The producer recycles nodes the consumer has already moved past, so once the queue
+    has grown to its working size, pushing doesn't allocate anymore.
+
+\par
+    The producer may only call push, the consumer may only call pop. The destructor has to run
+    when neither thread uses the queue anymore.
+*/
+template<typename T>
+class ChromeSpscQueue :
+    public AllocatedObject<ChromeSpscQueue<T> >
+{
+public:
+    ChromeSpscQueue()
+    {
+        Node* node = CEGUI_NEW_AO Node();
+        node->d_next.store(0, std::memory_order_relaxed);
+
+        d_tail.store(node, std::memory_order_relaxed);
+        d_head = node;
+        d_first = node;
+        d_tailCopy = node;
+    }
+
+    ~ChromeSpscQueue()
+    {
+        Node* node = d_first;
+
+        while (node)
+        {
+            Node* next = node->d_next.load(std::memory_order_relaxed);
+            CEGUI_DELETE_AO node;
+            node = next;
+        }
+    }
+
+    //! appends given value to the queue, producer only
+    void push(const T& value)
+    {
+        Node* node = allocateNode();
+        node->d_value = value;
+        node->d_next.store(0, std::memory_order_relaxed);
+
+        d_head->d_next.store(node, std::memory_order_release);
+        d_head = node;
+    }
+
+    //! takes the oldest value out of the queue, consumer only, returns false if the queue is empty
+    bool pop(T& value)
+    {
+        Node* tail = d_tail.load(std::memory_order_relaxed);
+        Node* next = tail->d_next.load(std::memory_order_acquire);
+
+        if (!next)
+        {
+            return false;
+        }
+
+        value = next->d_value;
+        // the old tail node is now free for the producer to reuse
+        d_tail.store(next, std::memory_order_release);
+
+        return true;
+    }
+
+private:
+    struct Node :
+        public AllocatedObject<Node>
+    {
+        std::atomic<Node*> d_next;
+        T d_value;
+    };
+
+    //! reuses a node the consumer is done with or allocates a new one, producer only
+    Node* allocateNode()
+    {
+        if (d_first != d_tailCopy)
+        {
+            Node* node = d_first;
+            d_first = d_first->d_next.load(std::memory_order_relaxed);
+            return node;
+        }
+
+        d_tailCopy = d_tail.load(std::memory_order_acquire);
+
+        if (d_first != d_tailCopy)
+        {
+            Node* node = d_first;
+            d_first = d_first->d_next.load(std::memory_order_relaxed);
+            return node;
+        }
+
+        return CEGUI_NEW_AO Node();
+    }
+
+    // ChromeSpscQueue is not copyable
+    ChromeSpscQueue(const ChromeSpscQueue&);
+    ChromeSpscQueue& operator=(const ChromeSpscQueue&);
+
+    //! last node the consumer has consumed, written by the consumer only
+    std::atomic<Node*> d_tail;
+    //! last pushed node, producer only
+    Node* d_head;
+    //! first node that can be recycled, producer only
+    Node* d_first;
+    //! producer's copy of d_tail, nodes between d_first and this can be recycled
+    Node* d_tailCopy;
+};
+
+}
+
+#endif
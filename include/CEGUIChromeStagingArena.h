@@ -0,0 +1,106 @@
+/***********************************************************************
+    filename:   CEGUIChromeStagingArena.h
+    created:    16/10/2026
+    author:     Martin Preisler
+*************************************************************************/
+/***************************************************************************
+ *   Copyright (C) 2011 Martin Preisler
+ *
+ *   Permission is hereby granted, free of charge, to any person obtaining
+ *   a copy of this software and associated documentation files (the
+ *   "Software"), to deal in the Software without restriction, including
+ *   without limitation the rights to use, copy, modify, merge, publish,
+ *   distribute, sublicense, and/or sell copies of the Software, and to
+ *   permit persons to whom the Software is furnished to do so, subject to
+ *   the following conditions:
+ *
+ *   The above copyright notice and this permission notice shall be
+ *   included in all copies or substantial portions of the Software.
+ *
+ *   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ *   EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ *   MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ *   IN NO EVENT SHALL THE AUTHORS BE LIABLE FOR ANY CLAIM, DAMAGES OR
+ *   OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+ *   ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ *   OTHER DEALINGS IN THE SOFTWARE.
+ ***************************************************************************/
+
+#ifndef _CEGUIChromeStagingArena_h_
+#define _CEGUIChromeStagingArena_h_
+
+#include "CEGUIChromePrerequisites.h"
+
+#include <atomic>
+
+namespace CEGUI
+{
+
+/*!
+\brief
+    Scratch memory for staging pixels while paints are processed
+
+\par
+    The arena holds one buffer that grows to the biggest request it gets. Trimming shrinks it back
+    to the biggest request since the previous trim, so memory that was only needed once is given back.
+
+\par
+    An arena belongs to one thread, see ChromeSystem::getStagingArena. Only one piece of code may use
+    the memory at a time, whatever acquire returns stays valid until the next acquire, trim or release.
+*/
+class CHROMED_CEGUI_API ChromeStagingArena :
+    public AllocatedObject<ChromeStagingArena>
+{
+public:
+    /*!
+    \brief Constructor
+    */
+    ChromeStagingArena();
+
+    /*!
+    \brief Destructor
+    */
+    ~ChromeStagingArena();
+
+    /*!
+    \brief retrieves at least given amount of scratch memory
+
+    The content of the memory is undefined.
+    */
+    uint8* acquire(size_t size);
+
+    /*!
+    \brief shrinks the arena to the biggest request since the last trim
+    */
+    void trim();
+
+    /*!
+    \brief frees all memory of the arena
+    */
+    void release();
+
+    //! retrieves how many bytes the arena currently holds, can be called from any thread
+    size_t getCapacity() const;
+
+    //! retrieves the biggest request since the last trim
+    size_t getPeak() const;
+
+private:
+    //! reallocates the buffer to exactly given size, without keeping the content
+    void reallocate(size_t size);
+
+    // ChromeStagingArena is not copyable
+    ChromeStagingArena(const ChromeStagingArena&);
+    ChromeStagingArena& operator=(const ChromeStagingArena&);
+
+    //! the scratch memory
+    uint8* d_buffer;
+    //! size of d_buffer in bytes, atomic so that memory statistics can be collected from other threads
+    std::atomic<size_t> d_capacity;
+    //! biggest request since the last trim
+    size_t d_peak;
+};
+
+}
+
+#endif
@@ -30,26 +30,67 @@
 #define _CEGUIChromeSystem_h_
 
 #include "CEGUIChromePrerequisites.h"
+#include "CEGUIEvent.h"
+#include "CEGUISize.h"
+
+#include <map>
+#include <ctime>
+#include <string>
+#include <vector>
 
 namespace Berkelium
 {
     class Context;
+    class Window;
 }
 
 namespace CEGUI
 {
 
+class ChromeTextureUploader;
+class ChromeStagingArena;
+class ChromeRasterCache;
+class ChromeWidget;
+class ChromePaintPacket;
+
+/*!
+\brief
+    A piece of work that has to be done on the thread that owns Berkelium
+
+\see ChromeSystem::executeTask
+*/
+class CHROMED_CEGUI_API ChromeTask :
+    public AllocatedObject<ChromeTask>
+{
+public:
+    virtual ~ChromeTask()
+    {}
+
+    //! does the work, always called on the thread that owns Berkelium
+    virtual void execute() = 0;
+};
+
 /*!
 \brief Central class of the module
 */
 class CHROMED_CEGUI_API ChromeSystem
 {
 public:
+    //! identifies the contents of an encoded payload, \see ChromeSystem::hashPayload
+    typedef unsigned long long PayloadHash;
+
     //! if the system wasn't initialised already, this throws exception!
     static void ensureInitialised();
 
-    //! initialises the system, if it was initialised, exception is thrown
-    static void initialise();
+    /*!
+    \brief initialises the system, if it was initialised, exception is thrown
+
+    \param warmWindowPoolSize
+        how many blank Berkelium windows to keep ready for new widgets, creating a window is the slowest
+        thing a widget does. The pool is filled right away (on the pump thread when updating Berkelium
+        on a separate thread) and refilled one window per frame while the system is idle.
+    */
+    static void initialise(size_t warmWindowPoolSize = 0);
 
     //! finalises the system, you have to do this manually if you don't want leaks to occur!
     static void finalise();
@@ -60,14 +101,607 @@ public:
     //! returns the shared Berkelium context, we use one context for all windows but it seems the windows clone it anyways
     static Berkelium::Context* getContext();
 
-    //! needs to be called every frame
+    /*!
+    \brief updates Berkelium right away
+
+    Chrome widgets call ChromeSystem::scheduledUpdate by themselves, you only need to call this
+    if you want Berkelium to be updated regardless of the schedule.
+    */
     static void update();
 
+    /*!
+    \brief updates Berkelium if the schedule allows it
+
+    \par
+        Berkelium is updated at most once per frame, the frame starts when CEGUI starts rendering
+        the default rendering root. If an update takes longer than the update time budget, the following
+        frames are skipped until the average is back within the budget (never more than a few frames in a row).
+        Once nothing happened in any widget for the idle frame threshold, Berkelium is only updated once per
+        idle update interval.
+
+    \par
+        Chrome widgets call this from their updateSelf, so you don't have to.
+    */
+    static void scheduledUpdate();
+
+    /*!
+    \brief lets the scheduler know something happened in a widget, resets idle backoff
+
+    Chrome widgets call this whenever they get painted, receive input or navigate.
+    */
+    static void notifyActivity();
+
+    /*!
+    \brief sets how long Berkelium updates may take per frame on average
+
+    \param seconds
+        0 means no limit, this is the default
+    */
+    static void setUpdateTimeBudget(float seconds);
+
+    //! retrieves how long Berkelium updates may take per frame on average
+    static float getUpdateTimeBudget();
+
+    /*!
+    \brief sets after how many frames without any activity Berkelium is updated less often
+
+    \param frames
+        Defaults to 60, 0 disables idle backoff
+    */
+    static void setIdleFrameThreshold(uint frames);
+
+    //! retrieves after how many frames without any activity Berkelium is updated less often
+    static uint getIdleFrameThreshold();
+
+    /*!
+    \brief sets how often Berkelium is updated when idle
+
+    \param seconds
+        Defaults to 0.1, 10 updates per second
+    */
+    static void setIdleUpdateInterval(float seconds);
+
+    //! retrieves how often Berkelium is updated when idle
+    static float getIdleUpdateInterval();
+
+    //! checks whether no widget has had any activity for the idle frame threshold
+    static bool isIdle();
+
+    /*!
+    \brief Enables/Disables updating Berkelium on a separate thread
+
+    \par
+        When enabled, the system starts a thread that owns Berkelium and pumps it, paints are copied
+        to pooled packets there and handed over to the main thread without locking. ChromeSystem::update
+        then only dispatches the packets to the widgets, which apply them when they are drawn.
+        All Berkelium calls are passed to the pump thread as tasks, see ChromeSystem::executeTask.
+
+    \par
+        This has to be set before the system is initialised. Disabled by default.
+    */
+    static void setThreadedUpdateEnabled(bool enabled);
+
+    //! checks whether Berkelium is updated on a separate thread
+    static bool isThreadedUpdateEnabled();
+
+    /*!
+    \brief Enables/Disables lazy Berkelium window creation
+
+    \par
+        When enabled, ChromeWidget doesn't create its Berkelium window in the constructor. Navigation
+        and transparency requests are recorded and replayed once the window is created, which happens
+        the first time the widget becomes visible or when ChromeWidget::ensureChromeWindow is called.
+        Widgets in closed dialogs or hidden tabs then don't cost a renderer until they are needed.
+
+    \par
+        Only affects widgets created afterwards. Disabled by default.
+    */
+    static void setLazyWindowCreationEnabled(bool enabled);
+
+    //! checks whether ChromeWidget creates its Berkelium window lazily
+    static bool isLazyWindowCreationEnabled();
+
+    /*!
+    \brief sets how long the pump thread sleeps between 2 Berkelium updates
+
+    \param seconds
+        Defaults to 0.005, 5 milliseconds
+    */
+    static void setPumpThreadInterval(float seconds);
+
+    //! retrieves how long the pump thread sleeps between 2 Berkelium updates
+    static float getPumpThreadInterval();
+
+    /*!
+    \brief executes given task on the thread that owns Berkelium
+
+    The task is executed right away unless Berkelium is updated on a separate thread, in which case it's
+    queued and executed before the next Berkelium update. Tasks are executed in the order they were given.
+
+    \param task
+        the task, the system takes ownership of it
+    */
+    static void executeTask(ChromeTask* task);
+
+    /*!
+    \brief retrieves a canvas texture, reusing a pooled one if possible
+
+    \par
+        The smallest pooled texture that is at least minimumSize and at most maximumSize is handed out.
+        If there is none, a new texture is created with preferredSize rounded up to the pool granularity
+        (as long as that doesn't exceed maximumSize), so that similar requests can share textures later.
+
+    \par
+        The content of a reused texture is undefined.
+    */
+    static Texture& acquireCanvasTexture(const Sizef& minimumSize, const Sizef& preferredSize, const Sizef& maximumSize);
+
+    /*!
+    \brief returns a canvas texture to the pool
+
+    If the pool would go over its capacity, the textures that have been in the pool the longest
+    are destroyed to make room. Textures bigger than the whole capacity are destroyed right away.
+    */
+    static void releaseCanvasTexture(Texture& texture);
+
+    /*!
+    \brief destroys a canvas texture right away, without pooling it
+
+    Use this when the memory has to be given back, like when enforcing the texture memory budget.
+    */
+    static void destroyCanvasTexture(Texture& texture);
+
+    /*!
+    \brief sets how many bytes of textures the pool may keep around
+
+    \param bytes
+        Defaults to 16 MiB, 0 disables pooling
+    */
+    static void setTexturePoolCapacity(size_t bytes);
+
+    //! retrieves how many bytes of textures the pool may keep around
+    static size_t getTexturePoolCapacity();
+
+    //! retrieves how many bytes of textures are currently pooled
+    static size_t getTexturePoolSize();
+
+    //! retrieves how many textures are currently pooled
+    static size_t getTexturePoolTextureCount();
+
+    //! retrieves how many canvas texture requests were served from the pool
+    static size_t getTexturePoolHits();
+
+    //! retrieves how many canvas texture requests had to create a new texture
+    static size_t getTexturePoolMisses();
+
+    //! destroys all pooled textures
+    static void clearTexturePool();
+
+    /*!
+    \brief retrieves the staging arena of the calling thread
+
+    Every thread that processes paints gets its own arena, widgets use it for scratch memory instead
+    of keeping their own buffers around. The main thread trims its arena in ChromeSystem::scheduledUpdate,
+    other threads using an arena have to call ChromeStagingArena::trim themselves.
+    */
+    static ChromeStagingArena& getStagingArena();
+
+    /*!
+    \brief asks all staging arenas to give back memory they don't need
+
+    The main thread releases its arena the next time it updates, use this when memory runs low.
+    */
+    static void trimStagingMemory();
+
+    //! retrieves how many bytes all staging arenas hold together
+    static size_t getStagingMemorySize();
+
+    /*!
+    \brief sets how often staging arenas are trimmed to the biggest request since the previous trim
+
+    \param seconds
+        Defaults to 5.0
+    */
+    static void setStagingTrimInterval(float seconds);
+
+    //! retrieves how often staging arenas are trimmed
+    static float getStagingTrimInterval();
+
+    /*!
+    \brief sets how many Berkelium windows (each with a renderer process) may be alive at once
+
+    \par
+        When there are more, widgets that aren't visible give up their windows, the ones that have been
+        visible least recently go first. An evicted widget recreates its window once it's visible again.
+        Visible widgets are never evicted, so the budget can still be exceeded.
+
+    \param renderers
+        Defaults to 0, unlimited
+    */
+    static void setRendererBudget(uint renderers);
+
+    //! retrieves how many Berkelium windows may be alive at once, 0 means unlimited
+    static uint getRendererBudget();
+
+    /*!
+    \brief sets how many bytes of canvas textures widgets may hold together
+
+    \par
+        When widgets hold more, the ones that haven't been visible for the longest give up their canvas
+        textures, shadow buffers and Berkelium windows. Everything is recreated and repainted once they're
+        visible again. Textures given up go to the texture pool, which is limited by its own capacity.
+
+    \param bytes
+        Defaults to 0, unlimited
+    */
+    static void setTextureMemoryBudget(size_t bytes);
+
+    //! retrieves how many bytes of canvas textures widgets may hold together, 0 means unlimited
+    static size_t getTextureMemoryBudget();
+
+    //! retrieves how many Chrome widgets exist
+    static size_t getWidgetCount();
+
+    //! retrieves how many Berkelium windows are alive (or being created)
+    static uint getLiveRendererCount();
+
+    //! retrieves how many bytes of canvas textures widgets hold together, pooled textures aren't included
+    static size_t getTextureMemoryUsage();
+
+    //! retrieves how many times a widget was evicted to stay within the budgets
+    static size_t getEvictionCount();
+
+    //! retrieves how many bytes of queued scripts all widgets sent to Chrome in the last pump
+    static size_t getJavascriptBytesSent();
+
+    /*!
+    \brief sets how many bytes of encoded payloads (data URIs) the payload cache may hold
+
+    \par
+        Widgets loading the same content (a file or markup) share the encoded data URI through
+        the cache. A file on disk that hasn't changed since (same modification time) isn't even
+        read again. The least recently used payloads are dropped first.
+
+    \param bytes
+        Defaults to 8MB, 0 disables the cache
+    */
+    static void setPayloadCacheCapacity(size_t bytes);
+
+    //! retrieves how many bytes of encoded payloads the payload cache may hold
+    static size_t getPayloadCacheCapacity();
+
+    //! retrieves how many bytes of encoded payloads the payload cache holds right now
+    static size_t getPayloadCacheSize();
+
+    //! retrieves how many times a payload was found in the cache
+    static size_t getPayloadCacheHits();
+
+    //! retrieves how many times a payload had to be encoded
+    static size_t getPayloadCacheMisses();
+
+    //! drops all cached payloads
+    static void clearPayloadCache();
+
+    /*!
+    \brief Internal, hashes given payload, main thread only
+
+    \param header
+        the data URI header, the same data with a different header is a different payload
+    */
+    static PayloadHash hashPayload(const char* header, const uint8* data, size_t size);
+
+    /*!
+    \brief Internal, looks up an encoded payload by its hash alone, main thread only
+
+    Only meant for hashes that are known to refer to the cached payload, \see ChromeSystem::findResourcePayloadHash
+
+    \param serial
+        set to the serial of the cache entry, entries that reuse a hash get a different one
+
+    \return
+        0 if there is no such payload, otherwise the data URI valid until the cache is modified
+    */
+    static const std::string* findPayload(PayloadHash hash, uint& serial);
+
+    /*!
+    \brief Internal, looks up the encoded payload of given data, main thread only
+
+    The cached payload is compared against the data, a mere hash collision is a miss.
+
+    \param serial
+        set to the serial of the cache entry, entries that reuse a hash get a different one
+
+    \return
+        0 if there is no such payload, otherwise the data URI valid until the cache is modified
+    */
+    static const std::string* findPayload(PayloadHash hash, const char* header, const uint8* data, size_t size,
+                                          uint& serial);
+
+    /*!
+    \brief Internal, stores an encoded payload, main thread only
+
+    The data is kept alongside so that hits can be verified, it counts towards the capacity.
+
+    \param payload
+        the data URI, its contents are moved to the cache if it gets cached
+
+    \param serial
+        set to the serial of the new cache entry
+
+    \return
+        0 if the payload doesn't fit the capacity or a different payload is cached under the same hash,
+        otherwise the cached data URI, valid until the cache is modified
+    */
+    static const std::string* storePayload(PayloadHash hash, const uint8* data, size_t size,
+                                           std::string& payload, uint& serial);
+
+    /*!
+    \brief Internal, looks up the payload hash of a resource that hasn't changed on disk, main thread only
+
+    \param header
+        the data URI header the resource is encoded with
+
+    \return
+        false if the resource isn't known, isn't a file on disk or has been modified since
+    */
+    static bool findResourcePayloadHash(const String& filename, const String& resourceGroup,
+                                        const char* header, PayloadHash& hash);
+
+    /*!
+    \brief Internal, remembers the payload hash of a resource and its modification time, main thread only
+
+    Nothing is remembered unless the payload is cached, the entry is dropped once the payload gets evicted.
+    */
+    static void storeResourcePayloadHash(const String& filename, const String& resourceGroup,
+                                         const char* header, PayloadHash hash);
+
+    /*!
+    \brief Internal, registers given widget so that paint packets can find it, returns its id
+    */
+    static uint registerWidget(ChromeWidget* widget);
+
+    /*!
+    \brief Internal, unregisters widget with given id, packets still in flight for it are dropped
+    */
+    static void unregisterWidget(uint id);
+
+    /*!
+    \brief Internal, retrieves an empty paint packet, pump thread only
+    */
+    static ChromePaintPacket* acquirePaintPacket();
+
+    /*!
+    \brief Internal, passes a filled paint packet to the main thread, pump thread only
+    */
+    static void queuePaintPacket(ChromePaintPacket* packet);
+
+    /*!
+    \brief Internal, returns a paint packet that has been applied back to the pool, main thread only
+    */
+    static void releasePaintPacket(ChromePaintPacket* packet);
+
+    /*!
+    \brief sets the texture uploader all Chrome widgets use to upload canvas pixels
+
+    \param uploader
+        the uploader to use, it isn't owned by the system, you have to keep it alive until you
+        set another one or finalise the system. Passing 0 restores the default uploader.
+    */
+    static void setTextureUploader(ChromeTextureUploader* uploader);
+
+    //! retrieves the texture uploader currently in use
+    static ChromeTextureUploader& getTextureUploader();
+
+    /*!
+    \brief retrieves the disk cache of canvases painted by Chrome
+
+    The cache is disabled until it gets a directory, see ChromeRasterCache::setDirectory.
+    ChromeImage uses it to show svg images without painting them again.
+    */
+    static ChromeRasterCache& getRasterCache();
+
+    /*!
+    \brief checks whether given URL uses the resource scheme, cegui://resourceGroup/filename
+
+    \par
+        Chrome widgets resolve resource URLs before navigating, \see ChromeSystem::getResourceFileURL.
+        An empty resource group (cegui:///filename) means the default resource group.
+    */
+    static bool isResourceURL(const char* url, size_t length);
+
+    /*!
+    \brief splits a resource URL to the resource group and the file name, both percent decoded
+
+    \exception InvalidRequestException thrown if given URL doesn't use the resource scheme
+    */
+    static void parseResourceURL(const char* url, size_t length, String& filename, String& resourceGroup);
+
+    /*!
+    \brief translates a resource to a file:// URL Chrome can load and stream on its own
+
+    \par
+        This only works with DefaultResourceProvider (or a subclass of it), other providers may
+        keep the resources anywhere. Pages loaded this way can refer to other resources relatively
+        and Chrome fetches them lazily, without any data URIs involved.
+
+    \return
+        false if the resource isn't a file on disk, use the ResourceProvider to load it then
+    */
+    static bool getResourceFileURL(const String& filename, const String& resourceGroup, std::string& url);
+
+    /*!
+    \brief guesses the mime type of given file from its extension
+
+    \return
+        "application/octet-stream" if the extension isn't known
+    */
+    static const char* getMimeType(const String& filename);
+
+    //! retrieves how many warm Berkelium windows the system keeps ready, \see ChromeSystem::initialise
+    static size_t getWarmWindowPoolSize();
+
+    //! retrieves how many warm Berkelium windows are ready or being created right now
+    static size_t getWarmWindowCount();
+
+    /*!
+    \brief Internal, claims a warm window for a widget about to create its Berkelium window, main thread only
+
+    \return
+        true if the widget's creation task will find a window in the pool, it has to call
+        ChromeSystem::takeWarmWindow then
+    */
+    static bool reserveWarmWindow();
+
+    /*!
+    \brief Internal, takes a reserved window out of the pool, Berkelium thread only
+
+    The window is already resized to 1x1 and has about:blank loaded.
+
+    \return
+        0 if no window in the pool finished loading yet, the caller has to create its own window then
+    */
+    static Berkelium::Window* takeWarmWindow();
+
 private:
+    struct PumpThread;
+    struct CreateWarmWindowTask;
+
+    //! entry point of the pump thread
+    static void pumpThreadMain();
+
+    /*!
+    \brief finds the file given resource is loaded from, DefaultResourceProvider only
+
+    \param modificationTime
+        if not 0, receives when the file was last modified
+    */
+    static bool getResourceFilePath(const String& filename, const String& resourceGroup,
+                                    std::string& path, time_t* modificationTime = 0);
+
+    //! drops least recently used payloads until the payload cache fits given capacity
+    static void trimPayloadCache(size_t capacity);
+
+    //! executes all queued tasks, pump thread only
+    static void executeQueuedTasks();
+
+    //! trims the staging arena of the calling thread if it's time or someone asked for it
+    static void maintainStagingArena();
+
+    //! hands all paint packets the pump thread has finished to their widgets, main thread only
+    static void dispatchPaintPackets();
+
+    //! evicts widgets that aren't visible until renderers and textures fit the budgets
+    static void enforceBudgets();
+
+    //! sends the scripts all widgets queued as one script execution per widget
+    static void flushJavascriptQueues();
+
+    //! asks the Berkelium thread to add one window to the warm pool, main thread only
+    static void requestWarmWindow();
+
+    //! creates a blank window and adds it to the warm pool, Berkelium thread only
+    static void createWarmWindow();
+
+    //! destroys all windows in the warm pool, Berkelium thread only
+    static void destroyWarmWindows();
+
+    //! marks the start of a new frame for the scheduler
+    static bool handleRenderQueueStarted(const EventArgs& e);
+
+    //! destroys pooled textures, oldest first, until the pool fits given capacity
+    static void trimTexturePool(size_t capacity);
+
+    //! texture waiting in the pool
+    struct PooledTexture
+    {
+        Texture* d_texture;
+        //! how much memory the texture takes, width * height * 4
+        size_t d_bytes;
+    };
+
+    //! type of the container holding pooled textures, oldest first
+    typedef std::vector<PooledTexture CEGUI_VECTOR_ALLOC(PooledTexture)> TexturePool;
+
+    //! type of the container mapping widget ids to widgets
+    typedef std::map<uint, ChromeWidget*, std::less<uint>
+        CEGUI_MAP_ALLOC(uint, ChromeWidget*)> WidgetMap;
+
     //! internal member variable, if true the system was initialised already
     static bool ds_initialised;
     //! holds Berkelium context that all Berkelium windows share
     static Berkelium::Context* ds_context;
+    //! uploader created by the system, used unless the user sets another one
+    static ChromeTextureUploader* ds_defaultTextureUploader;
+    //! uploader currently in use
+    static ChromeTextureUploader* ds_textureUploader;
+    //! \see ChromeSystem::getRasterCache
+    static ChromeRasterCache* ds_rasterCache;
+    //! if true, Berkelium will be updated on a separate thread
+    static bool ds_threadedUpdateEnabled;
+    //! if true, widgets create their Berkelium windows when they are first shown
+    static bool ds_lazyWindowCreationEnabled;
+    //! how long the pump thread sleeps between Berkelium updates in seconds
+    static float ds_pumpThreadInterval;
+    //! the pump thread and its queues, 0 unless running
+    static PumpThread* ds_pumpThread;
+    //! how many warm windows to keep ready
+    static size_t ds_warmWindowPoolSize;
+    //! how many warm windows there will be once all requested tasks run, the main thread's view of the pool
+    static size_t ds_warmWindowCount;
+    //! registered widgets by id
+    static WidgetMap ds_widgets;
+    //! id the next registered widget gets
+    static uint ds_nextWidgetId;
+
+    //! connection to the default rendering root, tells us when a new frame starts
+    static Event::Connection ds_renderQueueConnection;
+    //! if true, Berkelium has already been updated (or skipped) this frame
+    static bool ds_updatedThisFrame;
+    //! if true, some widget had activity since the last scheduled update
+    static bool ds_activity;
+    //! how many frames there was no activity
+    static uint ds_idleFrames;
+    //! \see ChromeSystem::setIdleFrameThreshold
+    static uint ds_idleFrameThreshold;
+    //! \see ChromeSystem::setIdleUpdateInterval
+    static float ds_idleUpdateInterval;
+    //! \see ChromeSystem::setUpdateTimeBudget
+    static float ds_updateTimeBudget;
+    //! how much time over the budget we spent, skipped frames pay it back
+    static float ds_updateTimeDebt;
+    //! when was Berkelium last updated by the scheduler, in seconds
+    static double ds_lastScheduledUpdateTime;
+
+    //! textures released by widgets, waiting to be reused
+    static TexturePool ds_texturePool;
+    //! total size of pooled textures in bytes
+    static size_t ds_texturePoolSize;
+    //! \see ChromeSystem::setTexturePoolCapacity
+    static size_t ds_texturePoolCapacity;
+    //! \see ChromeSystem::getTexturePoolHits
+    static size_t ds_texturePoolHits;
+    //! \see ChromeSystem::getTexturePoolMisses
+    static size_t ds_texturePoolMisses;
+    //! used to give created textures unique names
+    static uint ds_canvasTextureCounter;
+    //! \see ChromeSystem::setStagingTrimInterval
+    static float ds_stagingTrimInterval;
+    //! \see ChromeSystem::setRendererBudget
+    static uint ds_rendererBudget;
+    //! \see ChromeSystem::setTextureMemoryBudget
+    static size_t ds_textureMemoryBudget;
+    //! how many times a widget was evicted
+    static size_t ds_evictionCount;
+    //! \see ChromeSystem::getJavascriptBytesSent
+    static size_t ds_javascriptBytesSent;
+    //! \see ChromeSystem::setPayloadCacheCapacity
+    static size_t ds_payloadCacheCapacity;
+    //! total size of cached payloads in bytes
+    static size_t ds_payloadCacheSize;
+    //! \see ChromeSystem::getPayloadCacheHits
+    static size_t ds_payloadCacheHits;
+    //! \see ChromeSystem::getPayloadCacheMisses
+    static size_t ds_payloadCacheMisses;
 };
 
 }
@@ -0,0 +1,104 @@
+/***********************************************************************
+    filename:   CEGUIChromeTextureUploader.h
+    created:    16/10/2026
+    author:     Martin Preisler
+*************************************************************************/
+/***************************************************************************
+ *   Copyright (C) 2011 Martin Preisler
+ *
+ *   Permission is hereby granted, free of charge, to any person obtaining
+ *   a copy of this software and associated documentation files (the
+ *   "Software"), to deal in the Software without restriction, including
+ *   without limitation the rights to use, copy, modify, merge, publish,
+ *   distribute, sublicense, and/or sell copies of the Software, and to
+ *   permit persons to whom the Software is furnished to do so, subject to
+ *   the following conditions:
+ *
+ *   The above copyright notice and this permission notice shall be
+ *   included in all copies or substantial portions of the Software.
+ *
+ *   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ *   EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ *   MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ *   IN NO EVENT SHALL THE AUTHORS BE LIABLE FOR ANY CLAIM, DAMAGES OR
+ *   OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+ *   ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ *   OTHER DEALINGS IN THE SOFTWARE.
+ ***************************************************************************/
+
+#ifndef _CEGUIChromeTextureUploader_h_
+#define _CEGUIChromeTextureUploader_h_
+
+#include "CEGUIChromePrerequisites.h"
+#include "CEGUIChromePixelKernels.h"
+#include "CEGUIRect.h"
+
+#include <vector>
+
+namespace CEGUI
+{
+
+class Texture;
+
+/*!
+\brief
+    Uploads pixels with arbitrary row pitch to CEGUI textures
+
+\par
+    CEGUI's Texture::blitFromMemory only accepts tightly packed pixels, so anything with a different row pitch
+    has to be copied to a packed buffer first. This is what the default implementation does.
+    Renderer specific implementations can upload straight from the source without the extra copy.
+
+\see ChromeSystem::setTextureUploader
+*/
+class CHROMED_CEGUI_API ChromeTextureUploader :
+    public AllocatedObject<ChromeTextureUploader>
+{
+public:
+    /*!
+    \brief Constructor
+    */
+    ChromeTextureUploader();
+
+    /*!
+    \brief Destructor
+    */
+    virtual ~ChromeTextureUploader();
+
+    /*!
+    \brief uploads pixels to given area of the texture
+
+    \param texture
+        target texture
+    \param source
+        pointer to the top left pixel of the source, 4 bytes per pixel in the layout
+        returned by ChromeTextureUploader::getPixelLayout
+    \param sourcePitch
+        how many bytes there are between the starts of 2 consecutive rows in the source
+    \param area
+        where in the texture should the pixels go, in pixels
+    */
+    virtual void blitFromMemory(Texture& texture, const void* source, size_t sourcePitch, const Rectf& area);
+
+    /*!
+    \brief retrieves the pixel layout this uploader expects
+
+    Chrome widgets convert their pixels to this layout before uploading them.
+    The default implementation returns ChromePixelKernels::PL_RGBA, that's what Texture::blitFromMemory expects.
+    */
+    virtual ChromePixelKernels::PixelLayout getPixelLayout() const;
+
+    //! releases the packing buffer
+    void releasePackBuffer();
+
+protected:
+    //! type of the packing buffer
+    typedef std::vector<uint8 CEGUI_VECTOR_ALLOC(uint8)> PackBuffer;
+
+    //! buffer we pack rows into when the pitch doesn't match
+    PackBuffer d_packBuffer;
+};
+
+}
+
+#endif
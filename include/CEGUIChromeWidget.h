@@ -30,8 +30,15 @@
 #define _CEGUIChromeWidget_h_
 
 #include "CEGUIChromePrerequisites.h"
+#include "CEGUIChromeDirtyRegion.h"
+#include "CEGUIChromeCanvasSizingPolicy.h"
+#include "CEGUIChromePixelKernels.h"
+#include "CEGUIChromeSystem.h"
 #include "CEGUIWindow.h"
 
+#include <map>
+#include <vector>
+
 namespace Berkelium
 {
     class Window;
@@ -42,6 +49,32 @@ namespace CEGUI
 {
 
 class BerkeliumDelegate;
+class ChromePaintPacket;
+
+/*!
+\brief
+    EventArgs of ChromeWidget::EventHostMessage
+
+\par
+    The data only lives as long as the handler runs, copy it if you need it later.
+*/
+class CHROMED_CEGUI_API ChromeHostMessageEventArgs : public WindowEventArgs
+{
+public:
+    ChromeHostMessageEventArgs(Window* wnd):
+        WindowEventArgs(wnd),
+        d_channel(0),
+        d_data(0),
+        d_size(0)
+    {}
+
+    //! channel the page posted the message to, lets the host tell message types apart
+    uint8 d_channel;
+    //! payload of the message
+    const uint8* d_data;
+    //! size of the payload in bytes
+    size_t d_size;
+};
 
 /*!
 \brief
@@ -58,6 +91,19 @@ public:
         IM_FullInteraction //!< Mouse and Keyboard interaction combined
     };
 
+    //! size of one tile of a tiled rendering canvas in pixels, \see ChromeWidget::setRenderingCanvasTiledEnabled
+    static const uint CanvasTileSize;
+
+    //! namespace for global events
+    static const String EventNamespace;
+
+    /*!
+    \brief fired for every message the page posts through window.ceguiHost.post
+
+    Handlers get ChromeHostMessageEventArgs, \see ChromeWidget::setHostMessagesEnabled
+    */
+    static const String EventHostMessage;
+
     /*!
     \brief Constructor
     */
@@ -92,6 +138,179 @@ public:
     */
     virtual void setTransparencyEnabled(bool enabled);
 
+    /*!
+    \brief creates the Berkelium window if it wasn't created yet
+
+    \par
+        With lazy window creation enabled in ChromeSystem, the window is only created the first time
+        the widget becomes visible. Call this to warm the widget up before that, for example while
+        a loading screen is shown. Everything requested before is replayed once the window exists.
+    */
+    void ensureChromeWindow();
+
+    //! checks whether the Berkelium window was created (or its creation requested) already
+    bool isChromeWindowCreated() const;
+
+    /*!
+    \brief Enables/Disables freezing of static content
+
+    \par
+        A widget in IM_NoInteraction mode whose page has loaded and that hasn't been painted for
+        the freeze delay destroys its Berkelium window, taking the renderer process down with it.
+        The canvas texture keeps showing the last paint. Resizing the widget, changing its content,
+        its transparency or enabling interaction recreates the window transparently.
+
+    \param enabled
+        if true, the widget freezes when static, defaults to false
+    */
+    virtual void setFreezeEnabled(bool enabled);
+
+    /*!
+    \brief checks whether freezing of static content is enabled
+
+    \see ChromeWidget::setFreezeEnabled
+    */
+    bool isFreezeEnabled() const;
+
+    /*!
+    \brief sets for how long painting has to be quiet before the widget freezes
+
+    \param seconds
+        Defaults to 2.0
+    */
+    virtual void setFreezeDelay(float seconds);
+
+    //! retrieves for how long painting has to be quiet before the widget freezes
+    float getFreezeDelay() const;
+
+    //! checks whether the widget is frozen, its Berkelium window is destroyed then
+    bool isFrozen() const;
+
+    //! retrieves when the widget was last drawn, in seconds of a monotonic clock
+    double getLastVisibleTime() const;
+
+    //! retrieves how many bytes the canvas texture (or all canvas tiles) take
+    size_t getTextureMemoryUsage() const;
+
+    //! checks whether the widget was evicted to stay within ChromeSystem budgets
+    bool isEvicted() const;
+
+    /*!
+    \brief Internal, gives up the Berkelium window to stay within ChromeSystem budgets
+
+    \param dropTexture
+        if true, the canvas texture and the shadow buffer are released as well
+
+    Everything is restored and repainted once the widget is visible again.
+    */
+    void evict(bool dropTexture);
+
+    /*!
+    \brief queues a script to run in the page
+
+    \par
+        Queued scripts are concatenated and sent to Chrome as one script execution per widget when
+        ChromeSystem pumps, which is far cheaper than a round trip per call. They wait in the queue
+        until the page has loaded. Each script is evaluated on its own in the global scope, one that doesn't
+        parse or throws is reported to the console and doesn't stop the others. Top level var and function
+        declarations become page globals, top level let, const and class declarations stay local to the script.
+
+    \param script
+        JavaScript code, one or more statements
+    */
+    void queueJavascript(const String& script);
+
+    /*!
+    \brief queues a script to run in the page, replacing the script queued with the same key
+
+    For example updating a binding several times in one frame only sends the last value.
+    The script keeps the place in the queue of the first script queued with that key.
+    */
+    void queueJavascript(const String& key, const String& script);
+
+    //! retrieves how many scripts are waiting in the queue
+    size_t getJavascriptQueueDepth() const;
+
+    //! retrieves how many bytes of scripts are waiting in the queue
+    size_t getJavascriptQueueBytes() const;
+
+    //! retrieves how many bytes of scripts were sent to Chrome when the queue was last flushed
+    size_t getJavascriptBytesSent() const;
+
+    /*!
+    \brief Internal, sends all queued scripts as one script execution, ChromeSystem does this every frame
+
+    \return
+        how many bytes were sent
+    */
+    size_t flushJavascriptQueue();
+
+    //! Internal, appends given UTF-8 text to a script as a single quoted JavaScript string literal
+    static void appendJavascriptString(std::string& script, const char* text, size_t length);
+
+    /*!
+    \brief Enables/Disables messages from the page to the host
+
+    \par
+        When enabled, every page gets window.ceguiHost.post(channel, data) once it loads. Channel is a number
+        in 0 - 255, data a string (sent as UTF-8) or an array of bytes. Messages posted in one go are framed,
+        batched into one external host message and fired as EventHostMessage one by one when ChromeSystem pumps.
+        Frames are 1 byte channel, 4 bytes little endian length and the payload, the receive buffers are reused
+        so steady streams of messages don't allocate.
+
+    \param enabled
+        if true, messages are delivered, defaults to false
+    */
+    void setHostMessagesEnabled(bool enabled);
+
+    //! checks whether messages from the page to the host are delivered
+    bool isHostMessagesEnabled() const;
+
+    //! retrieves how many host messages the page sent in total
+    size_t getHostMessageCount() const;
+
+    //! retrieves how many bytes of host message payloads the page sent in total
+    size_t getHostMessageBytes() const;
+
+    /*!
+    \brief Internal, unpacks a batch of framed host messages and fires an event for each
+    */
+    void onHostMessages(const uint8* data, size_t size);
+
+    /*!
+    \brief Enables/Disables throttling while the widget can't be seen
+
+    \par
+        The widget is hidden from view when it isn't visible, its effective alpha is 0, its parent clips
+        it away entirely or an opaque ChromeWidget sibling in front of it covers it completely.
+        While throttled, paints from Chrome are dropped before they are copied or uploaded.
+        Once the widget can be seen again, one full repaint is requested.
+
+    \param enabled
+        if true, throttling is enabled, defaults to false
+    */
+    virtual void setThrottleWhenHiddenEnabled(bool enabled);
+
+    /*!
+    \brief checks whether throttling while hidden is enabled
+
+    \see ChromeWidget::setThrottleWhenHiddenEnabled
+    */
+    bool isThrottleWhenHiddenEnabled() const;
+
+    //! checks whether paints are currently being dropped because the widget can't be seen
+    bool isThrottled() const;
+
+    //! retrieves how many seconds this widget spent throttled in total
+    double getThrottledTime() const;
+
+    /*!
+    \brief checks whether the widget can't be seen at all
+
+    \see ChromeWidget::setThrottleWhenHiddenEnabled
+    */
+    bool isHiddenFromView() const;
+
     /*!
     \brief sets the rendering detail ratio
 
@@ -111,6 +330,72 @@ public:
     */
     float getRenderingDetailRatio() const;
 
+    /*!
+    \brief gets the rendering detail ratio that is actually used
+
+    This is the rendering detail ratio unless adaptive rendering detail lowered it.
+    */
+    float getEffectiveRenderingDetailRatio() const;
+
+    /*!
+    \brief Enables/Disables adaptive rendering detail
+
+    \par
+        When enabled, the time spent painting and uploading this widget is measured every frame.
+        Once it's over the cost budget, the effective rendering detail ratio drops by a step. When the cost stays
+        under half of the budget for the settle time, it's raised by a step again, up to the rendering detail ratio.
+        Every change resizes the canvas, so after a change the ratio stays put for a short while.
+
+    \param enabled
+        if true, the detail ratio adapts, defaults to false
+    */
+    virtual void setRenderingDetailAdaptiveEnabled(bool enabled);
+
+    /*!
+    \brief checks whether adaptive rendering detail is enabled
+
+    \see ChromeWidget::setRenderingDetailAdaptiveEnabled
+    */
+    bool isRenderingDetailAdaptiveEnabled() const;
+
+    /*!
+    \brief sets how long painting and uploading this widget may take per frame in adaptive rendering detail mode
+
+    \param seconds
+        Defaults to 0.002, 2 milliseconds
+    */
+    virtual void setRenderingDetailCostBudget(float seconds);
+
+    //! retrieves the adaptive rendering detail cost budget in seconds
+    float getRenderingDetailCostBudget() const;
+
+    /*!
+    \brief sets the lowest rendering detail ratio adaptive rendering detail may use
+
+    \param ratio
+        Defaults to 0.5
+    */
+    virtual void setRenderingDetailMinimumRatio(float ratio);
+
+    //! retrieves the lowest rendering detail ratio adaptive rendering detail may use
+    float getRenderingDetailMinimumRatio() const;
+
+    /*!
+    \brief sets how long the cost has to stay low before adaptive rendering detail raises the ratio
+
+    \param seconds
+        Defaults to 1.0
+    */
+    virtual void setRenderingDetailSettleTime(float seconds);
+
+    //! retrieves how long the cost has to stay low before adaptive rendering detail raises the ratio
+    float getRenderingDetailSettleTime() const;
+
+    /*!
+    \brief retrieves the smoothed time per frame spent painting and uploading this widget, in seconds
+    */
+    float getRenderingPaintCost() const;
+
     /*!
     \brief Sets the time in which the rendering will be resized to match widget's size
 
@@ -130,40 +415,137 @@ public:
     float getRenderingResizeDelay() const;
 
     /*!
-    \brief how big a reserve should be allocated as a ratio
+    \brief retrieves the policy deciding how big the canvas texture is and when it's reallocated
+
+    Changes to the policy take effect the next time the canvas is resized.
+    */
+    ChromeCanvasSizingPolicy& getRenderingCanvasSizingPolicy();
+
+    //! \copydoc ChromeWidget::getRenderingCanvasSizingPolicy
+    const ChromeCanvasSizingPolicy& getRenderingCanvasSizingPolicy() const;
+
+    //! \see ChromeCanvasSizingPolicy::setQuantum
+    virtual void setRenderingCanvasSizeQuantum(uint pixels);
+
+    //! \see ChromeCanvasSizingPolicy::getQuantum
+    uint getRenderingCanvasSizeQuantum() const;
+
+    //! \see ChromeCanvasSizingPolicy::setPowerOfTwoEnabled
+    virtual void setRenderingCanvasSizePowerOfTwo(bool enabled);
 
-    You want to leave this at 0.0 for widgets that will never resize, it helps to have reserve with often resizing widgets.
+    //! \see ChromeCanvasSizingPolicy::isPowerOfTwoEnabled
+    bool isRenderingCanvasSizePowerOfTwo() const;
 
-    Be aware that this must play well with RenderingCanvasOverhead because it his ratio is bigger than the allowed overhead,
-    you will trigger an infinite loop! And you have to make sure that doesn't happen, there are no checks for this!!
+    //! \see ChromeCanvasSizingPolicy::setGrowHeadroom
+    virtual void setRenderingCanvasGrowHeadroom(float ratio);
+
+    //! \see ChromeCanvasSizingPolicy::getGrowHeadroom
+    float getRenderingCanvasGrowHeadroom() const;
+
+    //! \see ChromeCanvasSizingPolicy::setShrinkThreshold
+    virtual void setRenderingCanvasShrinkThreshold(float ratio);
+
+    //! \see ChromeCanvasSizingPolicy::getShrinkThreshold
+    float getRenderingCanvasShrinkThreshold() const;
+
+    //! \see ChromeCanvasSizingPolicy::setShrinkDelay
+    virtual void setRenderingCanvasShrinkDelay(float seconds);
+
+    //! \see ChromeCanvasSizingPolicy::getShrinkDelay
+    float getRenderingCanvasShrinkDelay() const;
+
+    /*!
+    \brief retrieves how many times the canvas texture had to be reallocated since the widget was created
+    */
+    size_t getRenderingCanvasReallocationCount() const;
+
+    /*!
+    \brief how much of the canvas has to be dirty before it's all uploaded in one go
+
+    Painted areas are accumulated and uploaded to the canvas texture when the widget is drawn. Overlapping
+    and neighbouring areas are merged, once they cover this ratio of the canvas, the whole canvas is uploaded at once.
 
     \param ratio
-        The actual reserve allocated is pixel size * ratio. If this is 0.1, 10% more than necessary is allocated. Defaults to 0.0, no reserve.
+        Defaults to 0.75, meaning that if 75% of the canvas is dirty, we upload all of it. 1.0 disables this.
     */
-    virtual void setRenderingCanvasReserve(float ratio);
+    virtual void setRenderingCanvasFullUploadThreshold(float ratio);
 
     /*!
-    \brief retrieves the rendering canvas reserve ratio
+    \brief retrieves the rendering canvas full upload threshold
     */
-    float getRenderingCanvasReserve() const;
+    float getRenderingCanvasFullUploadThreshold() const;
 
     /*!
-    \brief how big an overhead is tolerated before our canvas texture will be recreated to shrink it
+    \brief Enables/Disables the CPU side shadow copy of the rendering canvas
 
-    Default is 0.2, meaning if the texture is 20% bigger than it should be (any of its sizes), we recreate it with a smaller size
+    With the shadow buffer, all painting and scrolling happens in system memory and only the changed
+    areas are uploaded, the canvas texture is never read back. This costs width * height * 4 bytes.
 
-    Be aware that this must play well with RenderingCanvasOverhead because it his ratio is bigger than the allowed overhead,
-    you will trigger an infinite loop! And you have to make sure that doesn't happen, there are no checks for this!!
+    Without it, paints are uploaded right away and every scroll reads the whole texture back, which
+    stalls GPU renderers. Merging of painted areas isn't possible either.
 
-    \param ratio
-        The actual max overhead allowed is pixel size * ratio. If this is 0.2, 20% more than necessary is still allowed, any more and we will shrink the texture.
+    \param enabled
+        if true, the shadow buffer is used (default)
     */
-    virtual void setRenderingCanvasMaxOverhead(float ratio);
+    virtual void setRenderingCanvasShadowBufferEnabled(bool enabled);
 
     /*!
-    \brief retrieves the rendering canvas max overhead
+    \brief checks whether the rendering canvas shadow buffer is used
+
+    \see ChromeWidget::setRenderingCanvasShadowBufferEnabled
     */
-    float getRenderingCanvasMaxOverhead() const;
+    bool isRenderingCanvasShadowBufferEnabled() const;
+
+    /*!
+    \brief Enables/Disables ring scrolling of the rendering canvas
+
+    With ring scrolling, the canvas texture wraps around its edges and scrolling the page just moves
+    the origin of the canvas within the texture. Only the newly exposed strip is uploaded, so the cost
+    of scrolling depends on the scroll distance, not on the canvas size. The canvas is drawn in up to
+    4 pieces when it wraps.
+
+    This needs the shadow buffer, it has no effect when the shadow buffer is disabled.
+
+    \param enabled
+        if true, ring scrolling is used, defaults to false
+    */
+    virtual void setRenderingCanvasRingScrollEnabled(bool enabled);
+
+    /*!
+    \brief checks whether ring scrolling of the rendering canvas is enabled
+
+    \see ChromeWidget::setRenderingCanvasRingScrollEnabled
+    */
+    bool isRenderingCanvasRingScrollEnabled() const;
+
+    /*!
+    \brief Enables/Disables the tiled rendering canvas
+
+    A tiled canvas is made of CanvasTileSize x CanvasTileSize textures instead of one big texture. When the
+    widget is resized, only tiles on the edges are created or destroyed, the rest and their content is kept,
+    so the cost of a resize depends on how much the size changed, not on the size itself. Paints are split
+    between the tiles they touch and every tile is drawn as a separate quad.
+
+    This needs the shadow buffer, it has no effect when the shadow buffer is disabled. Ring scrolling
+    isn't used with a tiled canvas. With rendering detail ratio other than 1.0, tile edges may be visible
+    because the texture filtering can't sample across tiles.
+
+    \param enabled
+        if true, the canvas is tiled, defaults to false
+    */
+    virtual void setRenderingCanvasTiledEnabled(bool enabled);
+
+    /*!
+    \brief checks whether the rendering canvas is tiled
+
+    \see ChromeWidget::setRenderingCanvasTiledEnabled
+    */
+    bool isRenderingCanvasTiledEnabled() const;
+
+    /*!
+    \brief retrieves how many canvas texture uploads were saved by merging painted areas since the widget was created
+    */
+    size_t getRenderingCanvasUploadsSaved() const;
 
     /*!
     \brief sets the colour rect that will affect the rendering (just like any other CEGUI widget)
@@ -192,6 +574,13 @@ public:
         int dx, int dy,
         const Berkelium::Rect &scrollRect);
 
+    /*!
+    \brief Internal, don't use!
+
+    Queues a paint packet delivered from the Berkelium pump thread, it will be applied when the widget is drawn
+    */
+    void queuePaintPacket(ChromePaintPacket* packet);
+
 protected:
     //! \copydoc Window::onActivated
     virtual void onActivated(ActivationEventArgs& e);
@@ -199,6 +588,15 @@ protected:
     //! \copydoc Window::onDeactivated
     virtual void onDeactivated(ActivationEventArgs& e);
 
+    //! handler called when the page posts a host message
+    virtual void onHostMessage(ChromeHostMessageEventArgs& e);
+
+    //! \copydoc Window::onShown
+    virtual void onShown(WindowEventArgs& e);
+
+    //! \copydoc Window::onHidden
+    virtual void onHidden(WindowEventArgs& e);
+
     //! \copydoc Window::onSized
     virtual void onSized(WindowEventArgs& e);
 
@@ -217,18 +615,163 @@ protected:
     //! \copydoc Window::drawSelf
     virtual void drawSelf(const RenderingContext& ctx);
 
+    /*!
+    \brief
+        Internal method, updates the paint cost and adapts the rendering detail ratio to it
+    */
+    void updateAdaptiveRenderingDetail(float elapsed);
+
+    /*!
+    \brief
+        Internal method, freezes the widget once its content has been static for long enough
+    */
+    void updateFreezing(float elapsed);
+
+    /*!
+    \brief
+        Internal method, recreates the Berkelium window if the widget is frozen
+    */
+    void thaw();
+
+    /*!
+    \brief
+        Internal method, destroys the Berkelium window, the widget is frozen afterwards
+    */
+    void releaseChromeWindow();
+
+    /*!
+    \brief
+        Internal method, checks whether Chrome loaded the page and painted all of it into the canvas
+
+    The canvas has to be quiet for the freeze delay, \see ChromeWidget::setFreezeDelay.
+    */
+    bool isRenderingCanvasSettled() const;
+
+    /*!
+    \brief
+        Internal method, lets subclasses fill a freshly resized canvas without Chrome
+
+    Called whenever the canvas loses its content. If the canvas gets filled, return true. The widget
+    is frozen then and Chrome isn't asked to paint until it's thawed, unless freezing is disabled or
+    the widget takes input, \see ChromeWidget::updateFreezing.
+    */
+    virtual bool restoreRenderingCanvas();
+
+    /*!
+    \brief
+        Internal method, called every update while the canvas is settled and Chrome is still attached
+
+    Runs before the widget freezes and releases its Chrome window, \see ChromeWidget::isRenderingCanvasSettled
+    */
+    virtual void onRenderingCanvasSettled();
+
+    /*!
+    \brief
+        Internal method, brings back whatever ChromeWidget::evict released
+    */
+    void restoreEvicted();
+
+    /*!
+    \brief
+        Internal method, checks whether this widget fully hides whatever is behind it
+    */
+    bool isOpaque() const;
+
+    /*!
+    \brief
+        Internal method, starts or stops throttling depending on whether the widget can be seen
+    */
+    void updateThrottling();
+
     //! which interaction mode is currently used
     InteractionMode d_interactionMode;
     //! rendering detail ratio
     float d_renderingDetailRatio;
+    //! rendering detail ratio that is actually used, differs only in adaptive mode
+    float d_effectiveRenderingDetailRatio;
+    //! if true, d_effectiveRenderingDetailRatio adapts to the paint cost
+    bool d_renderingDetailAdaptiveEnabled;
+    //! \see ChromeWidget::setRenderingDetailCostBudget
+    float d_renderingDetailCostBudget;
+    //! \see ChromeWidget::setRenderingDetailMinimumRatio
+    float d_renderingDetailMinimumRatio;
+    //! \see ChromeWidget::setRenderingDetailSettleTime
+    float d_renderingDetailSettleTime;
+    //! time spent painting and uploading since the last update, in seconds
+    double d_paintCostAccumulator;
+    //! smoothed time per frame spent painting and uploading, in seconds
+    float d_paintCost;
+    //! for how long the paint cost has been low enough to raise the detail
+    float d_renderingDetailSettleTimer;
+    //! time left before the adaptive detail may change again
+    float d_renderingDetailCooldown;
     //! rendering resize delay in seconds
     float d_renderingResizeDelay;
-    //! rendering canvas size reserve
-    float d_renderingCanvasReserve;
-    //! rendering canvas size max overhead
-    float d_renderingCanvasMaxOverhead;
+    //! decides how big the canvas texture is and when it's reallocated
+    ChromeCanvasSizingPolicy d_canvasSizingPolicy;
     //! colour rect affecting the output
     ColourRect d_colourRect;
+    //! if true, Chrome renders with transparent background
+    bool d_transparencyEnabled;
+    //! if true, the Berkelium window was created or its creation was requested
+    bool d_chromeWindowCreated;
+    //! \see ChromeWidget::setFreezeEnabled
+    bool d_freezeEnabled;
+    //! \see ChromeWidget::setFreezeDelay
+    float d_freezeDelay;
+    //! if true, the Berkelium window was destroyed and the canvas shows the last paint
+    bool d_frozen;
+    //! seconds since Chrome last painted or was asked to navigate
+    float d_paintQuietTime;
+    //! if true, the widget gave up its window (and possibly canvas) to stay within budgets
+    bool d_evicted;
+    //! \see ChromeWidget::getLastVisibleTime
+    double d_lastVisibleTime;
+
+    //! a script waiting to be sent to Chrome
+    struct JavascriptCommand
+    {
+        //! empty for scripts queued without a key
+        std::string d_key;
+        std::string d_script;
+    };
+
+    //! type of the container holding queued scripts
+    typedef std::vector<JavascriptCommand CEGUI_VECTOR_ALLOC(JavascriptCommand)> JavascriptQueue;
+    //! type of the container mapping script keys to their place in the queue
+    typedef std::map<std::string, size_t, std::less<std::string>
+        CEGUI_MAP_ALLOC(std::string, size_t)> JavascriptQueueKeyMap;
+
+    //! scripts waiting to be sent to Chrome, in the order they were queued
+    JavascriptQueue d_javascriptQueue;
+    //! maps keys to indices in d_javascriptQueue
+    JavascriptQueueKeyMap d_javascriptQueueKeys;
+    //! \see ChromeWidget::getJavascriptQueueBytes
+    size_t d_javascriptQueueBytes;
+    //! \see ChromeWidget::getJavascriptBytesSent
+    size_t d_javascriptBytesSent;
+    //! \see ChromeWidget::setHostMessagesEnabled
+    bool d_hostMessagesEnabled;
+    //! \see ChromeWidget::getHostMessageCount
+    size_t d_hostMessageCount;
+    //! \see ChromeWidget::getHostMessageBytes
+    size_t d_hostMessageBytes;
+    //! hash of the cached payload the widget navigated to last, 0 if it navigated anywhere else
+    ChromeSystem::PayloadHash d_payloadHash;
+    //! serial of the payload cache entry the widget navigated to last, 0 if it navigated anywhere else
+    uint d_payloadSerial;
+    //! incremented by every navigation, main thread only, 0 until the first one
+    uint d_navigationGeneration;
+    //! if true, a recreated window needs the URL from ChromeWidget::onDeferredNavigationNeeded
+    bool d_navigationDeferred;
+    //! \see ChromeWidget::setThrottleWhenHiddenEnabled
+    bool d_throttleWhenHiddenEnabled;
+    //! if true, paints are being dropped because the widget can't be seen
+    bool d_throttled;
+    //! when the current throttling started, only valid while throttled
+    double d_throttleStartTime;
+    //! seconds spent throttled, not including the current throttling
+    double d_throttledTime;
 
     //! timer to handle rendering resizes
     float d_renderingResizeTimer;
@@ -237,14 +780,44 @@ protected:
 
     //! where should chrome output to
     Texture* d_renderOutputTexture;
-    //! Berkelium window that does all the dirty (and hard) work
-    Berkelium::Window* d_chromeWindow;
-    //! the delegate that blits the texture (basically pimpl)
+    //! \see ChromeWidget::setNativeContentTexture
+    Texture* d_nativeContentTexture;
+    //! identifies this widget in ChromeSystem
+    uint d_widgetId;
+    //! the delegate that blits the texture and owns the Berkelium window (basically pimpl)
     BerkeliumDelegate* d_berkeliumDelegate;
-    //! a buffer we use to store scroll data when painting the canvas
-    char* d_scrollBuffer;
-    //! if true, we will ignore partial canvas painting and only let full repaint through
-    bool d_ignorePartialPaint;
+    //! paint packets delivered from the pump thread that haven't been applied yet
+    std::vector<ChromePaintPacket* CEGUI_VECTOR_ALLOC(ChromePaintPacket*)> d_pendingPaintPackets;
+    //! if true, we keep a CPU side copy of the canvas texture
+    bool d_renderingCanvasShadowBufferEnabled;
+    //! CPU side copy of the canvas texture, all painting goes here first (0 if disabled)
+    uint8* d_canvasBuffer;
+    //! size of d_canvasBuffer in bytes
+    size_t d_canvasBufferSize;
+    //! areas of the canvas buffer that haven't been uploaded to the canvas texture yet
+    ChromeDirtyRegion d_canvasDirtyRegion;
+    //! how many texture uploads were saved thanks to merging dirty areas
+    size_t d_canvasUploadsSaved;
+    //! if true, the canvas wraps around the texture edges and scrolling moves its origin
+    bool d_renderingCanvasRingScrollEnabled;
+    //! where in the texture the top left corner of the canvas is, only non zero when ring scrolling
+    int d_canvasRingOffsetX;
+    //! \see ChromeWidget::d_canvasRingOffsetX
+    int d_canvasRingOffsetY;
+
+    //! type of the container holding canvas tiles
+    typedef std::vector<Texture* CEGUI_VECTOR_ALLOC(Texture*)> TileList;
+
+    //! if true, the canvas is made of tiles when the shadow buffer is enabled
+    bool d_renderingCanvasTiledEnabled;
+    //! tiles of the canvas in rows, empty unless the canvas is tiled (d_renderOutputTexture is 0 then)
+    TileList d_canvasTiles;
+    //! how many columns of tiles there are
+    size_t d_canvasTileColumns;
+    //! how many rows of tiles there are
+    size_t d_canvasTileRows;
+    //! size of the canvas texture, or of the whole tile grid if tiled, in pixels
+    Sizef d_canvasTextureSize;
 
     /*!
     \brief
@@ -252,8 +825,312 @@ protected:
     */
     virtual void resizeRenderingCanvas();
 
-    //! internal method used for the data URI
-    static void base64_encode(String& ret, uint8 const* bytes_to_encode, size_t in_len);
+    /*!
+    \brief
+        Internal method, checks whether the canvas texture (or tiles) exists
+    */
+    bool hasRenderingCanvas() const;
+
+    /*!
+    \brief
+        Internal method, creates and destroys edge tiles so that the grid covers given canvas size
+
+    Passing an empty size destroys all tiles.
+    */
+    void resizeCanvasTiles(const Sizef& canvasSize);
+
+    /*!
+    \brief
+        Internal method, uploads pixels to given area of the canvas texture, or the tiles it touches
+
+    \param area
+        where in the texture (or tile grid) should the pixels go, in pixels
+    */
+    void uploadTextureRect(const uint8* source, size_t sourcePitch, const Rectf& area);
+
+    /*!
+    \brief
+        Internal method, fills the geometry buffer with one quad per tile
+    */
+    void populateTiledGeometryBuffer(const ColourRect& colourRect);
+
+    /*!
+    \brief
+        Internal method, fills the geometry buffer with the native content texture
+    */
+    void populateNativeGeometryBuffer();
+
+    /*!
+    \brief
+        Internal method, navigates the Berkelium window to given URL
+
+    Use this instead of touching Berkelium directly, Berkelium may be owned by another thread.
+    */
+    void navigateTo(const char* url, size_t length);
+
+    /*!
+    \brief
+        Internal method, makes a recreated Berkelium window show given URL without navigating now
+
+    Use this after changing the page in place, otherwise a frozen or evicted widget would come back
+    with the content it had before the change.
+    */
+    void rememberNavigation(const char* url, size_t length);
+
+    /*!
+    \brief
+        Internal method, like ChromeWidget::rememberNavigation but the URL is only asked for
+        when a Berkelium window gets recreated
+
+    Use this after changing the page in place when building the URL costs as much as the content,
+    ChromeWidget::onDeferredNavigationNeeded is called before the window is created again.
+    */
+    void deferNavigation();
+
+    /*!
+    \brief
+        Internal method, called right before a Berkelium window is recreated after ChromeWidget::deferNavigation
+
+    Implementations call ChromeWidget::rememberNavigation, the default implementation does nothing.
+    */
+    virtual void onDeferredNavigationNeeded();
+
+    /*!
+    \brief
+        Internal method, checks whether the page loaded something by itself since the widget last navigated
+
+    Following a link or changing location in a script does this, what the widget navigated to isn't shown then.
+    */
+    bool hasPageNavigatedAway() const;
+
+    /*!
+    \brief
+        Internal method, runs given UTF-8 script in the current page
+
+    The script is dropped if there is no Berkelium window, check ChromeWidget::isChromeContentLoaded first.
+    */
+    void executeJavascript(const char* script, size_t length);
+
+    /*!
+    \brief
+        Internal method, checks whether there is a live Berkelium window that finished loading its page
+
+    A navigation that hasn't reached Berkelium yet counts as not loaded.
+    */
+    bool isChromeContentLoaded() const;
+
+    /*!
+    \brief
+        Internal method, retrieves a number that changes with every navigation
+
+    Use it to tell whether the page is still the one some state was recorded for.
+    */
+    uint getNavigationGeneration() const;
+
+    /*!
+    \brief
+        Internal method, makes the widget draw given texture instead of Chrome's output
+
+    While set, there is no Berkelium window and no canvas. The texture is drawn at its original
+    size in the top left corner, shrunk to fit the widget if it's bigger, just like Chrome shows
+    images. Navigating anywhere unsets it.
+
+    \param texture
+        texture to draw, it isn't owned by the widget, 0 brings Chrome back
+    */
+    void setNativeContentTexture(Texture* texture);
+
+    //! Internal method, retrieves the texture drawn instead of Chrome's output, 0 if there is none
+    Texture* getNativeContentTexture() const;
+
+    /*!
+    \brief
+        Internal method, called when the native content texture is replaced or unset
+
+    Subclasses owning the texture can destroy it here.
+    */
+    virtual void onNativeContentTextureReleased(Texture& texture);
+
+    /*!
+    \brief
+        Internal method, gives up the canvas textures and the shadow buffer
+
+    \param destroyTextures
+        if true, the textures are destroyed instead of going to the texture pool
+    */
+    void releaseRenderingCanvas(bool destroyTextures = false);
+
+    /*!
+    \brief
+        Internal method, applies paint packets delivered from the pump thread
+    */
+    void applyPendingPaintPackets();
+
+    /*!
+    \brief
+        Internal method, applies a paint delivered from the pump thread
+    */
+    void onPaint(const ChromePaintPacket& packet);
+
+    /*!
+    \brief
+        Internal method, scrolls the canvas the way Chrome told us to
+
+    \param scrollRect
+        the area that is being scrolled, in canvas pixels
+    */
+    void scrollCanvas(const Rectf& scrollRect, int dx, int dy);
+
+    /*!
+    \brief
+        Internal method, figures out how to convert Chrome's pixels for the texture uploader
+    */
+    ChromePixelKernels::Conversion getCanvasPixelConversion() const;
+
+    /*!
+    \brief
+        Internal method, copies given pixels to the canvas buffer and marks the area dirty,
+        uploads them right away if there is no canvas buffer
+
+    \param source
+        pointer to the top left pixel of the area
+    \param sourcePitch
+        how many bytes there are between the starts of 2 consecutive rows in the source
+    \param area
+        where in the canvas should the pixels go, gets clipped to the canvas buffer
+    \param conversion
+        how to convert the pixels on the way, PC_Copy for pixels that come from the canvas itself
+    */
+    void writeCanvasRect(const uint8* source, size_t sourcePitch, const Rectf& area,
+                         ChromePixelKernels::Conversion conversion);
+
+    /*!
+    \brief
+        Internal method, copies pixels to given area of the texture (or the canvas buffer if we have it)
+
+    Unlike ChromeWidget::writeCanvasRect, the area is in texture pixels and is expected to fit
+    */
+    void writeTextureRect(const uint8* source, size_t sourcePitch, const Rectf& area,
+                          ChromePixelKernels::Conversion conversion);
+
+    /*!
+    \brief
+        Internal method, copies given area of the canvas buffer out to destination
+    */
+    void readCanvasRect(uint8* destination, size_t destinationPitch, const Rectf& area) const;
+
+    /*!
+    \brief
+        Internal method, marks given area of the canvas dirty
+    */
+    void markCanvasDirty(const Rectf& area);
+
+    /*!
+    \brief
+        Internal method, maps given canvas area to the texture
+
+    When ring scrolling, the area can wrap around the texture edges, so it is split to up to 4 pieces.
+
+    \param canvasPieces
+        array of at least 4 rects, receives the pieces in canvas pixels
+    \param texturePieces
+        array of at least 4 rects, receives the pieces in texture pixels
+
+    \return
+        number of pieces
+    */
+    size_t mapCanvasRect(const Rectf& area, Rectf* canvasPieces, Rectf* texturePieces) const;
+
+    /*!
+    \brief
+        Internal method, checks whether the canvas currently wraps around the texture like a ring
+    */
+    bool isRenderingCanvasRingActive() const;
+
+    /*!
+    \brief
+        Internal method, moves given area of the canvas by dx, dy pixels
+    */
+    void scrollCanvasRect(const Rectf& area, int dx, int dy);
+
+    /*!
+    \brief
+        Internal method, moves one row of the canvas buffer by dx, dy pixels
+    */
+    void moveCanvasRow(int y, int left, int right, int dx, int dy);
+
+    /*!
+    \brief
+        Internal method, scrolls given area of the canvas by moving the ring origin
+    */
+    void scrollCanvasRing(const Rectf& area, int dx, int dy);
+
+    /*!
+    \brief
+        Internal method, uploads all dirty areas of the canvas buffer to the canvas texture
+    */
+    void flushCanvas();
+
+    /*!
+    \brief
+        Internal method, uploads given area of the canvas buffer to the canvas texture
+    */
+    void uploadCanvasRect(const Rectf& area);
+
+    /*!
+    \brief
+        Internal method, builds a data URI in the staging arena
+
+    \param header
+        everything before the base64 encoded data, for example "data:image/png;base64,"
+    \param length
+        receives the length of the URI, there is no terminating zero
+
+    \return
+        the URI, valid until the staging arena is used again
+    */
+    static const char* buildDataURI(const char* header, const uint8* data, size_t size, size_t& length);
+
+    /*!
+    \brief
+        Internal method, navigates to given resource
+
+    The resource is loaded from a file:// URL when possible, \see ChromeSystem::getResourceFileURL.
+    Otherwise it's loaded by the ResourceProvider and passed as a data URI.
+
+    \param mimeType
+        if not 0, the resource is always passed as a data URI with this mime type
+    */
+    void navigateToResource(const String& filename, const String& resourceGroup, const char* mimeType = 0);
+
+    /*!
+    \brief
+        Internal method, navigates to a payload from the payload cache
+
+    Nothing happens if the widget is displaying that payload already.
+
+    \return
+        false if the payload isn't cached
+    */
+    bool navigateToCachedPayload(ChromeSystem::PayloadHash hash);
+
+    /*!
+    \brief
+        Internal method, navigates to a payload found in or just stored to the payload cache
+
+    Nothing happens if the widget is displaying that cache entry already.
+    */
+    void navigateToPayload(ChromeSystem::PayloadHash hash, uint serial, const std::string& payload);
+
+    /*!
+    \brief
+        Internal method, navigates to a data URI holding given data base64 encoded
+
+    The data URI is shared with other widgets through the payload cache, \see ChromeSystem::setPayloadCacheCapacity.
+
+    \see ChromeWidget::buildDataURI
+    */
+    void navigateToData(const char* header, const uint8* data, size_t size);
 
 	/*!
 	\brief
@@ -0,0 +1,279 @@
+/***********************************************************************
+    filename:   CEGUIChromeBase64.cpp
+    created:    16/10/2026
+    author:     Martin Preisler
+*************************************************************************/
+/***************************************************************************
+ *   Copyright (C) 2011 Martin Preisler
+ *
+ *   Permission is hereby granted, free of charge, to any person obtaining
+ *   a copy of this software and associated documentation files (the
+ *   "Software"), to deal in the Software without restriction, including
+ *   without limitation the rights to use, copy, modify, merge, publish,
+ *   distribute, sublicense, and/or sell copies of the Software, and to
+ *   permit persons to whom the Software is furnished to do so, subject to
+ *   the following conditions:
+ *
+ *   The above copyright notice and this permission notice shall be
+ *   included in all copies or substantial portions of the Software.
+ *
+ *   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ *   EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ *   MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ *   IN NO EVENT SHALL THE AUTHORS BE LIABLE FOR ANY CLAIM, DAMAGES OR
+ *   OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+ *   ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ *   OTHER DEALINGS IN THE SOFTWARE.
+ ***************************************************************************/
+
+#include "CEGUIChromeBase64.h"
+#include "CEGUIChromeCPUFeatures.h"
+
+#include <mutex>
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86)
+#   define CHROMED_CEGUI_X86
+#   include <immintrin.h>
+#endif
+
+// lets us use SSSE3 and AVX2 intrinsics in chosen functions without compiling everything for them
+#if defined(CHROMED_CEGUI_X86) && (defined(__GNUC__) || defined(__clang__))
+#   define CHROMED_CEGUI_TARGET_SSSE3 __attribute__((target("ssse3")))
+#   define CHROMED_CEGUI_TARGET_AVX2 __attribute__((target("avx2")))
+#else
+#   define CHROMED_CEGUI_TARGET_SSSE3
+#   define CHROMED_CEGUI_TARGET_AVX2
+#endif
+
+namespace CEGUI
+{
+
+std::atomic<ChromeBase64::InstructionSet> ChromeBase64::ds_instructionSet(ChromeBase64::IS_Scalar);
+//! guards detection of the default instruction set
+static std::once_flag s_detectOnce;
+
+static const char Base64Alphabet[] =
+    "ABCDEFGHIJKLMNOPQRSTUVWXYZ"
+    "abcdefghijklmnopqrstuvwxyz"
+    "0123456789+/";
+
+/*************************************************************************
+    scalar implementation, the reference all others have to match
+*************************************************************************/
+
+//! encodes whatever the vectorised loops left, including the padding
+static void scalarEncode(char* destination, const uint8* source, size_t size)
+{
+    while (size >= 3)
+    {
+        const uint32 triple = (static_cast<uint32>(source[0]) << 16) |
+                              (static_cast<uint32>(source[1]) << 8) |
+                               static_cast<uint32>(source[2]);
+
+        destination[0] = Base64Alphabet[(triple >> 18) & 0x3F];
+        destination[1] = Base64Alphabet[(triple >> 12) & 0x3F];
+        destination[2] = Base64Alphabet[(triple >> 6) & 0x3F];
+        destination[3] = Base64Alphabet[triple & 0x3F];
+
+        destination += 4;
+        source += 3;
+        size -= 3;
+    }
+
+    if (size > 0)
+    {
+        const uint32 triple = (static_cast<uint32>(source[0]) << 16) |
+                              (size > 1 ? static_cast<uint32>(source[1]) << 8 : 0);
+
+        destination[0] = Base64Alphabet[(triple >> 18) & 0x3F];
+        destination[1] = Base64Alphabet[(triple >> 12) & 0x3F];
+        destination[2] = size > 1 ? Base64Alphabet[(triple >> 6) & 0x3F] : '=';
+        destination[3] = '=';
+    }
+}
+
+#ifdef CHROMED_CEGUI_X86
+/*************************************************************************
+    SSSE3 implementation, 12 bytes to 16 characters at a time
+
+    The 12 bytes are spread so that every 32 bit lane holds 3 of them, the
+    4 sextets are moved to their own bytes with multiplies and then turned
+    to characters by adding an offset picked by a shuffle.
+*************************************************************************/
+
+CHROMED_CEGUI_TARGET_SSSE3
+static inline __m128i ssse3SplitSextets(__m128i bytes)
+{
+    bytes = _mm_shuffle_epi8(bytes, _mm_set_epi8(10, 11, 9, 10, 7, 8, 6, 7, 4, 5, 3, 4, 1, 2, 0, 1));
+
+    const __m128i high = _mm_mulhi_epu16(_mm_and_si128(bytes, _mm_set1_epi32(0x0FC0FC00)), _mm_set1_epi32(0x04000040));
+    const __m128i low = _mm_mullo_epi16(_mm_and_si128(bytes, _mm_set1_epi32(0x003F03F0)), _mm_set1_epi32(0x01000010));
+
+    return _mm_or_si128(high, low);
+}
+
+CHROMED_CEGUI_TARGET_SSSE3
+static inline __m128i ssse3TranslateSextets(__m128i sextets)
+{
+    // offsets from a sextet to its character: A-Z, a-z, 0-9 (10 entries), + and /
+    const __m128i offsets = _mm_setr_epi8(65, 71, -4, -4, -4, -4, -4, -4, -4, -4, -4, -4, -19, -16, 0, 0);
+
+    // 0 for A-Z, 1 for a-z, 2 - 11 for digits, 12 for + and 13 for /
+    __m128i indices = _mm_subs_epu8(sextets, _mm_set1_epi8(51));
+    indices = _mm_sub_epi8(indices, _mm_cmpgt_epi8(sextets, _mm_set1_epi8(25)));
+
+    return _mm_add_epi8(sextets, _mm_shuffle_epi8(offsets, indices));
+}
+
+CHROMED_CEGUI_TARGET_SSSE3
+static void ssse3Encode(char* destination, const uint8* source, size_t size)
+{
+    // every load reads 16 bytes but only uses 12, never read past the end
+    while (size >= 16)
+    {
+        const __m128i bytes = _mm_loadu_si128(reinterpret_cast<const __m128i*>(source));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(destination), ssse3TranslateSextets(ssse3SplitSextets(bytes)));
+
+        destination += 16;
+        source += 12;
+        size -= 12;
+    }
+
+    scalarEncode(destination, source, size);
+}
+
+/*************************************************************************
+    AVX2 implementation, 24 bytes to 32 characters at a time, each 128 bit
+    lane does what the SSSE3 implementation does
+*************************************************************************/
+
+CHROMED_CEGUI_TARGET_AVX2
+static void avx2Encode(char* destination, const uint8* source, size_t size)
+{
+    const __m256i shuffle = _mm256_setr_epi8(
+        1, 0, 2, 1, 4, 3, 5, 4, 7, 6, 8, 7, 10, 9, 11, 10,
+        1, 0, 2, 1, 4, 3, 5, 4, 7, 6, 8, 7, 10, 9, 11, 10);
+    const __m256i offsets = _mm256_setr_epi8(
+        65, 71, -4, -4, -4, -4, -4, -4, -4, -4, -4, -4, -19, -16, 0, 0,
+        65, 71, -4, -4, -4, -4, -4, -4, -4, -4, -4, -4, -19, -16, 0, 0);
+
+    // the upper lane loads 16 bytes starting 12 bytes in, never read past the end
+    while (size >= 28)
+    {
+        const __m128i lowLane = _mm_loadu_si128(reinterpret_cast<const __m128i*>(source));
+        const __m128i highLane = _mm_loadu_si128(reinterpret_cast<const __m128i*>(source + 12));
+        __m256i bytes = _mm256_inserti128_si256(_mm256_castsi128_si256(lowLane), highLane, 1);
+
+        bytes = _mm256_shuffle_epi8(bytes, shuffle);
+        const __m256i high = _mm256_mulhi_epu16(_mm256_and_si256(bytes, _mm256_set1_epi32(0x0FC0FC00)),
+                                                _mm256_set1_epi32(0x04000040));
+        const __m256i low = _mm256_mullo_epi16(_mm256_and_si256(bytes, _mm256_set1_epi32(0x003F03F0)),
+                                               _mm256_set1_epi32(0x01000010));
+        const __m256i sextets = _mm256_or_si256(high, low);
+
+        __m256i indices = _mm256_subs_epu8(sextets, _mm256_set1_epi8(51));
+        indices = _mm256_sub_epi8(indices, _mm256_cmpgt_epi8(sextets, _mm256_set1_epi8(25)));
+        const __m256i characters = _mm256_add_epi8(sextets, _mm256_shuffle_epi8(offsets, indices));
+
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(destination), characters);
+
+        destination += 32;
+        source += 24;
+        size -= 24;
+    }
+
+    ssse3Encode(destination, source, size);
+}
+#endif
+
+size_t ChromeBase64::getEncodedSize(size_t size)
+{
+    return (size + 2) / 3 * 4;
+}
+
+void ChromeBase64::encode(char* destination, const uint8* source, size_t size)
+{
+    ensureDetected();
+
+    encode(destination, source, size, ds_instructionSet.load(std::memory_order_relaxed));
+}
+
+bool ChromeBase64::encode(char* destination, const uint8* source, size_t size, InstructionSet instructionSet)
+{
+    if (!isInstructionSetSupported(instructionSet))
+    {
+        return false;
+    }
+
+    switch (instructionSet)
+    {
+    case IS_Scalar:
+        scalarEncode(destination, source, size);
+        return true;
+#ifdef CHROMED_CEGUI_X86
+    case IS_SSSE3:
+        ssse3Encode(destination, source, size);
+        return true;
+    case IS_AVX2:
+        avx2Encode(destination, source, size);
+        return true;
+#endif
+
+    default:
+        return false;
+    }
+}
+
+bool ChromeBase64::isInstructionSetSupported(InstructionSet instructionSet)
+{
+    switch (instructionSet)
+    {
+    case IS_Scalar:
+        return true;
+    case IS_SSSE3:
+        return ChromeCPUFeatures::isSupported(ChromeCPUFeatures::CF_SSSE3);
+    case IS_AVX2:
+        return ChromeCPUFeatures::isSupported(ChromeCPUFeatures::CF_AVX2);
+
+    default:
+        return false;
+    }
+}
+
+ChromeBase64::InstructionSet ChromeBase64::getInstructionSet()
+{
+    ensureDetected();
+
+    return ds_instructionSet.load(std::memory_order_relaxed);
+}
+
+void ChromeBase64::setInstructionSet(InstructionSet instructionSet)
+{
+    // detection must not overwrite the override later
+    ensureDetected();
+
+    ds_instructionSet.store(isInstructionSetSupported(instructionSet) ? instructionSet : IS_Scalar,
+                            std::memory_order_relaxed);
+}
+
+void ChromeBase64::ensureDetected()
+{
+    // ChromeCPUFeatures only probes the CPU once
+    std::call_once(s_detectOnce, []()
+    {
+        InstructionSet instructionSet = IS_Scalar;
+
+        if (isInstructionSetSupported(IS_AVX2))
+        {
+            instructionSet = IS_AVX2;
+        }
+        else if (isInstructionSetSupported(IS_SSSE3))
+        {
+            instructionSet = IS_SSSE3;
+        }
+
+        ds_instructionSet.store(instructionSet, std::memory_order_relaxed);
+    });
+}
+
+}
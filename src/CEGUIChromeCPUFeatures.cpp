@@ -0,0 +1,152 @@
+/***********************************************************************
+    filename:   CEGUIChromeCPUFeatures.cpp
+    created:    16/10/2026
+    author:     Martin Preisler
+*************************************************************************/
+/***************************************************************************
+ *   Copyright (C) 2011 Martin Preisler
+ *
+ *   Permission is hereby granted, free of charge, to any person obtaining
+ *   a copy of this software and associated documentation files (the
+ *   "Software"), to deal in the Software without restriction, including
+ *   without limitation the rights to use, copy, modify, merge, publish,
+ *   distribute, sublicense, and/or sell copies of the Software, and to
+ *   permit persons to whom the Software is furnished to do so, subject to
+ *   the following conditions:
+ *
+ *   The above copyright notice and this permission notice shall be
+ *   included in all copies or substantial portions of the Software.
+ *
+ *   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ *   EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ *   MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ *   IN NO EVENT SHALL THE AUTHORS BE LIABLE FOR ANY CLAIM, DAMAGES OR
+ *   OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+ *   ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ *   OTHER DEALINGS IN THE SOFTWARE.
+ ***************************************************************************/
+
+
+#include "CEGUIChromeCPUFeatures.h"
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86)
+#   define CHROMED_CEGUI_X86
+#   if defined(_MSC_VER)
+#       include <intrin.h>
+#       include <immintrin.h>
+#   else
+#       include <cpuid.h>
+#   endif
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+#   define CHROMED_CEGUI_NEON
+#endif
+
+namespace CEGUI
+{
+
+#ifdef CHROMED_CEGUI_X86
+//! CPUID wrapper, returns false if the leaf isn't supported
+static bool getCPUID(unsigned int leaf, unsigned int subleaf, unsigned int registers[4])
+{
+#if defined(_MSC_VER)
+    int info[4];
+    __cpuid(info, 0);
+    if (static_cast<unsigned int>(info[0]) < leaf)
+    {
+        return false;
+    }
+
+    __cpuidex(info, static_cast<int>(leaf), static_cast<int>(subleaf));
+    for (int i = 0; i < 4; ++i)
+    {
+        registers[i] = static_cast<unsigned int>(info[i]);
+    }
+
+    return true;
+#else
+    if (__get_cpuid_max(0, 0) < leaf)
+    {
+        return false;
+    }
+
+    __cpuid_count(leaf, subleaf, registers[0], registers[1], registers[2], registers[3]);
+    return true;
+#endif
+}
+
+//! checks whether the OS saves YMM registers on context switch
+static bool isAVXStateEnabled()
+{
+#if defined(_MSC_VER)
+    return (_xgetbv(0) & 0x6) == 0x6;
+#else
+    unsigned int eax, edx;
+    __asm__ __volatile__("xgetbv" : "=a" (eax), "=d" (edx) : "c" (0));
+    return (eax & 0x6) == 0x6;
+#endif
+}
+#endif
+
+//! probes the CPU for given feature, CPUID is slow, \see getSupportedFeatures
+static bool probeFeature(ChromeCPUFeatures::Feature feature)
+{
+    switch (feature)
+    {
+#ifdef CHROMED_CEGUI_X86
+    case ChromeCPUFeatures::CF_SSE2:
+    {
+        unsigned int registers[4];
+        return getCPUID(1, 0, registers) && (registers[3] & (1u << 26)) != 0;
+    }
+    case ChromeCPUFeatures::CF_SSSE3:
+    {
+        unsigned int registers[4];
+        return getCPUID(1, 0, registers) && (registers[2] & (1u << 9)) != 0;
+    }
+    case ChromeCPUFeatures::CF_AVX2:
+    {
+        unsigned int registers[4];
+        // AVX2 needs the OS to save YMM registers (OSXSAVE + XCR0) on top of the CPU supporting it
+        if (!getCPUID(1, 0, registers) || (registers[2] & (1u << 27)) == 0 || !isAVXStateEnabled())
+        {
+            return false;
+        }
+
+        return getCPUID(7, 0, registers) && (registers[1] & (1u << 5)) != 0;
+    }
+#endif
+
+#ifdef CHROMED_CEGUI_NEON
+    case ChromeCPUFeatures::CF_NEON:
+        return true;
+#endif
+
+    default:
+        return false;
+    }
+}
+
+//! probes all features, returns a bit mask with 1 << Feature set for every supported one
+static uint detectSupportedFeatures()
+{
+    uint ret = 0;
+    for (uint i = ChromeCPUFeatures::CF_SSE2; i <= ChromeCPUFeatures::CF_NEON; ++i)
+    {
+        if (probeFeature(static_cast<ChromeCPUFeatures::Feature>(i)))
+        {
+            ret |= 1u << i;
+        }
+    }
+
+    return ret;
+}
+
+bool ChromeCPUFeatures::isSupported(Feature feature)
+{
+    // initialisation of function local statics is thread safe
+    static const uint supported = detectSupportedFeatures();
+
+    return static_cast<uint>(feature) < 32 && (supported & (1u << feature)) != 0;
+}
+
+}
@@ -0,0 +1,200 @@
+/***********************************************************************
+    filename:   CEGUIChromeCanvasSizingPolicy.cpp
+    created:    16/10/2026
+    author:     Martin Preisler
+*************************************************************************/
+/***************************************************************************
+ *   Copyright (C) 2011 Martin Preisler
+ *
+ *   Permission is hereby granted, free of charge, to any person obtaining
+ *   a copy of this software and associated documentation files (the
+ *   "Software"), to deal in the Software without restriction, including
+ *   without limitation the rights to use, copy, modify, merge, publish,
+ *   distribute, sublicense, and/or sell copies of the Software, and to
+ *   permit persons to whom the Software is furnished to do so, subject to
+ *   the following conditions:
+ *
+ *   The above copyright notice and this permission notice shall be
+ *   included in all copies or substantial portions of the Software.
+ *
+ *   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ *   EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ *   MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ *   IN NO EVENT SHALL THE AUTHORS BE LIABLE FOR ANY CLAIM, DAMAGES OR
+ *   OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+ *   ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ *   OTHER DEALINGS IN THE SOFTWARE.
+ ***************************************************************************/
+
+#include "CEGUIChromeCanvasSizingPolicy.h"
+
+#include <cmath>
+#include <algorithm>
+
+namespace CEGUI
+{
+
+ChromeCanvasSizingPolicy::ChromeCanvasSizingPolicy():
+    d_quantum(64),
+    d_powerOfTwoEnabled(false),
+    d_growHeadroom(0.0f),
+    d_shrinkThreshold(0.25f),
+    d_shrinkDelay(1.0f),
+
+    d_shrinkPending(false),
+    d_shrinkTimer(0.0f),
+    d_reallocationCount(0),
+    d_lastRequestedSize(0, 0),
+    d_lastTextureSize(0, 0)
+{}
+
+void ChromeCanvasSizingPolicy::setQuantum(uint pixels)
+{
+    d_quantum = std::max<uint>(pixels, 1);
+}
+
+uint ChromeCanvasSizingPolicy::getQuantum() const
+{
+    return d_quantum;
+}
+
+void ChromeCanvasSizingPolicy::setPowerOfTwoEnabled(bool enabled)
+{
+    d_powerOfTwoEnabled = enabled;
+}
+
+bool ChromeCanvasSizingPolicy::isPowerOfTwoEnabled() const
+{
+    return d_powerOfTwoEnabled;
+}
+
+void ChromeCanvasSizingPolicy::setGrowHeadroom(float ratio)
+{
+    d_growHeadroom = std::max(ratio, 0.0f);
+}
+
+float ChromeCanvasSizingPolicy::getGrowHeadroom() const
+{
+    return d_growHeadroom;
+}
+
+void ChromeCanvasSizingPolicy::setShrinkThreshold(float ratio)
+{
+    d_shrinkThreshold = std::max(ratio, 0.0f);
+}
+
+float ChromeCanvasSizingPolicy::getShrinkThreshold() const
+{
+    return d_shrinkThreshold;
+}
+
+void ChromeCanvasSizingPolicy::setShrinkDelay(float seconds)
+{
+    d_shrinkDelay = std::max(seconds, 0.0f);
+}
+
+float ChromeCanvasSizingPolicy::getShrinkDelay() const
+{
+    return d_shrinkDelay;
+}
+
+Sizef ChromeCanvasSizingPolicy::getAllocationSize(const Sizef& canvasSize) const
+{
+    return Sizef(quantise(canvasSize.d_width * (1.0f + d_growHeadroom)),
+                 quantise(canvasSize.d_height * (1.0f + d_growHeadroom)));
+}
+
+Sizef ChromeCanvasSizingPolicy::getMaximumSize(const Sizef& canvasSize) const
+{
+    return getAllocationSize(canvasSize) * (1.0f + d_shrinkThreshold);
+}
+
+ChromeCanvasSizingPolicy::Decision ChromeCanvasSizingPolicy::evaluate(const Sizef& canvasSize, const Sizef& textureSize)
+{
+    if (textureSize.d_width < canvasSize.d_width ||
+        textureSize.d_height < canvasSize.d_height)
+    {
+        d_shrinkPending = false;
+        ++d_reallocationCount;
+
+        return D_Grow;
+    }
+
+    const Sizef maximumSize = getMaximumSize(canvasSize);
+    const Sizef allocationSize = getAllocationSize(canvasSize);
+
+    // if the renderer rounded the texture up, asking for the same size or more would give us the same texture
+    const bool roundedByRenderer = textureSize == d_lastTextureSize &&
+        allocationSize.d_width >= d_lastRequestedSize.d_width &&
+        allocationSize.d_height >= d_lastRequestedSize.d_height;
+
+    if (roundedByRenderer ||
+        (textureSize.d_width <= maximumSize.d_width &&
+         textureSize.d_height <= maximumSize.d_height))
+    {
+        d_shrinkPending = false;
+
+        return D_Keep;
+    }
+
+    if (!d_shrinkPending)
+    {
+        d_shrinkPending = true;
+        d_shrinkTimer = 0.0f;
+    }
+
+    if (d_shrinkTimer < d_shrinkDelay)
+    {
+        return D_Keep;
+    }
+
+    d_shrinkPending = false;
+    ++d_reallocationCount;
+
+    return D_Shrink;
+}
+
+void ChromeCanvasSizingPolicy::notifyAllocated(const Sizef& requestedSize, const Sizef& textureSize)
+{
+    d_lastRequestedSize = requestedSize;
+    d_lastTextureSize = textureSize;
+}
+
+void ChromeCanvasSizingPolicy::update(float elapsed)
+{
+    if (d_shrinkPending)
+    {
+        d_shrinkTimer += elapsed;
+    }
+}
+
+bool ChromeCanvasSizingPolicy::isShrinkDue() const
+{
+    return d_shrinkPending && d_shrinkTimer >= d_shrinkDelay;
+}
+
+size_t ChromeCanvasSizingPolicy::getReallocationCount() const
+{
+    return d_reallocationCount;
+}
+
+float ChromeCanvasSizingPolicy::quantise(float value) const
+{
+    const float ceiled = std::max(std::ceil(value), 1.0f);
+
+    if (d_powerOfTwoEnabled)
+    {
+        float ret = 1.0f;
+
+        while (ret < ceiled)
+        {
+            ret *= 2.0f;
+        }
+
+        return ret;
+    }
+
+    return std::ceil(ceiled / d_quantum) * d_quantum;
+}
+
+}
@@ -0,0 +1,188 @@
+/***********************************************************************
+    filename:   CEGUIChromeDirtyRegion.cpp
+    created:    16/10/2026
+    author:     Martin Preisler
+*************************************************************************/
+/***************************************************************************
+ *   Copyright (C) 2011 Martin Preisler
+ *
+ *   Permission is hereby granted, free of charge, to any person obtaining
+ *   a copy of this software and associated documentation files (the
+ *   "Software"), to deal in the Software without restriction, including
+ *   without limitation the rights to use, copy, modify, merge, publish,
+ *   distribute, sublicense, and/or sell copies of the Software, and to
+ *   permit persons to whom the Software is furnished to do so, subject to
+ *   the following conditions:
+ *
+ *   The above copyright notice and this permission notice shall be
+ *   included in all copies or substantial portions of the Software.
+ *
+ *   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ *   EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ *   MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ *   IN NO EVENT SHALL THE AUTHORS BE LIABLE FOR ANY CLAIM, DAMAGES OR
+ *   OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+ *   ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ *   OTHER DEALINGS IN THE SOFTWARE.
+ ***************************************************************************/
+
+#include "CEGUIChromeDirtyRegion.h"
+
+#include <algorithm>
+
+namespace CEGUI
+{
+
+ChromeDirtyRegion::ChromeDirtyRegion():
+    d_bounds(0.0f, 0.0f),
+    d_coverageThreshold(0.75f),
+    d_addedRectCount(0),
+    d_full(false)
+{}
+
+void ChromeDirtyRegion::setBounds(const Sizef& size)
+{
+    d_bounds = size;
+
+    clear();
+}
+
+const Sizef& ChromeDirtyRegion::getBounds() const
+{
+    return d_bounds;
+}
+
+void ChromeDirtyRegion::setCoverageThreshold(float ratio)
+{
+    d_coverageThreshold = std::max(0.0f, std::min(1.0f, ratio));
+}
+
+float ChromeDirtyRegion::getCoverageThreshold() const
+{
+    return d_coverageThreshold;
+}
+
+void ChromeDirtyRegion::addRect(const Rectf& rect)
+{
+    ++d_addedRectCount;
+
+    if (d_full)
+    {
+        return;
+    }
+
+    Rectf merged(
+        std::max(rect.left(), 0.0f),
+        std::max(rect.top(), 0.0f),
+        std::min(rect.right(), d_bounds.d_width),
+        std::min(rect.bottom(), d_bounds.d_height));
+
+    if (getArea(merged) <= 0.0f)
+    {
+        return;
+    }
+
+    // keep merging until the rect doesn't merge with anything else, merged
+    // rect may have grown enough to be worth merging with rects it didn't
+    // even touch before
+    bool mergedAny = true;
+    while (mergedAny)
+    {
+        mergedAny = false;
+
+        for (RectList::iterator it = d_rects.begin(); it != d_rects.end(); ++it)
+        {
+            const Rectf unionRect(
+                std::min(merged.left(), it->left()),
+                std::min(merged.top(), it->top()),
+                std::max(merged.right(), it->right()),
+                std::max(merged.bottom(), it->bottom()));
+
+            // union is only worth it if it doesn't upload more pixels than 2 separate uploads
+            if (getArea(unionRect) <= getArea(merged) + getArea(*it))
+            {
+                merged = unionRect;
+                d_rects.erase(it);
+                mergedAny = true;
+                break;
+            }
+        }
+    }
+
+    d_rects.push_back(merged);
+
+    // rects that weren't worth merging can still overlap, their pairwise overlaps mustn't count twice
+    float coveredArea = 0.0f;
+    for (RectList::const_iterator it = d_rects.begin(); it != d_rects.end(); ++it)
+    {
+        coveredArea += getArea(*it);
+
+        for (RectList::const_iterator other = it + 1; other != d_rects.end(); ++other)
+        {
+            coveredArea -= getArea(Rectf(
+                std::max(it->left(), other->left()),
+                std::max(it->top(), other->top()),
+                std::min(it->right(), other->right()),
+                std::min(it->bottom(), other->bottom())));
+        }
+    }
+
+    if (d_coverageThreshold < 1.0f &&
+        coveredArea >= getArea(Rectf(0.0f, 0.0f, d_bounds.d_width, d_bounds.d_height)) * d_coverageThreshold)
+    {
+        const size_t addedRectCount = d_addedRectCount;
+        addAll();
+        // addAll counts as an addition, we don't want that here
+        d_addedRectCount = addedRectCount;
+    }
+}
+
+void ChromeDirtyRegion::addAll()
+{
+    ++d_addedRectCount;
+
+    d_rects.clear();
+
+    if (d_bounds.d_width * d_bounds.d_height > 0)
+    {
+        d_rects.push_back(Rectf(0.0f, 0.0f, d_bounds.d_width, d_bounds.d_height));
+        d_full = true;
+    }
+}
+
+void ChromeDirtyRegion::clear()
+{
+    d_rects.clear();
+    d_addedRectCount = 0;
+    d_full = false;
+}
+
+bool ChromeDirtyRegion::isEmpty() const
+{
+    return d_rects.empty();
+}
+
+bool ChromeDirtyRegion::isFull() const
+{
+    return d_full;
+}
+
+const ChromeDirtyRegion::RectList& ChromeDirtyRegion::getRects() const
+{
+    return d_rects;
+}
+
+size_t ChromeDirtyRegion::getAddedRectCount() const
+{
+    return d_addedRectCount;
+}
+
+float ChromeDirtyRegion::getArea(const Rectf& rect)
+{
+    const float width = rect.right() - rect.left();
+    const float height = rect.bottom() - rect.top();
+
+    return (width > 0.0f && height > 0.0f) ? width * height : 0.0f;
+}
+
+}
@@ -27,11 +27,12 @@
  ***************************************************************************/
 
 #include "CEGUIChromeFlash.h"
+#include "CEGUIChromeBase64.h"
 
 #include <berkelium/Berkelium.hpp>
 #include <berkelium/Window.hpp>
 
-#include <fstream>
+#include <string>
 
 namespace CEGUI
 {
@@ -49,7 +50,7 @@ void ChromeFlash::fetchFlash(const String& URI)
 {
     const char* data = URI.c_str();
 
-    d_chromeWindow->navigateTo(data, strlen(data));
+    navigateTo(data, strlen(data));
 }
 
 void ChromeFlash::loadFromFile(const String& filename, const String& resourceGroup)
@@ -58,23 +59,25 @@ void ChromeFlash::loadFromFile(const String& filename, const String& resourceGro
     System::getSingleton().getResourceProvider()->
         loadRawDataContainer(filename, file, resourceGroup);
 
-    String base64_swf("data:application/x-shockwave-flash;base64,");
-    base64_encode(base64_swf, file.getDataPtr(), file.getSize());
+    static const char wrapperPrefix[] =
+        "<object width=\"550\" height=\"400\"><embed width=\"550\" height=\"400\" src=\""
+        "data:application/x-shockwave-flash;base64,";
+    static const char wrapperSuffix[] = "\"></embed></object>\n";
 
-    CEGUI::System::getSingleton().getResourceProvider()->
-        unloadRawDataContainer(file);
-
-    String wrapper(String("<object width=\"550\" height=\"400\"><embed width=\"550\" height=\"400\" src=\"") + base64_swf + String("\"></embed></object>\n"));
-    
-    String base64("data:text/html;charset=utf8;base64,");
-    const char* dataToEncode = wrapper.c_str();
-    base64_encode(base64, reinterpret_cast<const uint8*>(dataToEncode), strlen(dataToEncode));
+    // the swf is embedded as a data URI in the wrapper, which is then encoded again
+    const size_t prefixLength = sizeof(wrapperPrefix) - 1;
+    const size_t swfLength = ChromeBase64::getEncodedSize(file.getSize());
+    std::string wrapper(prefixLength + swfLength + sizeof(wrapperSuffix) - 1, '\0');
 
-    const char* dataToPass = base64.c_str();
+    memcpy(&wrapper[0], wrapperPrefix, prefixLength);
+    ChromeBase64::encode(&wrapper[prefixLength], file.getDataPtr(), file.getSize());
+    memcpy(&wrapper[prefixLength + swfLength], wrapperSuffix, sizeof(wrapperSuffix) - 1);
 
-    std::ofstream("output.html") << dataToEncode << std::endl;
+    CEGUI::System::getSingleton().getResourceProvider()->
+        unloadRawDataContainer(file);
 
-    d_chromeWindow->navigateTo(dataToPass, strlen(dataToPass));
+    navigateToData("data:text/html;charset=utf8;base64,",
+        reinterpret_cast<const uint8*>(wrapper.data()), wrapper.size());
 }
 
 }
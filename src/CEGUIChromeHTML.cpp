@@ -27,18 +27,424 @@
  ***************************************************************************/
 
 #include "CEGUIChromeHTML.h"
+#include "CEGUIChromeSystem.h"
 
 #include <berkelium/Berkelium.hpp>
 #include <berkelium/Window.hpp>
 
+#include <algorithm>
+#include <cctype>
+
 namespace CEGUI
 {
 
 const String ChromeHTML::WidgetTypeName("ChromeHTML");
 
+//! an element with an id attribute, its content can be replaced through innerHTML
+struct MarkupElement
+{
+    //! lowercase tag name
+    std::string d_name;
+    std::string d_id;
+    //! offset of the first byte after the start tag
+    size_t d_contentBegin;
+    //! offset of the closing tag
+    size_t d_contentEnd;
+};
+
+typedef std::vector<MarkupElement> MarkupElementList;
+
+//! elements that never have content
+static bool isVoidElement(const std::string& name)
+{
+    static const char* const voidElements[] =
+        {"area", "base", "br", "col", "embed", "hr", "img", "input", "link", "meta", "param", "source", "track", "wbr"};
+
+    for (size_t i = 0; i < sizeof(voidElements) / sizeof(voidElements[0]); ++i)
+    {
+        if (name == voidElements[i])
+        {
+            return true;
+        }
+    }
+
+    return false;
+}
+
+//! elements whose content isn't markup, '<' inside them doesn't start a tag
+static bool isRawTextElement(const std::string& name)
+{
+    return name == "script" || name == "style" || name == "textarea" || name == "title";
+}
+
+//! case insensitive search for given lowercase needle, returns npos if not found
+static size_t findLowercase(const std::string& haystack, const std::string& needle, size_t pos)
+{
+    for (; pos + needle.size() <= haystack.size(); ++pos)
+    {
+        size_t i = 0;
+        while (i < needle.size() && std::tolower(static_cast<unsigned char>(haystack[pos + i])) == needle[i])
+        {
+            ++i;
+        }
+
+        if (i == needle.size())
+        {
+            return pos;
+        }
+    }
+
+    return std::string::npos;
+}
+
+//! skips a comment, doctype or any other <! or <? construct starting at pos, returns npos if unterminated
+static size_t skipMarkupDeclaration(const std::string& markup, size_t pos)
+{
+    if (markup.compare(pos, 4, "<!--") == 0)
+    {
+        const size_t end = markup.find("-->", pos + 4);
+        return end == std::string::npos ? end : end + 3;
+    }
+
+    const size_t end = markup.find('>', pos);
+    return end == std::string::npos ? end : end + 1;
+}
+
+/*!
+\brief parses the start tag at pos
+
+\return
+    offset right after the tag, npos if the tag is unterminated
+*/
+static size_t parseStartTag(const std::string& markup, size_t pos, std::string& name, std::string& id, bool& selfClosing)
+{
+    name.clear();
+    id.clear();
+    selfClosing = false;
+
+    size_t i = pos + 1;
+    while (i < markup.size() && (std::isalnum(static_cast<unsigned char>(markup[i])) || markup[i] == '-' || markup[i] == ':'))
+    {
+        name += static_cast<char>(std::tolower(static_cast<unsigned char>(markup[i])));
+        ++i;
+    }
+
+    while (i < markup.size())
+    {
+        const char c = markup[i];
+
+        if (c == '>')
+        {
+            selfClosing = markup[i - 1] == '/';
+            return i + 1;
+        }
+
+        if (std::isspace(static_cast<unsigned char>(c)) || c == '/')
+        {
+            ++i;
+            continue;
+        }
+
+        // attribute name
+        std::string attribute;
+        while (i < markup.size() && !std::isspace(static_cast<unsigned char>(markup[i])) &&
+               markup[i] != '=' && markup[i] != '>' && markup[i] != '/')
+        {
+            attribute += static_cast<char>(std::tolower(static_cast<unsigned char>(markup[i])));
+            ++i;
+        }
+
+        while (i < markup.size() && std::isspace(static_cast<unsigned char>(markup[i])))
+        {
+            ++i;
+        }
+
+        if (i >= markup.size() || markup[i] != '=')
+        {
+            // attribute without value
+            continue;
+        }
+
+        ++i;
+        while (i < markup.size() && std::isspace(static_cast<unsigned char>(markup[i])))
+        {
+            ++i;
+        }
+
+        std::string value;
+        if (i < markup.size() && (markup[i] == '"' || markup[i] == '\''))
+        {
+            const size_t end = markup.find(markup[i], i + 1);
+            if (end == std::string::npos)
+            {
+                return end;
+            }
+
+            value = markup.substr(i + 1, end - i - 1);
+            i = end + 1;
+        }
+        else
+        {
+            while (i < markup.size() && !std::isspace(static_cast<unsigned char>(markup[i])) && markup[i] != '>')
+            {
+                value += markup[i];
+                ++i;
+            }
+        }
+
+        if (attribute == "id")
+        {
+            id = value;
+        }
+    }
+
+    return std::string::npos;
+}
+
+/*!
+\brief finds the closing tag of an element with given name whose content starts at pos
+
+\return
+    offset of the closing tag, npos if there is none
+*/
+static size_t findClosingTag(const std::string& markup, const std::string& name, size_t pos)
+{
+    const std::string closing("</" + name);
+
+    if (isRawTextElement(name))
+    {
+        return findLowercase(markup, closing, pos);
+    }
+
+    const std::string opening("<" + name);
+    size_t depth = 1;
+
+    while ((pos = markup.find('<', pos)) != std::string::npos)
+    {
+        if (markup.compare(pos, 2, "<!") == 0 || markup.compare(pos, 2, "<?") == 0)
+        {
+            pos = skipMarkupDeclaration(markup, pos);
+            if (pos == std::string::npos)
+            {
+                return pos;
+            }
+
+            continue;
+        }
+
+        const bool isClosing = findLowercase(markup, closing, pos) == pos;
+        const bool isOpening = !isClosing && findLowercase(markup, opening, pos) == pos;
+        const size_t nameEnd = pos + (isClosing ? closing.size() : opening.size());
+
+        if ((isClosing || isOpening) && nameEnd < markup.size() &&
+            !std::isalnum(static_cast<unsigned char>(markup[nameEnd])) && markup[nameEnd] != '-')
+        {
+            if (isClosing)
+            {
+                if (--depth == 0)
+                {
+                    return pos;
+                }
+            }
+            else
+            {
+                std::string childName, childId;
+                bool selfClosing;
+                const size_t end = parseStartTag(markup, pos, childName, childId, selfClosing);
+                if (end == std::string::npos)
+                {
+                    return end;
+                }
+
+                if (!selfClosing)
+                {
+                    ++depth;
+                }
+
+                pos = end;
+                continue;
+            }
+        }
+
+        ++pos;
+    }
+
+    return std::string::npos;
+}
+
+/*!
+\brief finds all outermost elements with an id attribute
+
+\return
+    false if the markup couldn't be parsed
+*/
+static bool findIdElements(const std::string& markup, MarkupElementList& elements)
+{
+    size_t pos = 0;
+
+    while ((pos = markup.find('<', pos)) != std::string::npos)
+    {
+        if (markup.compare(pos, 2, "<!") == 0 || markup.compare(pos, 2, "<?") == 0 ||
+            markup.compare(pos, 2, "</") == 0)
+        {
+            pos = skipMarkupDeclaration(markup, pos);
+            if (pos == std::string::npos)
+            {
+                return false;
+            }
+
+            continue;
+        }
+
+        std::string name, id;
+        bool selfClosing;
+        const size_t tagEnd = parseStartTag(markup, pos, name, id, selfClosing);
+        if (tagEnd == std::string::npos)
+        {
+            return false;
+        }
+
+        if (name.empty() || selfClosing || isVoidElement(name))
+        {
+            pos = tagEnd;
+            continue;
+        }
+
+        if (id.empty() && !isRawTextElement(name))
+        {
+            // the content gets scanned as we go
+            pos = tagEnd;
+            continue;
+        }
+
+        const size_t contentEnd = findClosingTag(markup, name, tagEnd);
+        if (contentEnd == std::string::npos)
+        {
+            return false;
+        }
+
+        if (!id.empty())
+        {
+            MarkupElement element;
+            element.d_name = name;
+            element.d_id = id;
+            element.d_contentBegin = tagEnd;
+            element.d_contentEnd = contentEnd;
+            elements.push_back(element);
+        }
+
+        // nested elements with ids get replaced along with this one
+        pos = contentEnd;
+    }
+
+    return true;
+}
+
+/*!
+\brief builds a script turning the old markup into the new one
+
+\par
+    Both are split into the outermost elements with an id attribute and the skeleton around them.
+    If the skeletons match, the page can be patched by replacing the content of the elements that differ.
+
+\param changedBytes
+    how much of the new markup the script replaces
+
+\return
+    false if the structure changed and the page has to be reloaded
+*/
+static bool buildContentPatch(const std::string& oldMarkup, const std::string& newMarkup,
+                              std::string& script, size_t& changedBytes)
+{
+    MarkupElementList oldElements, newElements;
+    if (!findIdElements(oldMarkup, oldElements) || !findIdElements(newMarkup, newElements) ||
+        oldElements.size() != newElements.size())
+    {
+        return false;
+    }
+
+    // getElementById would only find the first of elements sharing an id
+    std::vector<std::string> ids;
+    for (size_t i = 0; i < newElements.size(); ++i)
+    {
+        ids.push_back(newElements[i].d_id);
+    }
+    std::sort(ids.begin(), ids.end());
+    if (std::adjacent_find(ids.begin(), ids.end()) != ids.end())
+    {
+        return false;
+    }
+
+    size_t oldPos = 0;
+    size_t newPos = 0;
+    changedBytes = 0;
+
+    for (size_t i = 0; i <= newElements.size(); ++i)
+    {
+        const bool last = i == newElements.size();
+        const size_t oldSkeletonEnd = last ? oldMarkup.size() : oldElements[i].d_contentBegin;
+        const size_t newSkeletonEnd = last ? newMarkup.size() : newElements[i].d_contentBegin;
+
+        if (oldSkeletonEnd - oldPos != newSkeletonEnd - newPos ||
+            oldMarkup.compare(oldPos, oldSkeletonEnd - oldPos, newMarkup, newPos, newSkeletonEnd - newPos) != 0)
+        {
+            return false;
+        }
+
+        if (last)
+        {
+            break;
+        }
+
+        const MarkupElement& oldElement = oldElements[i];
+        const MarkupElement& newElement = newElements[i];
+        const size_t oldLength = oldElement.d_contentEnd - oldElement.d_contentBegin;
+        const size_t newLength = newElement.d_contentEnd - newElement.d_contentBegin;
+
+        if (oldLength != newLength ||
+            oldMarkup.compare(oldElement.d_contentBegin, oldLength, newMarkup, newElement.d_contentBegin, newLength) != 0)
+        {
+            // scripts assigned through innerHTML never run, the page would differ from a reloaded one
+            if (newElement.d_name == "script" ||
+                findLowercase(newMarkup.substr(newElement.d_contentBegin, newLength), "<script", 0) != std::string::npos)
+            {
+                return false;
+            }
+
+            script += "document.getElementById(";
+            ChromeWidget::appendJavascriptString(script, newElement.d_id.c_str(), newElement.d_id.size());
+            script += ").innerHTML = ";
+            ChromeWidget::appendJavascriptString(script, newMarkup.c_str() + newElement.d_contentBegin, newLength);
+            script += ";\n";
+
+            changedBytes += newLength;
+        }
+
+        oldPos = oldElement.d_contentEnd;
+        newPos = newElement.d_contentEnd;
+    }
+
+    return true;
+}
+
 ChromeHTML::ChromeHTML(const String& type, const String& name):
-    ChromeWidget(type, name)
-{}
+    ChromeWidget(type, name),
+
+    d_contentNavigation(0),
+    d_contentPatchThreshold(0.5f),
+    d_contentPatchCount(0),
+    d_contentReloadCount(0)
+{
+    const String propertyOrigin("ChromeHTML");
+
+    CEGUI_DEFINE_PROPERTY(ChromeHTML, float, "ContentPatchThreshold",
+        "If more than this portion of the markup changes in updateContent, the page is reloaded instead of patched. "
+        "Defaults to 0.5.",
+        &ChromeHTML::setContentPatchThreshold,
+        &ChromeHTML::getContentPatchThreshold,
+        0.5f
+    );
+}
 
 ChromeHTML::~ChromeHTML()
 {}
@@ -47,11 +453,19 @@ void ChromeHTML::fetchContent(const String& URI)
 {
     const char* data = URI.c_str();
 
-    d_chromeWindow->navigateTo(data, strlen(data));
+    navigateTo(data, strlen(data));
 }
 
 void ChromeHTML::loadContentFromFile(const String& filename, const String& resourceGroup)
 {
+    std::string url;
+    if (ChromeSystem::getResourceFileURL(filename, resourceGroup, url))
+    {
+        // relative links of the page resolve next to the file this way
+        navigateTo(url.c_str(), url.size());
+        return;
+    }
+
     RawDataContainer file;
     System::getSingleton().getResourceProvider()->
         loadRawDataContainer(filename, file, resourceGroup);
@@ -64,11 +478,81 @@ void ChromeHTML::loadContentFromFile(const String& filename, const String& resou
 
 void ChromeHTML::setContent(const String& markupCode)
 {
-    String base64("data:text/html;charset=utf8;base64,");
-    const char* data = markupCode.c_str();
-    base64_encode(base64, reinterpret_cast<const uint8*>(data), strlen(data));
+    d_content = markupCode.c_str();
+
+    const uint previousNavigation = getNavigationGeneration();
+    navigateToData("data:text/html;charset=utf8;base64,",
+        reinterpret_cast<const uint8*>(d_content.data()), d_content.size());
+
+    d_contentNavigation = getNavigationGeneration();
+
+    // the payload cache skips navigating when the very same markup is shown already
+    if (d_contentNavigation != previousNavigation)
+    {
+        ++d_contentReloadCount;
+    }
+}
+
+void ChromeHTML::updateContent(const String& markupCode)
+{
+    const std::string markup(markupCode.c_str());
+
+    // anything navigated to since setContent replaced the markup we know about
+    const bool contentShown = d_contentNavigation == getNavigationGeneration() && !hasPageNavigatedAway();
+
+    if (contentShown && markup == d_content && isChromeContentLoaded())
+    {
+        return;
+    }
+
+    std::string script;
+    size_t changedBytes = 0;
+
+    // scripts can only patch a page that is there, anything else needs the whole markup
+    if (!contentShown || d_content.empty() || !isChromeContentLoaded() ||
+        !buildContentPatch(d_content, markup, script, changedBytes) ||
+        changedBytes > d_contentPatchThreshold * markup.size())
+    {
+        setContent(markupCode);
+        return;
+    }
+
+    d_content = markup;
+    ++d_contentPatchCount;
+
+    executeJavascript(script.c_str(), script.size());
+
+    // encoding the whole markup on every patch would cost as much as reloading,
+    // it's only needed if the window gets recreated
+    deferNavigation();
+}
+
+void ChromeHTML::onDeferredNavigationNeeded()
+{
+    size_t length;
+    const char* url = buildDataURI("data:text/html;charset=utf8;base64,",
+        reinterpret_cast<const uint8*>(d_content.data()), d_content.size(), length);
+    rememberNavigation(url, length);
+}
+
+void ChromeHTML::setContentPatchThreshold(float ratio)
+{
+    d_contentPatchThreshold = ratio;
+}
+
+float ChromeHTML::getContentPatchThreshold() const
+{
+    return d_contentPatchThreshold;
+}
 
-    fetchContent(base64);
+size_t ChromeHTML::getContentPatchCount() const
+{
+    return d_contentPatchCount;
+}
+
+size_t ChromeHTML::getContentReloadCount() const
+{
+    return d_contentReloadCount;
 }
 
 }
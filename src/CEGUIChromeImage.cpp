@@ -27,6 +27,16 @@
  ***************************************************************************/
 
 #include "CEGUIChromeImage.h"
+#include "CEGUIChromeSystem.h"
+#include "CEGUIChromeRasterCache.h"
+#include "CEGUIChromeStagingArena.h"
+#include "CEGUIChromeTextureUploader.h"
+
+#include "CEGUISystem.h"
+#include "CEGUIRenderer.h"
+#include "CEGUITexture.h"
+#include "CEGUIPropertyHelper.h"
+#include "CEGUIResourceProvider.h"
 
 #include <berkelium/Berkelium.hpp>
 #include <berkelium/Window.hpp>
@@ -35,24 +45,67 @@ namespace CEGUI
 {
 
 const String ChromeImage::WidgetTypeName("ChromeImage");
+uint ChromeImage::ds_rasterTextureCounter = 0;
 
 ChromeImage::ChromeImage(const String& type, const String& name):
-    ChromeWidget(type, name)
-{}
+    ChromeWidget(type, name),
+
+    d_nativeRasterEnabled(true),
+    d_vectorContentHash(0),
+    d_vectorStorePending(false)
+{
+    const String propertyOrigin("ChromeImage");
+
+    CEGUI_DEFINE_PROPERTY(ChromeImage, bool, "NativeRasterEnabled",
+        "If enabled, png, jpeg and gif images loaded from files are decoded by CEGUI's image codec "
+        "and shown without Chrome. Enabled by default.",
+        &ChromeImage::setNativeRasterEnabled,
+        &ChromeImage::isNativeRasterEnabled,
+        true
+    );
+}
 
 ChromeImage::~ChromeImage()
-{}
+{
+    if (Texture* texture = getNativeContentTexture())
+    {
+        System::getSingleton().getRenderer()->destroyTexture(*texture);
+    }
+}
 
 void ChromeImage::fetchImage(const String& URI)
 {
+    d_vectorContentHash = 0;
+    d_vectorStorePending = false;
+
     const char* data = URI.c_str();
 
-    d_chromeWindow->navigateTo(data, strlen(data));
+    navigateTo(data, strlen(data));
 }
 
 void ChromeImage::loadFromFile(const String& filename, const String& resourceGroup)
 {
-    if (filename.substr(filename.length() - 4) == ".svg")
+    d_vectorContentHash = 0;
+    d_vectorStorePending = false;
+
+    std::string url;
+    if (ChromeSystem::getRasterCache().isEnabled() && filename.substr(filename.length() - 4) == ".svg")
+    {
+        // the cache needs the content, going through the file URL would skip it
+        loadFromFile("svg+xml", filename, resourceGroup);
+    }
+    else if (d_nativeRasterEnabled &&
+        (filename.substr(filename.length() - 4) == ".jpg" || filename.substr(filename.length() - 5) == ".jpeg" ||
+         filename.substr(filename.length() - 4) == ".png" || filename.substr(filename.length() - 4) == ".gif"))
+    {
+        loadNativeRaster(filename, resourceGroup);
+    }
+    else if (ChromeSystem::getResourceFileURL(filename, resourceGroup, url))
+    {
+        // Chrome knows the mime type from the extension as well
+        navigateTo(url.c_str(), url.size());
+    }
+    else if (filename.substr(filename.length() - 4) == ".svg")
     {
         loadFromFile("svg+xml", filename, resourceGroup);
     }
@@ -77,19 +130,192 @@ void ChromeImage::loadFromFile(const String& filename, const String& resourceGro
 
 void ChromeImage::loadFromFile(const String& mimeSubtype, const String& filename, const String& resourceGroup)
 {
+    d_vectorContentHash = 0;
+    d_vectorStorePending = false;
+
+    if (d_nativeRasterEnabled && isNativeRasterSubtype(mimeSubtype))
+    {
+        loadNativeRaster(filename, resourceGroup);
+        return;
+    }
+
+    if (mimeSubtype == "svg+xml" && ChromeSystem::getRasterCache().isEnabled())
+    {
+        loadCachedVector(filename, resourceGroup);
+        return;
+    }
+
+    const std::string mimeType(std::string("image/") + mimeSubtype.c_str());
+
+    // now lets send it to chrome
+    navigateToResource(filename, resourceGroup, mimeType.c_str());
+}
+
+void ChromeImage::setNativeRasterEnabled(bool enabled)
+{
+    d_nativeRasterEnabled = enabled;
+}
+
+bool ChromeImage::isNativeRasterEnabled() const
+{
+    return d_nativeRasterEnabled;
+}
+
+bool ChromeImage::isNativeRasterActive() const
+{
+    return getNativeContentTexture() != 0;
+}
+
+bool ChromeImage::isNativeRasterSubtype(const String& mimeSubtype)
+{
+    return mimeSubtype == "png" || mimeSubtype == "jpeg" || mimeSubtype == "gif";
+}
+
+void ChromeImage::loadNativeRaster(const String& filename, const String& resourceGroup)
+{
+    // the renderer decodes the file with the system's image codec, if that throws nothing changes
+    Texture& texture = System::getSingleton().getRenderer()->createTexture(
+        "ChromeImage/RasterTexture/" + PropertyHelper<uint>::toString(ds_rasterTextureCounter++),
+        filename, resourceGroup);
+
+    setNativeContentTexture(&texture);
+}
+
+void ChromeImage::onNativeContentTextureReleased(Texture& texture)
+{
+    System::getSingleton().getRenderer()->destroyTexture(texture);
+}
+
+void ChromeImage::loadCachedVector(const String& filename, const String& resourceGroup)
+{
+    static const char header[] = "data:image/svg+xml;base64,";
+
     RawDataContainer file;
     System::getSingleton().getResourceProvider()->
         loadRawDataContainer(filename, file, resourceGroup);
 
-    String base64("data:image/" + mimeSubtype + ";base64,");
-    base64_encode(base64, file.getDataPtr(), file.getSize());
+    const ChromeSystem::PayloadHash hash = ChromeSystem::hashPayload(header, file.getDataPtr(), file.getSize());
+
+    // the file URL lets the svg refer to other files next to it, those aren't hashed though,
+    // the raster cache can't tell when they change
+    std::string url;
+    if (!ChromeSystem::getResourceFileURL(filename, resourceGroup, url))
+    {
+        size_t length;
+        const char* data = buildDataURI(header, file.getDataPtr(), file.getSize(), length);
+        url.assign(data, length);
+    }
+
+    ChromeRasterCache::Key key;
+    d_vectorContentHash = hash;
+    bool restored = false;
+    bool navigated = false;
+
+    if (getVectorCacheKey(key) && ChromeSystem::getRasterCache().contains(key))
+    {
+        setNativeContentTexture(0);
+
+        if (isFreezeEnabled() && getInteractionMode() == IM_NoInteraction)
+        {
+            // Chrome only gets the image if the widget thaws, the canvas comes from the cache
+            rememberNavigation(url.c_str(), url.size());
+        }
+        else
+        {
+            // the widget takes input, Chrome has to show the image even though it doesn't paint it first
+            navigateTo(url.c_str(), url.size());
+            navigated = true;
+        }
+
+        // restoreRenderingCanvas clears this once the canvas comes from the cache
+        d_vectorStorePending = true;
+        resizeRenderingCanvas();
 
-    CEGUI::System::getSingleton().getResourceProvider()->
+        restored = !d_vectorStorePending;
+    }
+
+    if (!restored)
+    {
+        if (!navigated)
+        {
+            navigateTo(url.c_str(), url.size());
+        }
+
+        d_vectorContentHash = hash;
+        d_vectorStorePending = true;
+    }
+
+    System::getSingleton().getResourceProvider()->
         unloadRawDataContainer(file);
+}
 
-    // now lets send it to chrome
-    const char* data = base64.c_str();
-    d_chromeWindow->navigateTo(data, strlen(data));
+bool ChromeImage::getVectorCacheKey(ChromeRasterCache::Key& key) const
+{
+    const Sizef canvasSize = getPixelSize() * d_effectiveRenderingDetailRatio;
+
+    key.d_contentHash = d_vectorContentHash;
+    // floor, just like ChromeWidget::resizeRenderingCanvas
+    key.d_width = static_cast<uint>(floor(canvasSize.d_width));
+    key.d_height = static_cast<uint>(floor(canvasSize.d_height));
+    key.d_detailRatio = d_effectiveRenderingDetailRatio;
+    key.d_transparent = d_transparencyEnabled;
+    key.d_pixelLayout = ChromeSystem::getTextureUploader().getPixelLayout();
+
+    return d_vectorContentHash != 0 && key.d_width > 0 && key.d_height > 0 &&
+        ChromeSystem::getRasterCache().isEnabled();
+}
+
+bool ChromeImage::restoreRenderingCanvas()
+{
+    ChromeRasterCache::Key key;
+    if (!getVectorCacheKey(key))
+    {
+        return false;
+    }
+
+    ChromeRasterCache& cache = ChromeSystem::getRasterCache();
+
+    size_t pitch;
+    const uint8* pixels = cache.map(key, pitch);
+    if (!pixels)
+    {
+        // Chrome paints this size now, store it once it's done
+        d_vectorStorePending = true;
+        return false;
+    }
+
+    // the cache holds the pixels just like the canvas texture does
+    writeCanvasRect(pixels, pitch, Rectf(0.0f, 0.0f, static_cast<float>(key.d_width), static_cast<float>(key.d_height)),
+        ChromePixelKernels::PC_Copy);
+    cache.unmap();
+
+    d_vectorStorePending = false;
+    return true;
+}
+
+void ChromeImage::onRenderingCanvasSettled()
+{
+    // the freeze releases Chrome right after this, the canvas has to be stored now
+    if (!d_vectorStorePending || !d_canvasBuffer)
+    {
+        return;
+    }
+
+    d_vectorStorePending = false;
+
+    ChromeRasterCache::Key key;
+    if (!getVectorCacheKey(key))
+    {
+        return;
+    }
+
+    // the shadow buffer holds what the canvas texture shows
+    const size_t pitch = static_cast<size_t>(key.d_width) * 4;
+    uint8* pixels = ChromeSystem::getStagingArena().acquire(pitch * key.d_height);
+    readCanvasRect(pixels, pitch,
+        Rectf(0.0f, 0.0f, static_cast<float>(key.d_width), static_cast<float>(key.d_height)));
+
+    ChromeSystem::getRasterCache().store(key, pixels, pitch);
 }
 
 }
@@ -0,0 +1,100 @@
+/***********************************************************************
+    filename:   CEGUIChromeOpenGLTextureUploader.cpp
+    created:    16/10/2026
+    author:     Martin Preisler
+*************************************************************************/
+/***************************************************************************
+ *   Copyright (C) 2011 Martin Preisler
+ *
+ *   Permission is hereby granted, free of charge, to any person obtaining
+ *   a copy of this software and associated documentation files (the
+ *   "Software"), to deal in the Software without restriction, including
+ *   without limitation the rights to use, copy, modify, merge, publish,
+ *   distribute, sublicense, and/or sell copies of the Software, and to
+ *   permit persons to whom the Software is furnished to do so, subject to
+ *   the following conditions:
+ *
+ *   The above copyright notice and this permission notice shall be
+ *   included in all copies or substantial portions of the Software.
+ *
+ *   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ *   EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ *   MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ *   IN NO EVENT SHALL THE AUTHORS BE LIABLE FOR ANY CLAIM, DAMAGES OR
+ *   OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+ *   ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ *   OTHER DEALINGS IN THE SOFTWARE.
+ ***************************************************************************/
+
+#include "CEGUIChromeOpenGLTextureUploader.h"
+#include "CEGUIChromeSystem.h"
+#include "CEGUIChromeStagingArena.h"
+
+#include "RendererModules/OpenGL/CEGUIOpenGLTexture.h"
+
+#include <cstring>
+
+#ifndef GL_BGRA
+#   define GL_BGRA 0x80E1
+#endif
+
+namespace CEGUI
+{
+
+ChromeOpenGLTextureUploader::ChromeOpenGLTextureUploader()
+{}
+
+ChromeOpenGLTextureUploader::~ChromeOpenGLTextureUploader()
+{}
+
+void ChromeOpenGLTextureUploader::blitFromMemory(Texture& texture, const void* source, size_t sourcePitch, const Rectf& area)
+{
+    const size_t bytesPerPixel = 4;
+
+    // GL can only skip whole pixels between rows, pixels staged in the arena by the widget
+    // always have whole pixel pitch, so the source can't be the memory we pack into
+    if (sourcePitch % bytesPerPixel != 0)
+    {
+        const size_t rowSize = static_cast<size_t>(area.getWidth()) * bytesPerPixel;
+        const size_t hig = static_cast<size_t>(area.getHeight());
+
+        uint8* packed = ChromeSystem::getStagingArena().acquire(rowSize * hig);
+
+        for (size_t jj = 0; jj < hig; ++jj)
+        {
+            memcpy(packed + jj * rowSize, static_cast<const uint8*>(source) + jj * sourcePitch, rowSize);
+        }
+
+        source = packed;
+        sourcePitch = rowSize;
+    }
+
+    // save old states
+    GLint oldTexture;
+    glGetIntegerv(GL_TEXTURE_BINDING_2D, &oldTexture);
+    GLint oldRowLength;
+    glGetIntegerv(GL_UNPACK_ROW_LENGTH, &oldRowLength);
+    GLint oldAlignment;
+    glGetIntegerv(GL_UNPACK_ALIGNMENT, &oldAlignment);
+
+    glBindTexture(GL_TEXTURE_2D, static_cast<OpenGLTexture&>(texture).getOpenGLTexture());
+    glPixelStorei(GL_UNPACK_ROW_LENGTH, static_cast<GLint>(sourcePitch / bytesPerPixel));
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+
+    glTexSubImage2D(GL_TEXTURE_2D, 0,
+        static_cast<GLint>(area.left()), static_cast<GLint>(area.top()),
+        static_cast<GLsizei>(area.getWidth()), static_cast<GLsizei>(area.getHeight()),
+        GL_BGRA, GL_UNSIGNED_BYTE, source);
+
+    // restore previous states
+    glPixelStorei(GL_UNPACK_ALIGNMENT, oldAlignment);
+    glPixelStorei(GL_UNPACK_ROW_LENGTH, oldRowLength);
+    glBindTexture(GL_TEXTURE_2D, static_cast<GLuint>(oldTexture));
+}
+
+ChromePixelKernels::PixelLayout ChromeOpenGLTextureUploader::getPixelLayout() const
+{
+    return ChromePixelKernels::PL_BGRA;
+}
+
+}
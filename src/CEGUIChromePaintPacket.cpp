@@ -0,0 +1,52 @@
+/***********************************************************************
+    filename:   CEGUIChromePaintPacket.cpp
+    created:    16/10/2026
+    author:     Martin Preisler
+*************************************************************************/
+/***************************************************************************
+ *   Copyright (C) 2011 Martin Preisler
+ *
+ *   Permission is hereby granted, free of charge, to any person obtaining
+ *   a copy of this software and associated documentation files (the
+ *   "Software"), to deal in the Software without restriction, including
+ *   without limitation the rights to use, copy, modify, merge, publish,
+ *   distribute, sublicense, and/or sell copies of the Software, and to
+ *   permit persons to whom the Software is furnished to do so, subject to
+ *   the following conditions:
+ *
+ *   The above copyright notice and this permission notice shall be
+ *   included in all copies or substantial portions of the Software.
+ *
+ *   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ *   EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ *   MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ *   IN NO EVENT SHALL THE AUTHORS BE LIABLE FOR ANY CLAIM, DAMAGES OR
+ *   OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+ *   ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ *   OTHER DEALINGS IN THE SOFTWARE.
+ ***************************************************************************/
+
+#include "CEGUIChromePaintPacket.h"
+
+namespace CEGUI
+{
+
+ChromePaintPacket::ChromePaintPacket():
+    d_widgetId(0),
+    d_dx(0),
+    d_dy(0),
+    d_scrollRect(0, 0, 0, 0)
+{}
+
+void ChromePaintPacket::clear()
+{
+    d_widgetId = 0;
+    d_dx = 0;
+    d_dy = 0;
+    d_scrollRect = Rectf(0, 0, 0, 0);
+    d_copyRects.clear();
+    d_pixels.clear();
+    d_hostMessages.clear();
+}
+
+}
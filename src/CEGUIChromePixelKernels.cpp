@@ -0,0 +1,570 @@
+/***********************************************************************
+    filename:   CEGUIChromePixelKernels.cpp
+    created:    16/10/2026
+    author:     Martin Preisler
+*************************************************************************/
+/***************************************************************************
+ *   Copyright (C) 2011 Martin Preisler
+ *
+ *   Permission is hereby granted, free of charge, to any person obtaining
+ *   a copy of this software and associated documentation files (the
+ *   "Software"), to deal in the Software without restriction, including
+ *   without limitation the rights to use, copy, modify, merge, publish,
+ *   distribute, sublicense, and/or sell copies of the Software, and to
+ *   permit persons to whom the Software is furnished to do so, subject to
+ *   the following conditions:
+ *
+ *   The above copyright notice and this permission notice shall be
+ *   included in all copies or substantial portions of the Software.
+ *
+ *   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ *   EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ *   MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ *   IN NO EVENT SHALL THE AUTHORS BE LIABLE FOR ANY CLAIM, DAMAGES OR
+ *   OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+ *   ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ *   OTHER DEALINGS IN THE SOFTWARE.
+ ***************************************************************************/
+
+#include "CEGUIChromePixelKernels.h"
+#include "CEGUIChromeCPUFeatures.h"
+
+#include <cstring>
+#include <mutex>
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86)
+#   define CHROMED_CEGUI_X86
+#   include <emmintrin.h>
+#   include <immintrin.h>
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+#   define CHROMED_CEGUI_NEON
+#   include <arm_neon.h>
+#endif
+
+// lets us use SSE2 and AVX2 intrinsics in chosen functions without compiling everything for them
+#if defined(CHROMED_CEGUI_X86) && (defined(__GNUC__) || defined(__clang__))
+#   define CHROMED_CEGUI_TARGET_SSE2 __attribute__((target("sse2")))
+#   define CHROMED_CEGUI_TARGET_AVX2 __attribute__((target("avx2")))
+#else
+#   define CHROMED_CEGUI_TARGET_SSE2
+#   define CHROMED_CEGUI_TARGET_AVX2
+#endif
+
+namespace CEGUI
+{
+
+std::atomic<ChromePixelKernels::InstructionSet> ChromePixelKernels::ds_instructionSet(ChromePixelKernels::IS_Scalar);
+//! guards detection of the default instruction set
+static std::once_flag s_detectOnce;
+
+/*************************************************************************
+    Scalar reference kernels
+*************************************************************************/
+
+//! round(value * alpha / 255) without division
+static inline uint8 multiplyByAlpha(uint32 value, uint32 alpha)
+{
+    const uint32 t = value * alpha + 128;
+
+    return static_cast<uint8>((t + (t >> 8)) >> 8);
+}
+
+//! value * 255 / alpha rounded and saturated, written so that vectorised versions can match it exactly
+static inline uint8 divideByAlpha(uint32 value, float reciprocal)
+{
+    const int ret = static_cast<int>(static_cast<float>(value) * reciprocal + 0.5f);
+
+    return static_cast<uint8>(ret > 255 ? 255 : ret);
+}
+
+static void scalarCopy(uint8* destination, const uint8* source, size_t pixelCount)
+{
+    if (destination != source)
+    {
+        memcpy(destination, source, pixelCount * 4);
+    }
+}
+
+static void scalarSwizzle(uint8* destination, const uint8* source, size_t pixelCount)
+{
+    for (size_t i = 0; i < pixelCount; ++i, destination += 4, source += 4)
+    {
+        const uint8 first = source[0];
+        destination[0] = source[2];
+        destination[1] = source[1];
+        destination[2] = first;
+        destination[3] = source[3];
+    }
+}
+
+static void scalarPremultiply(uint8* destination, const uint8* source, size_t pixelCount)
+{
+    for (size_t i = 0; i < pixelCount; ++i, destination += 4, source += 4)
+    {
+        const uint32 alpha = source[3];
+        destination[0] = multiplyByAlpha(source[0], alpha);
+        destination[1] = multiplyByAlpha(source[1], alpha);
+        destination[2] = multiplyByAlpha(source[2], alpha);
+        destination[3] = static_cast<uint8>(alpha);
+    }
+}
+
+static void scalarSwizzlePremultiply(uint8* destination, const uint8* source, size_t pixelCount)
+{
+    for (size_t i = 0; i < pixelCount; ++i, destination += 4, source += 4)
+    {
+        const uint32 alpha = source[3];
+        const uint8 first = multiplyByAlpha(source[0], alpha);
+        destination[0] = multiplyByAlpha(source[2], alpha);
+        destination[1] = multiplyByAlpha(source[1], alpha);
+        destination[2] = first;
+        destination[3] = static_cast<uint8>(alpha);
+    }
+}
+
+static void scalarUnpremultiply(uint8* destination, const uint8* source, size_t pixelCount)
+{
+    for (size_t i = 0; i < pixelCount; ++i, destination += 4, source += 4)
+    {
+        const uint32 alpha = source[3];
+        const float reciprocal = alpha == 0 ? 0.0f : 255.0f / static_cast<float>(alpha);
+        destination[0] = divideByAlpha(source[0], reciprocal);
+        destination[1] = divideByAlpha(source[1], reciprocal);
+        destination[2] = divideByAlpha(source[2], reciprocal);
+        destination[3] = static_cast<uint8>(alpha);
+    }
+}
+
+static void scalarSwizzleUnpremultiply(uint8* destination, const uint8* source, size_t pixelCount)
+{
+    for (size_t i = 0; i < pixelCount; ++i, destination += 4, source += 4)
+    {
+        const uint32 alpha = source[3];
+        const float reciprocal = alpha == 0 ? 0.0f : 255.0f / static_cast<float>(alpha);
+        const uint8 first = divideByAlpha(source[0], reciprocal);
+        destination[0] = divideByAlpha(source[2], reciprocal);
+        destination[1] = divideByAlpha(source[1], reciprocal);
+        destination[2] = first;
+        destination[3] = static_cast<uint8>(alpha);
+    }
+}
+
+#ifdef CHROMED_CEGUI_X86
+/*************************************************************************
+    SSE2 kernels, 4 pixels at a time
+*************************************************************************/
+
+CHROMED_CEGUI_TARGET_SSE2
+static inline __m128i sse2Swizzle(__m128i pixels)
+{
+    // alpha and the middle channel stay, the other two swap places within each 32bit pixel
+    const __m128i keepMask = _mm_set1_epi32(static_cast<int>(0xFF00FF00));
+    const __m128i swapped = _mm_andnot_si128(keepMask, pixels);
+
+    return _mm_or_si128(_mm_and_si128(pixels, keepMask),
+                        _mm_or_si128(_mm_slli_epi32(swapped, 16), _mm_srli_epi32(swapped, 16)));
+}
+
+//! premultiplies 2 pixels unpacked to 16bit channels
+CHROMED_CEGUI_TARGET_SSE2
+static inline __m128i sse2MultiplyByAlpha(__m128i channels)
+{
+    // broadcast alpha to all 4 channels of each pixel, alpha itself gets multiplied by 255 to stay the same
+    __m128i alpha = _mm_shufflehi_epi16(_mm_shufflelo_epi16(channels, _MM_SHUFFLE(3, 3, 3, 3)), _MM_SHUFFLE(3, 3, 3, 3));
+    alpha = _mm_or_si128(_mm_and_si128(alpha, _mm_set_epi16(0, -1, -1, -1, 0, -1, -1, -1)),
+                         _mm_set_epi16(255, 0, 0, 0, 255, 0, 0, 0));
+
+    const __m128i t = _mm_add_epi16(_mm_mullo_epi16(channels, alpha), _mm_set1_epi16(128));
+
+    return _mm_srli_epi16(_mm_add_epi16(t, _mm_srli_epi16(t, 8)), 8);
+}
+
+CHROMED_CEGUI_TARGET_SSE2
+static inline __m128i sse2Premultiply(__m128i pixels)
+{
+    const __m128i zero = _mm_setzero_si128();
+
+    return _mm_packus_epi16(sse2MultiplyByAlpha(_mm_unpacklo_epi8(pixels, zero)),
+                            sse2MultiplyByAlpha(_mm_unpackhi_epi8(pixels, zero)));
+}
+
+CHROMED_CEGUI_TARGET_SSE2
+static inline __m128i sse2Unpremultiply(__m128i pixels)
+{
+    const __m128i byteMask = _mm_set1_epi32(0xFF);
+
+    const __m128i alpha = _mm_srli_epi32(pixels, 24);
+    const __m128 alphaFloat = _mm_cvtepi32_ps(alpha);
+    // alpha 0 gives reciprocal 0, just like the scalar version
+    const __m128 reciprocal = _mm_and_ps(
+        _mm_div_ps(_mm_set1_ps(255.0f), alphaFloat),
+        _mm_castsi128_ps(_mm_cmpgt_epi32(alpha, _mm_setzero_si128())));
+
+    __m128i ret = _mm_slli_epi32(alpha, 24);
+    for (int shift = 0; shift < 24; shift += 8)
+    {
+        const __m128i channel = _mm_and_si128(_mm_srl_epi32(pixels, _mm_cvtsi32_si128(shift)), byteMask);
+        __m128i divided = _mm_cvttps_epi32(
+            _mm_add_ps(_mm_mul_ps(_mm_cvtepi32_ps(channel), reciprocal), _mm_set1_ps(0.5f)));
+        // saturate to 255, values are never negative
+        const __m128i overflow = _mm_cmpgt_epi32(divided, byteMask);
+        divided = _mm_or_si128(_mm_andnot_si128(overflow, divided), _mm_and_si128(overflow, byteMask));
+
+        ret = _mm_or_si128(ret, _mm_sll_epi32(divided, _mm_cvtsi32_si128(shift)));
+    }
+
+    return ret;
+}
+
+#define CHROMED_CEGUI_SSE2_KERNEL(name, operation, scalarTail) \
+    CHROMED_CEGUI_TARGET_SSE2 \
+    static void name(uint8* destination, const uint8* source, size_t pixelCount) \
+    { \
+        size_t i = 0; \
+        for (; i + 4 <= pixelCount; i += 4) \
+        { \
+            const __m128i pixels = _mm_loadu_si128(reinterpret_cast<const __m128i*>(source + i * 4)); \
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(destination + i * 4), operation); \
+        } \
+        scalarTail(destination + i * 4, source + i * 4, pixelCount - i); \
+    }
+
+CHROMED_CEGUI_SSE2_KERNEL(sse2SwizzleKernel, sse2Swizzle(pixels), scalarSwizzle)
+CHROMED_CEGUI_SSE2_KERNEL(sse2PremultiplyKernel, sse2Premultiply(pixels), scalarPremultiply)
+CHROMED_CEGUI_SSE2_KERNEL(sse2SwizzlePremultiplyKernel, sse2Premultiply(sse2Swizzle(pixels)), scalarSwizzlePremultiply)
+CHROMED_CEGUI_SSE2_KERNEL(sse2UnpremultiplyKernel, sse2Unpremultiply(pixels), scalarUnpremultiply)
+CHROMED_CEGUI_SSE2_KERNEL(sse2SwizzleUnpremultiplyKernel, sse2Unpremultiply(sse2Swizzle(pixels)), scalarSwizzleUnpremultiply)
+
+#undef CHROMED_CEGUI_SSE2_KERNEL
+
+/*************************************************************************
+    AVX2 kernels, 8 pixels at a time
+*************************************************************************/
+
+CHROMED_CEGUI_TARGET_AVX2
+static inline __m256i avx2Swizzle(__m256i pixels)
+{
+    const __m256i mask = _mm256_setr_epi8(
+        2, 1, 0, 3, 6, 5, 4, 7, 10, 9, 8, 11, 14, 13, 12, 15,
+        2, 1, 0, 3, 6, 5, 4, 7, 10, 9, 8, 11, 14, 13, 12, 15);
+
+    return _mm256_shuffle_epi8(pixels, mask);
+}
+
+//! premultiplies 4 pixels unpacked to 16bit channels
+CHROMED_CEGUI_TARGET_AVX2
+static inline __m256i avx2MultiplyByAlpha(__m256i channels)
+{
+    __m256i alpha = _mm256_shufflehi_epi16(_mm256_shufflelo_epi16(channels, _MM_SHUFFLE(3, 3, 3, 3)), _MM_SHUFFLE(3, 3, 3, 3));
+    alpha = _mm256_blend_epi16(alpha, _mm256_set1_epi16(255), 0x88);
+
+    const __m256i t = _mm256_add_epi16(_mm256_mullo_epi16(channels, alpha), _mm256_set1_epi16(128));
+
+    return _mm256_srli_epi16(_mm256_add_epi16(t, _mm256_srli_epi16(t, 8)), 8);
+}
+
+CHROMED_CEGUI_TARGET_AVX2
+static inline __m256i avx2Premultiply(__m256i pixels)
+{
+    const __m256i zero = _mm256_setzero_si256();
+
+    // unpack and pack work within 128bit lanes, so the pixel order is preserved
+    return _mm256_packus_epi16(avx2MultiplyByAlpha(_mm256_unpacklo_epi8(pixels, zero)),
+                               avx2MultiplyByAlpha(_mm256_unpackhi_epi8(pixels, zero)));
+}
+
+CHROMED_CEGUI_TARGET_AVX2
+static inline __m256i avx2Unpremultiply(__m256i pixels)
+{
+    const __m256i byteMask = _mm256_set1_epi32(0xFF);
+
+    const __m256i alpha = _mm256_srli_epi32(pixels, 24);
+    const __m256 reciprocal = _mm256_and_ps(
+        _mm256_div_ps(_mm256_set1_ps(255.0f), _mm256_cvtepi32_ps(alpha)),
+        _mm256_castsi256_ps(_mm256_cmpgt_epi32(alpha, _mm256_setzero_si256())));
+
+    __m256i ret = _mm256_slli_epi32(alpha, 24);
+    for (int shift = 0; shift < 24; shift += 8)
+    {
+        const __m256i channel = _mm256_and_si256(_mm256_srlv_epi32(pixels, _mm256_set1_epi32(shift)), byteMask);
+        const __m256i divided = _mm256_min_epi32(byteMask, _mm256_cvttps_epi32(
+            _mm256_add_ps(_mm256_mul_ps(_mm256_cvtepi32_ps(channel), reciprocal), _mm256_set1_ps(0.5f))));
+
+        ret = _mm256_or_si256(ret, _mm256_sllv_epi32(divided, _mm256_set1_epi32(shift)));
+    }
+
+    return ret;
+}
+
+#define CHROMED_CEGUI_AVX2_KERNEL(name, operation, tail) \
+    CHROMED_CEGUI_TARGET_AVX2 \
+    static void name(uint8* destination, const uint8* source, size_t pixelCount) \
+    { \
+        size_t i = 0; \
+        for (; i + 8 <= pixelCount; i += 8) \
+        { \
+            const __m256i pixels = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(source + i * 4)); \
+            _mm256_storeu_si256(reinterpret_cast<__m256i*>(destination + i * 4), operation); \
+        } \
+        tail(destination + i * 4, source + i * 4, pixelCount - i); \
+    }
+
+CHROMED_CEGUI_AVX2_KERNEL(avx2SwizzleKernel, avx2Swizzle(pixels), sse2SwizzleKernel)
+CHROMED_CEGUI_AVX2_KERNEL(avx2PremultiplyKernel, avx2Premultiply(pixels), sse2PremultiplyKernel)
+CHROMED_CEGUI_AVX2_KERNEL(avx2SwizzlePremultiplyKernel, avx2Premultiply(avx2Swizzle(pixels)), sse2SwizzlePremultiplyKernel)
+CHROMED_CEGUI_AVX2_KERNEL(avx2UnpremultiplyKernel, avx2Unpremultiply(pixels), sse2UnpremultiplyKernel)
+CHROMED_CEGUI_AVX2_KERNEL(avx2SwizzleUnpremultiplyKernel, avx2Unpremultiply(avx2Swizzle(pixels)), sse2SwizzleUnpremultiplyKernel)
+
+#undef CHROMED_CEGUI_AVX2_KERNEL
+#endif
+
+#ifdef CHROMED_CEGUI_NEON
+/*************************************************************************
+    NEON kernels, 8 pixels at a time
+*************************************************************************/
+
+//! premultiplies one channel of 8 pixels
+static inline uint8x8_t neonMultiplyByAlpha(uint8x8_t channel, uint8x8_t alpha)
+{
+    const uint16x8_t t = vaddq_u16(vmull_u8(channel, alpha), vdupq_n_u16(128));
+
+    return vshrn_n_u16(vaddq_u16(t, vshrq_n_u16(t, 8)), 8);
+}
+
+static void neonSwizzleKernel(uint8* destination, const uint8* source, size_t pixelCount)
+{
+    size_t i = 0;
+    for (; i + 8 <= pixelCount; i += 8)
+    {
+        uint8x8x4_t pixels = vld4_u8(source + i * 4);
+        const uint8x8_t first = pixels.val[0];
+        pixels.val[0] = pixels.val[2];
+        pixels.val[2] = first;
+        vst4_u8(destination + i * 4, pixels);
+    }
+
+    scalarSwizzle(destination + i * 4, source + i * 4, pixelCount - i);
+}
+
+static void neonPremultiplyKernel(uint8* destination, const uint8* source, size_t pixelCount)
+{
+    size_t i = 0;
+    for (; i + 8 <= pixelCount; i += 8)
+    {
+        uint8x8x4_t pixels = vld4_u8(source + i * 4);
+        pixels.val[0] = neonMultiplyByAlpha(pixels.val[0], pixels.val[3]);
+        pixels.val[1] = neonMultiplyByAlpha(pixels.val[1], pixels.val[3]);
+        pixels.val[2] = neonMultiplyByAlpha(pixels.val[2], pixels.val[3]);
+        vst4_u8(destination + i * 4, pixels);
+    }
+
+    scalarPremultiply(destination + i * 4, source + i * 4, pixelCount - i);
+}
+
+static void neonSwizzlePremultiplyKernel(uint8* destination, const uint8* source, size_t pixelCount)
+{
+    size_t i = 0;
+    for (; i + 8 <= pixelCount; i += 8)
+    {
+        uint8x8x4_t pixels = vld4_u8(source + i * 4);
+        const uint8x8_t first = neonMultiplyByAlpha(pixels.val[0], pixels.val[3]);
+        pixels.val[0] = neonMultiplyByAlpha(pixels.val[2], pixels.val[3]);
+        pixels.val[1] = neonMultiplyByAlpha(pixels.val[1], pixels.val[3]);
+        pixels.val[2] = first;
+        vst4_u8(destination + i * 4, pixels);
+    }
+
+    scalarSwizzlePremultiply(destination + i * 4, source + i * 4, pixelCount - i);
+}
+#endif
+
+ChromePixelKernels::Conversion ChromePixelKernels::getConversion(PixelLayout from, PixelLayout to)
+{
+    const bool fromPremultiplied = from == PL_BGRAPremultiplied || from == PL_RGBAPremultiplied;
+    const bool toPremultiplied = to == PL_BGRAPremultiplied || to == PL_RGBAPremultiplied;
+    const bool fromBGRA = from == PL_BGRAPremultiplied || from == PL_BGRA;
+    const bool toBGRA = to == PL_BGRAPremultiplied || to == PL_BGRA;
+
+    const bool swizzle = fromBGRA != toBGRA;
+
+    if (fromPremultiplied && !toPremultiplied)
+    {
+        return swizzle ? PC_SwizzleUnpremultiply : PC_Unpremultiply;
+    }
+    else if (!fromPremultiplied && toPremultiplied)
+    {
+        return swizzle ? PC_SwizzlePremultiply : PC_Premultiply;
+    }
+
+    return swizzle ? PC_Swizzle : PC_Copy;
+}
+
+void ChromePixelKernels::convert(Conversion conversion,
+                                 uint8* destination, size_t destinationPitch,
+                                 const uint8* source, size_t sourcePitch,
+                                 size_t width, size_t height)
+{
+    const RowKernel kernel = getKernel(conversion);
+
+    // contiguous rows can be converted in one go
+    if (destinationPitch == width * 4 && sourcePitch == width * 4)
+    {
+        kernel(destination, source, width * height);
+        return;
+    }
+
+    for (size_t jj = 0; jj < height; ++jj)
+    {
+        kernel(destination, source, width);
+
+        destination += destinationPitch;
+        source += sourcePitch;
+    }
+}
+
+ChromePixelKernels::RowKernel ChromePixelKernels::getKernel(Conversion conversion)
+{
+    ensureDetected();
+
+    // fall back to lesser instruction sets until we find an implementation
+    switch (ds_instructionSet.load(std::memory_order_relaxed))
+    {
+    case IS_AVX2:
+        if (RowKernel kernel = getKernel(conversion, IS_AVX2))
+            return kernel;
+        // fall through
+    case IS_SSE2:
+        if (RowKernel kernel = getKernel(conversion, IS_SSE2))
+            return kernel;
+        break;
+    case IS_NEON:
+        if (RowKernel kernel = getKernel(conversion, IS_NEON))
+            return kernel;
+        break;
+
+    default:
+        break;
+    }
+
+    return getKernel(conversion, IS_Scalar);
+}
+
+ChromePixelKernels::RowKernel ChromePixelKernels::getKernel(Conversion conversion, InstructionSet instructionSet)
+{
+    if (!isInstructionSetSupported(instructionSet))
+    {
+        return 0;
+    }
+
+    // the copy is memcpy everywhere, it's as vectorised as it gets
+    static const RowKernel scalarKernels[PC_Count] =
+    {
+        scalarCopy, scalarSwizzle, scalarPremultiply, scalarSwizzlePremultiply,
+        scalarUnpremultiply, scalarSwizzleUnpremultiply
+    };
+
+#ifdef CHROMED_CEGUI_X86
+    static const RowKernel sse2Kernels[PC_Count] =
+    {
+        scalarCopy, sse2SwizzleKernel, sse2PremultiplyKernel, sse2SwizzlePremultiplyKernel,
+        sse2UnpremultiplyKernel, sse2SwizzleUnpremultiplyKernel
+    };
+    static const RowKernel avx2Kernels[PC_Count] =
+    {
+        scalarCopy, avx2SwizzleKernel, avx2PremultiplyKernel, avx2SwizzlePremultiplyKernel,
+        avx2UnpremultiplyKernel, avx2SwizzleUnpremultiplyKernel
+    };
+#endif
+
+#ifdef CHROMED_CEGUI_NEON
+    // unpremultiplying needs division, NEON only has reciprocal estimates that wouldn't match the scalar version
+    static const RowKernel neonKernels[PC_Count] =
+    {
+        scalarCopy, neonSwizzleKernel, neonPremultiplyKernel, neonSwizzlePremultiplyKernel,
+        0, 0
+    };
+#endif
+
+    if (conversion >= PC_Count)
+    {
+        return 0;
+    }
+
+    switch (instructionSet)
+    {
+    case IS_Scalar:
+        return scalarKernels[conversion];
+#ifdef CHROMED_CEGUI_X86
+    case IS_SSE2:
+        return sse2Kernels[conversion];
+    case IS_AVX2:
+        return avx2Kernels[conversion];
+#endif
+#ifdef CHROMED_CEGUI_NEON
+    case IS_NEON:
+        return neonKernels[conversion];
+#endif
+
+    default:
+        return 0;
+    }
+}
+
+bool ChromePixelKernels::isInstructionSetSupported(InstructionSet instructionSet)
+{
+    switch (instructionSet)
+    {
+    case IS_Scalar:
+        return true;
+    case IS_SSE2:
+        return ChromeCPUFeatures::isSupported(ChromeCPUFeatures::CF_SSE2);
+    case IS_AVX2:
+        return ChromeCPUFeatures::isSupported(ChromeCPUFeatures::CF_AVX2);
+    case IS_NEON:
+        return ChromeCPUFeatures::isSupported(ChromeCPUFeatures::CF_NEON);
+
+    default:
+        return false;
+    }
+}
+
+ChromePixelKernels::InstructionSet ChromePixelKernels::getInstructionSet()
+{
+    ensureDetected();
+
+    return ds_instructionSet.load(std::memory_order_relaxed);
+}
+
+void ChromePixelKernels::setInstructionSet(InstructionSet instructionSet)
+{
+    // detection must not overwrite the override later
+    ensureDetected();
+
+    ds_instructionSet.store(isInstructionSetSupported(instructionSet) ? instructionSet : IS_Scalar,
+                            std::memory_order_relaxed);
+}
+
+void ChromePixelKernels::ensureDetected()
+{
+    std::call_once(s_detectOnce, []()
+    {
+        InstructionSet instructionSet = IS_Scalar;
+
+        if (isInstructionSetSupported(IS_AVX2))
+        {
+            instructionSet = IS_AVX2;
+        }
+        else if (isInstructionSetSupported(IS_SSE2))
+        {
+            instructionSet = IS_SSE2;
+        }
+        else if (isInstructionSetSupported(IS_NEON))
+        {
+            instructionSet = IS_NEON;
+        }
+
+        ds_instructionSet.store(instructionSet, std::memory_order_relaxed);
+    });
+}
+
+}
@@ -0,0 +1,414 @@
+/***********************************************************************
+    filename:   CEGUIChromeRasterCache.cpp
+    created:    16/10/2026
+    author:     Martin Preisler
+*************************************************************************/
+/***************************************************************************
+ *   Copyright (C) 2011 Martin Preisler
+ *
+ *   Permission is hereby granted, free of charge, to any person obtaining
+ *   a copy of this software and associated documentation files (the
+ *   "Software"), to deal in the Software without restriction, including
+ *   without limitation the rights to use, copy, modify, merge, publish,
+ *   distribute, sublicense, and/or sell copies of the Software, and to
+ *   permit persons to whom the Software is furnished to do so, subject to
+ *   the following conditions:
+ *
+ *   The above copyright notice and this permission notice shall be
+ *   included in all copies or substantial portions of the Software.
+ *
+ *   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ *   EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ *   MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ *   IN NO EVENT SHALL THE AUTHORS BE LIABLE FOR ANY CLAIM, DAMAGES OR
+ *   OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+ *   ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ *   OTHER DEALINGS IN THE SOFTWARE.
+ ***************************************************************************/
+
+#include "CEGUIChromeRasterCache.h"
+
+#include <cstdio>
+#include <cstring>
+#include <sys/types.h>
+#include <sys/stat.h>
+
+#ifdef _WIN32
+#   include <windows.h>
+#   include <sys/utime.h>
+#else
+#   include <dirent.h>
+#   include <fcntl.h>
+#   include <unistd.h>
+#   include <utime.h>
+#   include <sys/mman.h>
+#endif
+
+namespace CEGUI
+{
+
+//! extension of entry files, nothing else in the directory is touched
+static const char RasterFileExtension[] = ".ccraster";
+
+//! identifies entry files, the last character is the format version
+static const char RasterFileMagic[8] = {'C', 'E', 'G', 'U', 'I', 'C', 'R', '1'};
+
+//! header of an entry file, the pixels follow right after it
+struct RasterFileHeader
+{
+    char d_magic[8];
+    uint32 d_width;
+    uint32 d_height;
+    //! size of one row of pixels in bytes
+    uint32 d_pitch;
+    //! ChromePixelKernels::PixelLayout of the pixels
+    uint32 d_pixelLayout;
+    uint32 d_reserved[2];
+};
+
+static_assert(sizeof(RasterFileHeader) == 32, "entry files are read and written as they are in memory");
+
+ChromeRasterCache::ChromeRasterCache():
+    d_capacity(64 * 1024 * 1024),
+    d_size(0),
+    d_hitCount(0),
+    d_missCount(0),
+    d_mappedData(0),
+    d_mappedSize(0)
+#ifdef _WIN32
+    , d_mappingHandle(0)
+#endif
+{}
+
+ChromeRasterCache::~ChromeRasterCache()
+{
+    unmap();
+}
+
+void ChromeRasterCache::setDirectory(const String& directory)
+{
+    unmap();
+
+    d_directory = directory;
+    d_path = directory.c_str();
+    d_entries.clear();
+    d_size = 0;
+
+    if (d_path.empty())
+    {
+        return;
+    }
+
+    const char last = d_path[d_path.size() - 1];
+    if (last != '/' && last != '\\')
+    {
+        d_path += '/';
+    }
+
+    scanDirectory();
+    trim(d_capacity);
+}
+
+const String& ChromeRasterCache::getDirectory() const
+{
+    return d_directory;
+}
+
+bool ChromeRasterCache::isEnabled() const
+{
+    return !d_path.empty();
+}
+
+void ChromeRasterCache::setCapacity(size_t bytes)
+{
+    d_capacity = bytes;
+
+    trim(d_capacity);
+}
+
+size_t ChromeRasterCache::getCapacity() const
+{
+    return d_capacity;
+}
+
+size_t ChromeRasterCache::getSize() const
+{
+    return d_size;
+}
+
+size_t ChromeRasterCache::getHitCount() const
+{
+    return d_hitCount;
+}
+
+size_t ChromeRasterCache::getMissCount() const
+{
+    return d_missCount;
+}
+
+bool ChromeRasterCache::contains(const Key& key) const
+{
+    return isEnabled() && d_entries.find(getEntryName(key)) != d_entries.end();
+}
+
+const uint8* ChromeRasterCache::map(const Key& key, size_t& pitch)
+{
+    unmap();
+
+    const std::string name(getEntryName(key));
+    EntryMap::iterator it = d_entries.find(name);
+
+    if (!isEnabled() || it == d_entries.end())
+    {
+        ++d_missCount;
+        return 0;
+    }
+
+    const std::string path(d_path + name);
+
+#ifdef _WIN32
+    HANDLE file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, 0, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, 0);
+    if (file != INVALID_HANDLE_VALUE)
+    {
+        LARGE_INTEGER fileSize;
+        if (GetFileSizeEx(file, &fileSize) && fileSize.QuadPart > 0)
+        {
+            d_mappingHandle = CreateFileMappingA(file, 0, PAGE_READONLY, 0, 0, 0);
+            if (d_mappingHandle)
+            {
+                d_mappedData = MapViewOfFile(d_mappingHandle, FILE_MAP_READ, 0, 0, 0);
+                d_mappedSize = static_cast<size_t>(fileSize.QuadPart);
+            }
+        }
+
+        // the mapping keeps the file open
+        CloseHandle(file);
+    }
+#else
+    const int file = open(path.c_str(), O_RDONLY);
+    if (file >= 0)
+    {
+        struct stat info;
+        if (fstat(file, &info) == 0 && info.st_size > 0)
+        {
+            void* data = mmap(0, static_cast<size_t>(info.st_size), PROT_READ, MAP_PRIVATE, file, 0);
+            if (data != MAP_FAILED)
+            {
+                d_mappedData = data;
+                d_mappedSize = static_cast<size_t>(info.st_size);
+            }
+        }
+
+        // the mapping keeps the file open
+        close(file);
+    }
+#endif
+
+    const RasterFileHeader* header = static_cast<const RasterFileHeader*>(d_mappedData);
+
+    if (!header || d_mappedSize < sizeof(RasterFileHeader) ||
+        memcmp(header->d_magic, RasterFileMagic, sizeof(RasterFileMagic)) != 0 ||
+        header->d_width != key.d_width || header->d_height != key.d_height ||
+        header->d_pixelLayout != key.d_pixelLayout || header->d_pitch < key.d_width * 4 ||
+        d_mappedSize < sizeof(RasterFileHeader) + static_cast<size_t>(header->d_pitch) * header->d_height)
+    {
+        // gone or damaged, either way it's useless
+        unmap();
+        removeEntry(it);
+
+        ++d_missCount;
+        return 0;
+    }
+
+    ++d_hitCount;
+
+    // the modification time orders entries across runs
+    it->second.d_lastUse = time(0);
+    utime(path.c_str(), 0);
+
+    pitch = header->d_pitch;
+    return static_cast<const uint8*>(d_mappedData) + sizeof(RasterFileHeader);
+}
+
+void ChromeRasterCache::unmap()
+{
+    if (!d_mappedData)
+    {
+#ifdef _WIN32
+        if (d_mappingHandle)
+        {
+            CloseHandle(d_mappingHandle);
+            d_mappingHandle = 0;
+        }
+#endif
+        return;
+    }
+
+#ifdef _WIN32
+    UnmapViewOfFile(d_mappedData);
+    CloseHandle(d_mappingHandle);
+    d_mappingHandle = 0;
+#else
+    munmap(d_mappedData, d_mappedSize);
+#endif
+
+    d_mappedData = 0;
+    d_mappedSize = 0;
+}
+
+void ChromeRasterCache::store(const Key& key, const uint8* pixels, size_t pitch)
+{
+    if (!isEnabled())
+    {
+        return;
+    }
+
+    const size_t rowSize = static_cast<size_t>(key.d_width) * 4;
+    const size_t fileSize = sizeof(RasterFileHeader) + rowSize * key.d_height;
+
+    if (fileSize > d_capacity)
+    {
+        return;
+    }
+
+    unmap();
+
+    const std::string name(getEntryName(key));
+    EntryMap::iterator it = d_entries.find(name);
+    if (it != d_entries.end())
+    {
+        removeEntry(it);
+    }
+
+    trim(d_capacity - fileSize);
+
+    RasterFileHeader header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.d_magic, RasterFileMagic, sizeof(RasterFileMagic));
+    header.d_width = key.d_width;
+    header.d_height = key.d_height;
+    header.d_pitch = static_cast<uint32>(rowSize);
+    header.d_pixelLayout = key.d_pixelLayout;
+
+    // written under another name first, a crash mustn't leave a truncated entry behind
+    const std::string path(d_path + name);
+    const std::string temporaryPath(path + ".tmp");
+
+    FILE* file = fopen(temporaryPath.c_str(), "wb");
+    if (!file)
+    {
+        return;
+    }
+
+    bool written = fwrite(&header, sizeof(header), 1, file) == 1;
+    for (uint jj = 0; written && jj < key.d_height; ++jj)
+    {
+        written = fwrite(pixels + jj * pitch, 1, rowSize, file) == rowSize;
+    }
+
+    written = fclose(file) == 0 && written;
+
+    if (!written || rename(temporaryPath.c_str(), path.c_str()) != 0)
+    {
+        remove(temporaryPath.c_str());
+        return;
+    }
+
+    Entry& entry = d_entries[name];
+    entry.d_size = fileSize;
+    entry.d_lastUse = time(0);
+    d_size += fileSize;
+}
+
+void ChromeRasterCache::clear()
+{
+    unmap();
+
+    trim(0);
+}
+
+std::string ChromeRasterCache::getEntryName(const Key& key)
+{
+    char name[96];
+    snprintf(name, sizeof(name), "%016llx-%ux%u-%u-%u-%u%s",
+        static_cast<unsigned long long>(key.d_contentHash), key.d_width, key.d_height,
+        static_cast<uint>(key.d_detailRatio * 1000.0f + 0.5f), key.d_transparent ? 1u : 0u,
+        key.d_pixelLayout, RasterFileExtension);
+
+    return name;
+}
+
+void ChromeRasterCache::scanDirectory()
+{
+    const size_t extensionLength = sizeof(RasterFileExtension) - 1;
+
+#ifdef _WIN32
+    WIN32_FIND_DATAA found;
+    HANDLE search = FindFirstFileA((d_path + "*" + RasterFileExtension).c_str(), &found);
+    if (search == INVALID_HANDLE_VALUE)
+    {
+        return;
+    }
+
+    do
+    {
+        const std::string name(found.cFileName);
+#else
+    DIR* directory = opendir(d_path.c_str());
+    if (!directory)
+    {
+        return;
+    }
+
+    while (dirent* found = readdir(directory))
+    {
+        const std::string name(found->d_name);
+#endif
+        struct stat info;
+        if (name.size() > extensionLength &&
+            name.compare(name.size() - extensionLength, extensionLength, RasterFileExtension) == 0 &&
+            stat((d_path + name).c_str(), &info) == 0)
+        {
+            Entry& entry = d_entries[name];
+            entry.d_size = static_cast<size_t>(info.st_size);
+            entry.d_lastUse = info.st_mtime;
+            d_size += entry.d_size;
+        }
+#ifdef _WIN32
+    }
+    while (FindNextFileA(search, &found));
+
+    FindClose(search);
+#else
+    }
+
+    closedir(directory);
+#endif
+}
+
+void ChromeRasterCache::trim(size_t size)
+{
+    while (d_size > size && !d_entries.empty())
+    {
+        EntryMap::iterator oldest = d_entries.begin();
+        for (EntryMap::iterator it = d_entries.begin(); it != d_entries.end(); ++it)
+        {
+            if (it->second.d_lastUse < oldest->second.d_lastUse)
+            {
+                oldest = it;
+            }
+        }
+
+        removeEntry(oldest);
+    }
+}
+
+void ChromeRasterCache::removeEntry(EntryMap::iterator it)
+{
+    remove((d_path + it->first).c_str());
+
+    d_size -= it->second.d_size;
+    d_entries.erase(it);
+}
+
+}
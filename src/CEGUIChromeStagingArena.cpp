@@ -0,0 +1,102 @@
+/***********************************************************************
+    filename:   CEGUIChromeStagingArena.cpp
+    created:    16/10/2026
+    author:     Martin Preisler
+*************************************************************************/
+/***************************************************************************
+ *   Copyright (C) 2011 Martin Preisler
+ *
+ *   Permission is hereby granted, free of charge, to any person obtaining
+ *   a copy of this software and associated documentation files (the
+ *   "Software"), to deal in the Software without restriction, including
+ *   without limitation the rights to use, copy, modify, merge, publish,
+ *   distribute, sublicense, and/or sell copies of the Software, and to
+ *   permit persons to whom the Software is furnished to do so, subject to
+ *   the following conditions:
+ *
+ *   The above copyright notice and this permission notice shall be
+ *   included in all copies or substantial portions of the Software.
+ *
+ *   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ *   EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ *   MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ *   IN NO EVENT SHALL THE AUTHORS BE LIABLE FOR ANY CLAIM, DAMAGES OR
+ *   OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+ *   ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ *   OTHER DEALINGS IN THE SOFTWARE.
+ ***************************************************************************/
+
+#include "CEGUIChromeStagingArena.h"
+
+namespace CEGUI
+{
+
+ChromeStagingArena::ChromeStagingArena():
+    d_buffer(0),
+    d_capacity(0),
+    d_peak(0)
+{}
+
+ChromeStagingArena::~ChromeStagingArena()
+{
+    release();
+}
+
+uint8* ChromeStagingArena::acquire(size_t size)
+{
+    if (size > d_peak)
+    {
+        d_peak = size;
+    }
+
+    if (size > d_capacity.load(std::memory_order_relaxed))
+    {
+        reallocate(size);
+    }
+
+    return d_buffer;
+}
+
+void ChromeStagingArena::trim()
+{
+    if (d_peak < d_capacity.load(std::memory_order_relaxed))
+    {
+        reallocate(d_peak);
+    }
+
+    d_peak = 0;
+}
+
+void ChromeStagingArena::release()
+{
+    reallocate(0);
+    d_peak = 0;
+}
+
+size_t ChromeStagingArena::getCapacity() const
+{
+    return d_capacity.load(std::memory_order_relaxed);
+}
+
+size_t ChromeStagingArena::getPeak() const
+{
+    return d_peak;
+}
+
+void ChromeStagingArena::reallocate(size_t size)
+{
+    if (d_buffer)
+    {
+        CEGUI_DELETE_ARRAY_PT(d_buffer, uint8, d_capacity.load(std::memory_order_relaxed), AllocatorConfig<ChromeStagingArena>::Allocator);
+        d_buffer = 0;
+    }
+
+    if (size > 0)
+    {
+        d_buffer = CEGUI_NEW_ARRAY_PT(uint8, size, AllocatorConfig<ChromeStagingArena>::Allocator);
+    }
+
+    d_capacity.store(size, std::memory_order_relaxed);
+}
+
+}
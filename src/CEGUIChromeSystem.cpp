@@ -27,23 +27,326 @@
  ***************************************************************************/
 
 #include "CEGUIChromeSystem.h"
+#include "CEGUIChromeWidget.h"
 
 #include "CEGUIChromeHTML.h"
 #include "CEGUIChromeImage.h"
 #include "CEGUIChromeFlash.h"
+#include "CEGUIChromeTextureUploader.h"
+#include "CEGUIChromePaintPacket.h"
+#include "CEGUIChromeSpscQueue.h"
+#include "CEGUIChromeStagingArena.h"
+#include "CEGUIChromeRasterCache.h"
+#ifdef CHROMED_CEGUI_HAVE_OPENGL_UPLOADER
+#   include "CEGUIChromeOpenGLTextureUploader.h"
+#endif
 
 #include "CEGUIExceptions.h"
 #include "CEGUIWindowFactoryManager.h"
 #include "CEGUITplWindowFactory.h"
+#include "CEGUISystem.h"
+#include "CEGUIDefaultResourceProvider.h"
+#include "CEGUIRenderer.h"
+#include "CEGUIRenderingRoot.h"
+#include "CEGUITexture.h"
+#include "CEGUIPropertyHelper.h"
 
 #include <berkelium/Berkelium.hpp>
 #include <berkelium/Context.hpp>
+#include <berkelium/Window.hpp>
+#include <berkelium/WindowDelegate.hpp>
+
+#include <thread>
+#include <chrono>
+#include <mutex>
+#include <algorithm>
+#include <list>
+#include <ctime>
+#include <cctype>
+#include <cstdlib>
+#include <cstring>
+#include <climits>
+#include <sys/stat.h>
 
 namespace CEGUI
 {
 
+//! the scheduler never skips more frames in a row than this, no matter how long an update took
+static const float MaxSkippedFrames = 8.0f;
+
+//! new pooled textures are rounded up to multiples of this so that similar sizes can share them
+static const float TexturePoolGranularity = 64.0f;
+
+//! rounds given size up to TexturePoolGranularity
+static float roundUpToTexturePoolGranularity(float value)
+{
+    return std::ceil(value / TexturePoolGranularity) * TexturePoolGranularity;
+}
+
+//! URLs starting with this are resolved through the ResourceProvider
+static const char ResourceScheme[] = "cegui://";
+
+//! decodes %XX escapes of given URL part
+static std::string percentDecode(const char* begin, const char* end)
+{
+    std::string ret;
+    ret.reserve(end - begin);
+
+    for (const char* it = begin; it != end; ++it)
+    {
+        if (*it == '%' && end - it > 2 && isxdigit(it[1]) && isxdigit(it[2]))
+        {
+            const char hex[3] = {it[1], it[2], '\0'};
+            ret += static_cast<char>(strtol(hex, 0, 16));
+            it += 2;
+        }
+        else
+        {
+            ret += *it;
+        }
+    }
+
+    return ret;
+}
+
+//! appends given file system path to a file URL, escaping what can't be in a URL path
+static void percentEncodePath(const std::string& path, std::string& url)
+{
+    static const char hexDigits[] = "0123456789ABCDEF";
+
+    for (size_t i = 0; i < path.size(); ++i)
+    {
+        const unsigned char c = static_cast<unsigned char>(path[i]);
+
+        if (c == '\\')
+        {
+            url += '/';
+        }
+        else if (isalnum(c) || strchr("/:-_.~!$&'()*+,;=@", c))
+        {
+            url += static_cast<char>(c);
+        }
+        else
+        {
+            url += '%';
+            url += hexDigits[c >> 4];
+            url += hexDigits[c & 0xF];
+        }
+    }
+}
+
+//! makes given path absolute, fails if there is no such file
+static bool getAbsolutePath(const char* path, std::string& absolutePath, time_t* modificationTime = 0)
+{
+#ifdef _WIN32
+    char buffer[_MAX_PATH];
+    if (!_fullpath(buffer, path, _MAX_PATH))
+    {
+        return false;
+    }
+#else
+    char buffer[PATH_MAX];
+    if (!realpath(path, buffer))
+    {
+        return false;
+    }
+#endif
+
+    struct stat info;
+    if (stat(buffer, &info) != 0 || (info.st_mode & S_IFMT) != S_IFREG)
+    {
+        return false;
+    }
+
+    absolutePath = buffer;
+    if (modificationTime)
+    {
+        *modificationTime = info.st_mtime;
+    }
+
+    return true;
+}
+
+//! monotonic time in seconds
+static double getSchedulerTime()
+{
+    return std::chrono::duration<double>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+//! guards s_stagingArenas
+static std::mutex s_stagingArenasMutex;
+//! staging arenas of all threads, so that we can collect their statistics
+static std::vector<ChromeStagingArena*> s_stagingArenas;
+//! incremented whenever somebody asks for all staging arenas to be trimmed
+static std::atomic<uint> s_stagingTrimRequest(0);
+
+//! staging arena of one thread, registers itself so that statistics can be collected
+struct ThreadStagingArena
+{
+    ThreadStagingArena():
+        d_seenTrimRequest(s_stagingTrimRequest.load(std::memory_order_relaxed)),
+        d_lastTrimTime(getSchedulerTime())
+    {
+        std::lock_guard<std::mutex> lock(s_stagingArenasMutex);
+        s_stagingArenas.push_back(&d_arena);
+    }
+
+    ~ThreadStagingArena()
+    {
+        std::lock_guard<std::mutex> lock(s_stagingArenasMutex);
+        s_stagingArenas.erase(std::find(s_stagingArenas.begin(), s_stagingArenas.end(), &d_arena));
+    }
+
+    ChromeStagingArena d_arena;
+    //! last trim request this thread has honoured
+    uint d_seenTrimRequest;
+    //! when was the arena last trimmed
+    double d_lastTrimTime;
+};
+
+static thread_local ThreadStagingArena t_stagingArena;
+
+//! blank Berkelium window in the warm pool, it's its own delegate until a widget takes it
+struct WarmWindow :
+    public Berkelium::WindowDelegate,
+    public AllocatedObject<WarmWindow>
+{
+    WarmWindow(Berkelium::Window* window):
+        d_window(window),
+        d_loaded(false)
+    {
+        d_window->setDelegate(this);
+    }
+
+    virtual void onLoad(Berkelium::Window *win)
+    {
+        d_loaded = true;
+    }
+
+    Berkelium::Window* d_window;
+    //! if true, about:blank finished loading, its onLoad can't reach the widget that takes the window
+    bool d_loaded;
+};
+
+//! blank Berkelium windows ready to be taken by new widgets, oldest first, only touched on the thread that owns Berkelium
+static std::vector<WarmWindow*> s_warmWindows;
+//! reservations that found no loaded window, the main thread gives them back to ChromeSystem::ds_warmWindowCount
+static std::atomic<size_t> s_unusedWarmWindowReservations(0);
+
+//! encoded payload in the payload cache
+struct CachedPayload
+{
+    ChromeSystem::PayloadHash d_hash;
+    //! tells apart entries that reused the hash of an evicted one
+    uint d_serial;
+    std::string d_payload;
+    //! the data before encoding, hits are compared against it
+    std::string d_source;
+};
+
+//! serial of the next payload stored, 0 is never used
+static uint s_nextPayloadSerial = 1;
+
+//! cached payloads, the most recently used first
+typedef std::list<CachedPayload> PayloadList;
+static PayloadList s_payloads;
+//! payload hash -> position in s_payloads
+static std::map<ChromeSystem::PayloadHash, PayloadList::iterator> s_payloadIndex;
+
+//! what a resource on disk contained when it was last loaded
+struct ResourcePayload
+{
+    time_t d_modificationTime;
+    ChromeSystem::PayloadHash d_hash;
+};
+
+//! resource group, file name and data URI header -> payload of that resource
+static std::map<std::string, ResourcePayload> s_resourcePayloads;
+
+//! key of a resource in s_resourcePayloads
+static std::string getResourcePayloadKey(const String& filename, const String& resourceGroup, const char* header)
+{
+    return std::string(resourceGroup.c_str()) + '\n' + filename.c_str() + '\n' + header;
+}
+
+//! creates one warm window on the thread that owns Berkelium
+struct ChromeSystem::CreateWarmWindowTask :
+    public ChromeTask
+{
+    virtual void execute()
+    {
+        ChromeSystem::createWarmWindow();
+    }
+};
+
+struct ChromeSystem::PumpThread :
+    public AllocatedObject<ChromeSystem::PumpThread>
+{
+    PumpThread(float interval):
+        d_running(true),
+        d_ready(false),
+        d_interval(interval)
+    {}
+
+    std::thread d_thread;
+    //! cleared by the main thread to stop the pump thread
+    std::atomic<bool> d_running;
+    //! set by the pump thread once Berkelium is initialised
+    std::atomic<bool> d_ready;
+    //! copy of ChromeSystem::ds_pumpThreadInterval the pump thread can safely read
+    std::atomic<float> d_interval;
+
+    //! main thread -> pump thread
+    ChromeSpscQueue<ChromeTask*> d_tasks;
+    //! pump thread -> main thread
+    ChromeSpscQueue<ChromePaintPacket*> d_paintPackets;
+    //! main thread -> pump thread, applied packets ready for reuse
+    ChromeSpscQueue<ChromePaintPacket*> d_freePaintPackets;
+};
+
 bool ChromeSystem::ds_initialised = false;
 Berkelium::Context* ChromeSystem::ds_context = 0;
+ChromeTextureUploader* ChromeSystem::ds_defaultTextureUploader = 0;
+ChromeRasterCache* ChromeSystem::ds_rasterCache = 0;
+ChromeTextureUploader* ChromeSystem::ds_textureUploader = 0;
+bool ChromeSystem::ds_threadedUpdateEnabled = false;
+bool ChromeSystem::ds_lazyWindowCreationEnabled = false;
+float ChromeSystem::ds_pumpThreadInterval = 0.005f;
+ChromeSystem::PumpThread* ChromeSystem::ds_pumpThread = 0;
+size_t ChromeSystem::ds_warmWindowPoolSize = 0;
+size_t ChromeSystem::ds_warmWindowCount = 0;
+ChromeSystem::WidgetMap ChromeSystem::ds_widgets;
+uint ChromeSystem::ds_nextWidgetId = 1;
+Event::Connection ChromeSystem::ds_renderQueueConnection;
+bool ChromeSystem::ds_updatedThisFrame = false;
+bool ChromeSystem::ds_activity = false;
+uint ChromeSystem::ds_idleFrames = 0;
+uint ChromeSystem::ds_idleFrameThreshold = 60;
+float ChromeSystem::ds_idleUpdateInterval = 0.1f;
+float ChromeSystem::ds_updateTimeBudget = 0.0f;
+float ChromeSystem::ds_updateTimeDebt = 0.0f;
+double ChromeSystem::ds_lastScheduledUpdateTime = 0.0;
+ChromeSystem::TexturePool ChromeSystem::ds_texturePool;
+size_t ChromeSystem::ds_texturePoolSize = 0;
+size_t ChromeSystem::ds_texturePoolCapacity = 16 * 1024 * 1024;
+size_t ChromeSystem::ds_texturePoolHits = 0;
+size_t ChromeSystem::ds_texturePoolMisses = 0;
+uint ChromeSystem::ds_canvasTextureCounter = 0;
+float ChromeSystem::ds_stagingTrimInterval = 5.0f;
+uint ChromeSystem::ds_rendererBudget = 0;
+size_t ChromeSystem::ds_textureMemoryBudget = 0;
+size_t ChromeSystem::ds_evictionCount = 0;
+size_t ChromeSystem::ds_javascriptBytesSent = 0;
+size_t ChromeSystem::ds_payloadCacheCapacity = 8 * 1024 * 1024;
+size_t ChromeSystem::ds_payloadCacheSize = 0;
+size_t ChromeSystem::ds_payloadCacheHits = 0;
+size_t ChromeSystem::ds_payloadCacheMisses = 0;
+
+//! orders widgets so that the one visible least recently comes first
+static bool isVisibleLessRecently(const ChromeWidget* a, const ChromeWidget* b)
+{
+    return a->getLastVisibleTime() < b->getLastVisibleTime();
+}
 
 void ChromeSystem::ensureInitialised()
 {
@@ -54,7 +357,7 @@ void ChromeSystem::ensureInitialised()
     }
 }
 
-void ChromeSystem::initialise()
+void ChromeSystem::initialise(size_t warmWindowPoolSize)
 {
     if (ds_initialised)
     {
@@ -62,8 +365,51 @@ void ChromeSystem::initialise()
             "ChromeSystem::finalise - System was already initialised!."));
     }
 
-    Berkelium::init(Berkelium::FileString::empty());
-    ds_context = Berkelium::Context::create();
+    if (ds_threadedUpdateEnabled)
+    {
+        // Berkelium has to be initialised on the thread that will be updating it
+        ds_pumpThread = CEGUI_NEW_AO PumpThread(ds_pumpThreadInterval);
+        ds_pumpThread->d_thread = std::thread(&ChromeSystem::pumpThreadMain);
+
+        while (!ds_pumpThread->d_ready.load(std::memory_order_acquire))
+        {
+            std::this_thread::yield();
+        }
+    }
+    else
+    {
+        Berkelium::init(Berkelium::FileString::empty());
+        ds_context = Berkelium::Context::create();
+    }
+
+    ds_warmWindowPoolSize = warmWindowPoolSize;
+    ds_warmWindowCount = 0;
+    while (ds_warmWindowCount < ds_warmWindowPoolSize)
+    {
+        requestWarmWindow();
+    }
+
+#ifdef CHROMED_CEGUI_HAVE_OPENGL_UPLOADER
+    if (System::getSingleton().getRenderer()->getIdentifierString().find("OpenGL") != String::npos)
+    {
+        ds_defaultTextureUploader = CEGUI_NEW_AO ChromeOpenGLTextureUploader();
+    }
+    else
+#endif
+    {
+        ds_defaultTextureUploader = CEGUI_NEW_AO ChromeTextureUploader();
+    }
+    ds_textureUploader = ds_defaultTextureUploader;
+
+    ds_rasterCache = CEGUI_NEW_AO ChromeRasterCache();
+
+    ds_renderQueueConnection = System::getSingleton().getRenderer()->getDefaultRenderingRoot().subscribeEvent(
+        RenderingSurface::EventRenderQueueStarted,
+        Event::Subscriber(&ChromeSystem::handleRenderQueueStarted));
+    ds_updatedThisFrame = false;
+    ds_activity = true;
+    ds_idleFrames = 0;
+    ds_updateTimeDebt = 0.0f;
 
     // lets register our precious widgets
     WindowFactoryManager::addFactory< TplWindowFactory<ChromeHTML> >();
@@ -81,8 +427,49 @@ void ChromeSystem::finalise()
             "ChromeSystem::finalise - System isn't currently initialised!."));
     }
 
-    ds_context->destroy();
-    Berkelium::destroy();
+    if (ds_pumpThread)
+    {
+        ds_pumpThread->d_running.store(false, std::memory_order_release);
+        ds_pumpThread->d_thread.join();
+
+        // the pump thread is gone, we can safely consume its queues from here
+        ChromePaintPacket* packet;
+        while (ds_pumpThread->d_paintPackets.pop(packet))
+        {
+            CEGUI_DELETE_AO packet;
+        }
+        while (ds_pumpThread->d_freePaintPackets.pop(packet))
+        {
+            CEGUI_DELETE_AO packet;
+        }
+
+        CEGUI_DELETE_AO ds_pumpThread;
+        ds_pumpThread = 0;
+    }
+    else
+    {
+        destroyWarmWindows();
+
+        ds_context->destroy();
+        Berkelium::destroy();
+    }
+
+    ds_context = 0;
+    ds_warmWindowPoolSize = 0;
+    ds_warmWindowCount = 0;
+
+    ds_renderQueueConnection->disconnect();
+
+    clearTexturePool();
+    clearPayloadCache();
+    getStagingArena().release();
+
+    ds_textureUploader = 0;
+    CEGUI_DELETE_AO ds_defaultTextureUploader;
+    ds_defaultTextureUploader = 0;
+
+    CEGUI_DELETE_AO ds_rasterCache;
+    ds_rasterCache = 0;
 
     ds_initialised = false;
 }
@@ -100,7 +487,981 @@ Berkelium::Context* ChromeSystem::getContext()
 
 void ChromeSystem::update()
 {
+    flushJavascriptQueues();
+
+    if (ds_pumpThread)
+    {
+        dispatchPaintPackets();
+    }
+    else
+    {
+        Berkelium::update();
+    }
+}
+
+void ChromeSystem::scheduledUpdate()
+{
+    if (ds_updatedThisFrame)
+    {
+        return;
+    }
+
+    ds_updatedThisFrame = true;
+
+    maintainStagingArena();
+    enforceBudgets();
+    flushJavascriptQueues();
+
+    if (ds_activity)
+    {
+        ds_idleFrames = 0;
+        ds_activity = false;
+    }
+    else if (ds_idleFrames < ds_idleFrameThreshold)
+    {
+        ++ds_idleFrames;
+    }
+
+    // windows that weren't taken are still in the pool
+    ds_warmWindowCount += s_unusedWarmWindowReservations.exchange(0, std::memory_order_relaxed);
+
+    if (isIdle() && ds_warmWindowCount < ds_warmWindowPoolSize)
+    {
+        // creating a window is slow, one per frame keeps the hitch small
+        requestWarmWindow();
+    }
+
+    if (ds_pumpThread)
+    {
+        // the pump thread has its own schedule, we just collect what it painted
+        dispatchPaintPackets();
+        return;
+    }
+
+    if (ds_updateTimeDebt > 0.0f)
+    {
+        // the last update went over the budget, this frame pays it back
+        ds_updateTimeDebt -= ds_updateTimeBudget;
+        return;
+    }
+
+    const double now = getSchedulerTime();
+
+    if (isIdle() && now - ds_lastScheduledUpdateTime < ds_idleUpdateInterval)
+    {
+        return;
+    }
+
+    ds_lastScheduledUpdateTime = now;
     Berkelium::update();
+
+    if (ds_updateTimeBudget > 0.0f)
+    {
+        const float duration = static_cast<float>(getSchedulerTime() - now);
+        ds_updateTimeDebt = std::min(duration - ds_updateTimeBudget, ds_updateTimeBudget * MaxSkippedFrames);
+    }
+}
+
+void ChromeSystem::notifyActivity()
+{
+    ds_activity = true;
+    ds_idleFrames = 0;
+}
+
+void ChromeSystem::setUpdateTimeBudget(float seconds)
+{
+    ds_updateTimeBudget = seconds;
+    ds_updateTimeDebt = 0.0f;
+}
+
+float ChromeSystem::getUpdateTimeBudget()
+{
+    return ds_updateTimeBudget;
+}
+
+void ChromeSystem::setIdleFrameThreshold(uint frames)
+{
+    ds_idleFrameThreshold = frames;
+}
+
+uint ChromeSystem::getIdleFrameThreshold()
+{
+    return ds_idleFrameThreshold;
+}
+
+void ChromeSystem::setIdleUpdateInterval(float seconds)
+{
+    ds_idleUpdateInterval = seconds;
+}
+
+float ChromeSystem::getIdleUpdateInterval()
+{
+    return ds_idleUpdateInterval;
+}
+
+bool ChromeSystem::isIdle()
+{
+    return ds_idleFrameThreshold > 0 && ds_idleFrames >= ds_idleFrameThreshold;
+}
+
+bool ChromeSystem::handleRenderQueueStarted(const EventArgs&)
+{
+    // all queues are rendered after the widgets have been updated, any of them marks the next frame
+    ds_updatedThisFrame = false;
+
+    return false;
+}
+
+void ChromeSystem::setThreadedUpdateEnabled(bool enabled)
+{
+    if (ds_initialised)
+    {
+        CEGUI_THROW(InvalidRequestException(
+            "ChromeSystem::setThreadedUpdateEnabled - This has to be set before the system is initialised!."));
+    }
+
+    ds_threadedUpdateEnabled = enabled;
+}
+
+bool ChromeSystem::isThreadedUpdateEnabled()
+{
+    return ds_threadedUpdateEnabled;
+}
+
+void ChromeSystem::setLazyWindowCreationEnabled(bool enabled)
+{
+    ds_lazyWindowCreationEnabled = enabled;
+}
+
+bool ChromeSystem::isLazyWindowCreationEnabled()
+{
+    return ds_lazyWindowCreationEnabled;
+}
+
+void ChromeSystem::setPumpThreadInterval(float seconds)
+{
+    ds_pumpThreadInterval = seconds;
+
+    if (ds_pumpThread)
+    {
+        ds_pumpThread->d_interval.store(seconds, std::memory_order_relaxed);
+    }
+}
+
+float ChromeSystem::getPumpThreadInterval()
+{
+    return ds_pumpThreadInterval;
+}
+
+void ChromeSystem::executeTask(ChromeTask* task)
+{
+    if (ds_pumpThread)
+    {
+        ds_pumpThread->d_tasks.push(task);
+    }
+    else
+    {
+        task->execute();
+        CEGUI_DELETE_AO task;
+    }
+}
+
+Texture& ChromeSystem::acquireCanvasTexture(const Sizef& minimumSize, const Sizef& preferredSize, const Sizef& maximumSize)
+{
+    TexturePool::iterator best = ds_texturePool.end();
+    float bestArea = 0.0f;
+
+    for (TexturePool::iterator it = ds_texturePool.begin(); it != ds_texturePool.end(); ++it)
+    {
+        const Sizef size = it->d_texture->getSize();
+
+        if (size.d_width < minimumSize.d_width || size.d_height < minimumSize.d_height ||
+            size.d_width > maximumSize.d_width || size.d_height > maximumSize.d_height)
+        {
+            continue;
+        }
+
+        const float area = size.d_width * size.d_height;
+
+        if (best == ds_texturePool.end() || area < bestArea)
+        {
+            best = it;
+            bestArea = area;
+        }
+    }
+
+    if (best != ds_texturePool.end())
+    {
+        Texture* ret = best->d_texture;
+        ds_texturePoolSize -= best->d_bytes;
+        ds_texturePool.erase(best);
+        ++ds_texturePoolHits;
+
+        return *ret;
+    }
+
+    ++ds_texturePoolMisses;
+
+    Sizef size(roundUpToTexturePoolGranularity(preferredSize.d_width),
+               roundUpToTexturePoolGranularity(preferredSize.d_height));
+
+    if (size.d_width > maximumSize.d_width || size.d_height > maximumSize.d_height)
+    {
+        size = preferredSize;
+    }
+
+    return System::getSingleton().getRenderer()->createTexture(
+        "ChromeSystem/CanvasTexture/" + PropertyHelper<uint>::toString(ds_canvasTextureCounter++), size);
+}
+
+void ChromeSystem::destroyCanvasTexture(Texture& texture)
+{
+    System::getSingleton().getRenderer()->destroyTexture(texture);
+}
+
+void ChromeSystem::releaseCanvasTexture(Texture& texture)
+{
+    const Sizef size = texture.getSize();
+    const size_t bytes = static_cast<size_t>(size.d_width) * static_cast<size_t>(size.d_height) * 4;
+
+    if (bytes > ds_texturePoolCapacity)
+    {
+        System::getSingleton().getRenderer()->destroyTexture(texture);
+        return;
+    }
+
+    trimTexturePool(ds_texturePoolCapacity - bytes);
+
+    PooledTexture pooled;
+    pooled.d_texture = &texture;
+    pooled.d_bytes = bytes;
+    ds_texturePool.push_back(pooled);
+    ds_texturePoolSize += bytes;
+}
+
+void ChromeSystem::setTexturePoolCapacity(size_t bytes)
+{
+    ds_texturePoolCapacity = bytes;
+
+    trimTexturePool(ds_texturePoolCapacity);
+}
+
+size_t ChromeSystem::getTexturePoolCapacity()
+{
+    return ds_texturePoolCapacity;
+}
+
+size_t ChromeSystem::getTexturePoolSize()
+{
+    return ds_texturePoolSize;
+}
+
+size_t ChromeSystem::getTexturePoolTextureCount()
+{
+    return ds_texturePool.size();
+}
+
+size_t ChromeSystem::getTexturePoolHits()
+{
+    return ds_texturePoolHits;
+}
+
+size_t ChromeSystem::getTexturePoolMisses()
+{
+    return ds_texturePoolMisses;
+}
+
+void ChromeSystem::clearTexturePool()
+{
+    trimTexturePool(0);
+}
+
+void ChromeSystem::trimTexturePool(size_t capacity)
+{
+    size_t evicted = 0;
+
+    while (evicted < ds_texturePool.size() && ds_texturePoolSize > capacity)
+    {
+        System::getSingleton().getRenderer()->destroyTexture(*ds_texturePool[evicted].d_texture);
+        ds_texturePoolSize -= ds_texturePool[evicted].d_bytes;
+        ++evicted;
+    }
+
+    ds_texturePool.erase(ds_texturePool.begin(), ds_texturePool.begin() + evicted);
+}
+
+ChromeStagingArena& ChromeSystem::getStagingArena()
+{
+    return t_stagingArena.d_arena;
+}
+
+void ChromeSystem::trimStagingMemory()
+{
+    s_stagingTrimRequest.fetch_add(1, std::memory_order_relaxed);
+}
+
+size_t ChromeSystem::getStagingMemorySize()
+{
+    std::lock_guard<std::mutex> lock(s_stagingArenasMutex);
+
+    size_t ret = 0;
+    for (size_t i = 0; i < s_stagingArenas.size(); ++i)
+    {
+        ret += s_stagingArenas[i]->getCapacity();
+    }
+
+    return ret;
+}
+
+void ChromeSystem::setStagingTrimInterval(float seconds)
+{
+    ds_stagingTrimInterval = seconds;
+}
+
+float ChromeSystem::getStagingTrimInterval()
+{
+    return ds_stagingTrimInterval;
+}
+
+void ChromeSystem::setRendererBudget(uint renderers)
+{
+    ds_rendererBudget = renderers;
+}
+
+uint ChromeSystem::getRendererBudget()
+{
+    return ds_rendererBudget;
+}
+
+void ChromeSystem::setTextureMemoryBudget(size_t bytes)
+{
+    ds_textureMemoryBudget = bytes;
+}
+
+size_t ChromeSystem::getTextureMemoryBudget()
+{
+    return ds_textureMemoryBudget;
+}
+
+size_t ChromeSystem::getWidgetCount()
+{
+    return ds_widgets.size();
+}
+
+uint ChromeSystem::getLiveRendererCount()
+{
+    uint ret = 0;
+
+    for (WidgetMap::const_iterator it = ds_widgets.begin(); it != ds_widgets.end(); ++it)
+    {
+        if (it->second->isChromeWindowCreated())
+        {
+            ++ret;
+        }
+    }
+
+    return ret;
+}
+
+size_t ChromeSystem::getTextureMemoryUsage()
+{
+    size_t ret = 0;
+
+    for (WidgetMap::const_iterator it = ds_widgets.begin(); it != ds_widgets.end(); ++it)
+    {
+        ret += it->second->getTextureMemoryUsage();
+    }
+
+    return ret;
+}
+
+size_t ChromeSystem::getEvictionCount()
+{
+    return ds_evictionCount;
+}
+
+size_t ChromeSystem::getJavascriptBytesSent()
+{
+    return ds_javascriptBytesSent;
+}
+
+void ChromeSystem::setPayloadCacheCapacity(size_t bytes)
+{
+    ds_payloadCacheCapacity = bytes;
+
+    trimPayloadCache(ds_payloadCacheCapacity);
+}
+
+size_t ChromeSystem::getPayloadCacheCapacity()
+{
+    return ds_payloadCacheCapacity;
+}
+
+size_t ChromeSystem::getPayloadCacheSize()
+{
+    return ds_payloadCacheSize;
+}
+
+size_t ChromeSystem::getPayloadCacheHits()
+{
+    return ds_payloadCacheHits;
+}
+
+size_t ChromeSystem::getPayloadCacheMisses()
+{
+    return ds_payloadCacheMisses;
+}
+
+void ChromeSystem::clearPayloadCache()
+{
+    trimPayloadCache(0);
+
+    s_resourcePayloads.clear();
+}
+
+ChromeSystem::PayloadHash ChromeSystem::hashPayload(const char* header, const uint8* data, size_t size)
+{
+    // FNV-1a with the size mixed in, cache hits are still compared byte by byte
+    PayloadHash ret = 14695981039346656037ULL;
+
+    for (const char* it = header; *it; ++it)
+    {
+        ret = (ret ^ static_cast<uint8>(*it)) * 1099511628211ULL;
+    }
+
+    for (size_t i = 0; i < size; ++i)
+    {
+        ret = (ret ^ data[i]) * 1099511628211ULL;
+    }
+
+    return ret ^ (static_cast<PayloadHash>(size) << 40);
+}
+
+//! checks whether given cached payload was encoded from given data
+static bool isCachedPayloadOf(const CachedPayload& payload, const char* header, const uint8* data, size_t size)
+{
+    const size_t headerLength = strlen(header);
+
+    return payload.d_source.size() == size &&
+        payload.d_payload.compare(0, headerLength, header) == 0 &&
+        (size == 0 || memcmp(payload.d_source.data(), data, size) == 0);
+}
+
+const std::string* ChromeSystem::findPayload(PayloadHash hash, uint& serial)
+{
+    std::map<PayloadHash, PayloadList::iterator>::iterator it = s_payloadIndex.find(hash);
+    if (it == s_payloadIndex.end())
+    {
+        ++ds_payloadCacheMisses;
+        return 0;
+    }
+
+    ++ds_payloadCacheHits;
+
+    // most recently used go first
+    s_payloads.splice(s_payloads.begin(), s_payloads, it->second);
+    serial = it->second->d_serial;
+    return &it->second->d_payload;
+}
+
+const std::string* ChromeSystem::findPayload(PayloadHash hash, const char* header, const uint8* data, size_t size,
+                                             uint& serial)
+{
+    std::map<PayloadHash, PayloadList::iterator>::iterator it = s_payloadIndex.find(hash);
+    if (it == s_payloadIndex.end() || !isCachedPayloadOf(*it->second, header, data, size))
+    {
+        ++ds_payloadCacheMisses;
+        return 0;
+    }
+
+    ++ds_payloadCacheHits;
+
+    // most recently used go first
+    s_payloads.splice(s_payloads.begin(), s_payloads, it->second);
+    serial = it->second->d_serial;
+    return &it->second->d_payload;
+}
+
+const std::string* ChromeSystem::storePayload(PayloadHash hash, const uint8* data, size_t size,
+                                              std::string& payload, uint& serial)
+{
+    const size_t entrySize = payload.size() + size;
+
+    // a payload over the capacity would just flush everything else out
+    if (entrySize > ds_payloadCacheCapacity)
+    {
+        return 0;
+    }
+
+    // the same hash with different data, the payload already cached keeps its place
+    if (s_payloadIndex.find(hash) != s_payloadIndex.end())
+    {
+        return 0;
+    }
+
+    s_payloads.push_front(CachedPayload());
+    CachedPayload& cached = s_payloads.front();
+    cached.d_hash = hash;
+    cached.d_serial = s_nextPayloadSerial++;
+    cached.d_payload.swap(payload);
+    cached.d_source.assign(reinterpret_cast<const char*>(data), size);
+    s_payloadIndex[hash] = s_payloads.begin();
+    ds_payloadCacheSize += entrySize;
+
+    trimPayloadCache(ds_payloadCacheCapacity);
+
+    serial = cached.d_serial;
+    return &cached.d_payload;
+}
+
+bool ChromeSystem::findResourcePayloadHash(const String& filename, const String& resourceGroup,
+                                           const char* header, PayloadHash& hash)
+{
+    std::map<std::string, ResourcePayload>::iterator it =
+        s_resourcePayloads.find(getResourcePayloadKey(filename, resourceGroup, header));
+
+    if (it == s_resourcePayloads.end())
+    {
+        return false;
+    }
+
+    std::string path;
+    time_t modificationTime;
+    if (!getResourceFilePath(filename, resourceGroup, path, &modificationTime) ||
+        modificationTime != it->second.d_modificationTime)
+    {
+        s_resourcePayloads.erase(it);
+        return false;
+    }
+
+    hash = it->second.d_hash;
+    return true;
+}
+
+void ChromeSystem::storeResourcePayloadHash(const String& filename, const String& resourceGroup,
+                                            const char* header, PayloadHash hash)
+{
+    std::string path;
+    time_t modificationTime;
+    // only cached payloads, the entry goes away with the payload, \see ChromeSystem::trimPayloadCache
+    if (s_payloadIndex.find(hash) == s_payloadIndex.end() ||
+        !getResourceFilePath(filename, resourceGroup, path, &modificationTime))
+    {
+        return;
+    }
+
+    ResourcePayload& resource = s_resourcePayloads[getResourcePayloadKey(filename, resourceGroup, header)];
+    resource.d_modificationTime = modificationTime;
+    resource.d_hash = hash;
+}
+
+void ChromeSystem::trimPayloadCache(size_t capacity)
+{
+    while (ds_payloadCacheSize > capacity)
+    {
+        CachedPayload& oldest = s_payloads.back();
+
+        // a resource pointing at the hash could otherwise get whatever is stored under it next
+        for (std::map<std::string, ResourcePayload>::iterator it = s_resourcePayloads.begin();
+             it != s_resourcePayloads.end();)
+        {
+            if (it->second.d_hash == oldest.d_hash)
+            {
+                s_resourcePayloads.erase(it++);
+            }
+            else
+            {
+                ++it;
+            }
+        }
+
+        ds_payloadCacheSize -= oldest.d_payload.size() + oldest.d_source.size();
+        s_payloadIndex.erase(oldest.d_hash);
+        s_payloads.pop_back();
+    }
+}
+
+void ChromeSystem::flushJavascriptQueues()
+{
+    ds_javascriptBytesSent = 0;
+
+    for (WidgetMap::const_iterator it = ds_widgets.begin(); it != ds_widgets.end(); ++it)
+    {
+        ds_javascriptBytesSent += it->second->flushJavascriptQueue();
+    }
+}
+
+void ChromeSystem::enforceBudgets()
+{
+    if (ds_rendererBudget == 0 && ds_textureMemoryBudget == 0)
+    {
+        return;
+    }
+
+    uint renderers = getLiveRendererCount();
+    size_t textureMemory = getTextureMemoryUsage();
+
+    const bool rendererOverBudget = ds_rendererBudget > 0 && renderers > ds_rendererBudget;
+    const bool textureOverBudget = ds_textureMemoryBudget > 0 && textureMemory > ds_textureMemoryBudget;
+
+    if (!rendererOverBudget && !textureOverBudget)
+    {
+        return;
+    }
+
+    // evicting a widget that can be seen would just make it come back right away
+    std::vector<ChromeWidget*> candidates;
+    for (WidgetMap::const_iterator it = ds_widgets.begin(); it != ds_widgets.end(); ++it)
+    {
+        ChromeWidget* widget = it->second;
+
+        if (!widget->isEffectiveVisible() &&
+            (widget->isChromeWindowCreated() || widget->getTextureMemoryUsage() > 0))
+        {
+            candidates.push_back(widget);
+        }
+    }
+
+    std::sort(candidates.begin(), candidates.end(), isVisibleLessRecently);
+
+    for (size_t i = 0; i < candidates.size(); ++i)
+    {
+        const bool dropRenderer = ds_rendererBudget > 0 && renderers > ds_rendererBudget;
+        const bool dropTexture = ds_textureMemoryBudget > 0 && textureMemory > ds_textureMemoryBudget;
+
+        if (!dropRenderer && !dropTexture)
+        {
+            break;
+        }
+
+        ChromeWidget* widget = candidates[i];
+
+        if (dropTexture)
+        {
+            textureMemory -= widget->getTextureMemoryUsage();
+        }
+        else if (!widget->isChromeWindowCreated())
+        {
+            // only has a texture and we are fine on texture memory
+            continue;
+        }
+
+        if (widget->isChromeWindowCreated())
+        {
+            --renderers;
+        }
+
+        widget->evict(dropTexture);
+        ++ds_evictionCount;
+    }
+}
+
+void ChromeSystem::maintainStagingArena()
+{
+    ThreadStagingArena& arena = t_stagingArena;
+    const uint trimRequest = s_stagingTrimRequest.load(std::memory_order_relaxed);
+    const double now = getSchedulerTime();
+
+    if (trimRequest != arena.d_seenTrimRequest)
+    {
+        // memory is running low, give back everything, the next paint will get what it needs
+        arena.d_seenTrimRequest = trimRequest;
+        arena.d_lastTrimTime = now;
+        arena.d_arena.release();
+    }
+    else if (now - arena.d_lastTrimTime >= ds_stagingTrimInterval)
+    {
+        arena.d_lastTrimTime = now;
+        arena.d_arena.trim();
+    }
+}
+
+uint ChromeSystem::registerWidget(ChromeWidget* widget)
+{
+    const uint id = ds_nextWidgetId++;
+    ds_widgets[id] = widget;
+
+    return id;
+}
+
+void ChromeSystem::unregisterWidget(uint id)
+{
+    ds_widgets.erase(id);
+}
+
+ChromePaintPacket* ChromeSystem::acquirePaintPacket()
+{
+    ChromePaintPacket* ret;
+
+    if (ds_pumpThread->d_freePaintPackets.pop(ret))
+    {
+        ret->clear();
+        return ret;
+    }
+
+    return CEGUI_NEW_AO ChromePaintPacket();
+}
+
+void ChromeSystem::queuePaintPacket(ChromePaintPacket* packet)
+{
+    ds_pumpThread->d_paintPackets.push(packet);
+}
+
+void ChromeSystem::releasePaintPacket(ChromePaintPacket* packet)
+{
+    if (ds_pumpThread)
+    {
+        ds_pumpThread->d_freePaintPackets.push(packet);
+    }
+    else
+    {
+        CEGUI_DELETE_AO packet;
+    }
+}
+
+void ChromeSystem::pumpThreadMain()
+{
+    Berkelium::init(Berkelium::FileString::empty());
+    ds_context = Berkelium::Context::create();
+
+    ds_pumpThread->d_ready.store(true, std::memory_order_release);
+
+    while (ds_pumpThread->d_running.load(std::memory_order_acquire))
+    {
+        executeQueuedTasks();
+        Berkelium::update();
+
+        std::this_thread::sleep_for(std::chrono::microseconds(
+            static_cast<long long>(ds_pumpThread->d_interval.load(std::memory_order_relaxed) * 1000000.0f)));
+    }
+
+    // widgets destroyed right before finalising still have their Berkelium windows to destroy
+    executeQueuedTasks();
+    destroyWarmWindows();
+
+    ds_context->destroy();
+    Berkelium::destroy();
+}
+
+void ChromeSystem::executeQueuedTasks()
+{
+    ChromeTask* task;
+
+    while (ds_pumpThread->d_tasks.pop(task))
+    {
+        task->execute();
+        CEGUI_DELETE_AO task;
+    }
+}
+
+void ChromeSystem::dispatchPaintPackets()
+{
+    ChromePaintPacket* packet;
+
+    while (ds_pumpThread->d_paintPackets.pop(packet))
+    {
+        WidgetMap::iterator it = ds_widgets.find(packet->d_widgetId);
+
+        if (it != ds_widgets.end())
+        {
+            it->second->queuePaintPacket(packet);
+        }
+        else
+        {
+            // the widget has been destroyed in the meantime
+            releasePaintPacket(packet);
+        }
+    }
+}
+
+void ChromeSystem::setTextureUploader(ChromeTextureUploader* uploader)
+{
+    ds_textureUploader = uploader ? uploader : ds_defaultTextureUploader;
+}
+
+ChromeTextureUploader& ChromeSystem::getTextureUploader()
+{
+    return *ds_textureUploader;
+}
+
+ChromeRasterCache& ChromeSystem::getRasterCache()
+{
+    return *ds_rasterCache;
+}
+
+bool ChromeSystem::isResourceURL(const char* url, size_t length)
+{
+    const size_t schemeLength = sizeof(ResourceScheme) - 1;
+
+    return length >= schemeLength && strncmp(url, ResourceScheme, schemeLength) == 0;
+}
+
+void ChromeSystem::parseResourceURL(const char* url, size_t length, String& filename, String& resourceGroup)
+{
+    if (!isResourceURL(url, length))
+    {
+        CEGUI_THROW(InvalidRequestException(
+            "ChromeSystem::parseResourceURL - '" + String(url, length) + "' isn't a resource URL."));
+    }
+
+    const char* begin = url + sizeof(ResourceScheme) - 1;
+    const char* end = url + length;
+
+    // queries and fragments mean nothing to the ResourceProvider
+    const char* pathEnd = std::find_if(begin, end, [](char c) { return c == '?' || c == '#'; });
+    const char* groupEnd = std::find(begin, pathEnd, '/');
+
+    const std::string group(percentDecode(begin, groupEnd));
+    const std::string path(groupEnd == pathEnd ? std::string() : percentDecode(groupEnd + 1, pathEnd));
+
+    resourceGroup = String(group.c_str());
+    filename = String(path.c_str());
+}
+
+bool ChromeSystem::getResourceFileURL(const String& filename, const String& resourceGroup, std::string& url)
+{
+    std::string absolutePath;
+    if (!getResourceFilePath(filename, resourceGroup, absolutePath))
+    {
+        return false;
+    }
+
+    url = "file://";
+    if (absolutePath[0] != '/')
+    {
+        // drive letters
+        url += '/';
+    }
+    percentEncodePath(absolutePath, url);
+
+    return true;
+}
+
+bool ChromeSystem::getResourceFilePath(const String& filename, const String& resourceGroup,
+                                       std::string& path, time_t* modificationTime)
+{
+    DefaultResourceProvider* provider =
+        dynamic_cast<DefaultResourceProvider*>(System::getSingleton().getResourceProvider());
+
+    if (!provider)
+    {
+        return false;
+    }
+
+    // this mirrors how DefaultResourceProvider finds the file
+    const String& group = resourceGroup.empty() ? provider->getDefaultResourceGroup() : resourceGroup;
+    const String relativePath = provider->getResourceGroupDirectory(group) + filename;
+
+    return getAbsolutePath(relativePath.c_str(), path, modificationTime);
+}
+
+const char* ChromeSystem::getMimeType(const String& filename)
+{
+    static const char* const mimeTypes[][2] =
+    {
+        {"html", "text/html"}, {"htm", "text/html"}, {"css", "text/css"},
+        {"js", "application/javascript"}, {"json", "application/json"},
+        {"xml", "text/xml"}, {"txt", "text/plain"},
+        {"png", "image/png"}, {"jpg", "image/jpeg"}, {"jpeg", "image/jpeg"},
+        {"gif", "image/gif"}, {"svg", "image/svg+xml"}, {"bmp", "image/bmp"},
+        {"ttf", "font/ttf"}, {"otf", "font/otf"}, {"woff", "font/woff"},
+        {"swf", "application/x-shockwave-flash"}
+    };
+
+    const String::size_type dot = filename.rfind('.');
+    if (dot != String::npos)
+    {
+        std::string extension(filename.substr(dot + 1).c_str());
+        std::transform(extension.begin(), extension.end(), extension.begin(), ::tolower);
+
+        for (size_t i = 0; i < sizeof(mimeTypes) / sizeof(mimeTypes[0]); ++i)
+        {
+            if (extension == mimeTypes[i][0])
+            {
+                return mimeTypes[i][1];
+            }
+        }
+    }
+
+    return "application/octet-stream";
+}
+
+size_t ChromeSystem::getWarmWindowPoolSize()
+{
+    return ds_warmWindowPoolSize;
+}
+
+size_t ChromeSystem::getWarmWindowCount()
+{
+    return ds_warmWindowCount;
+}
+
+bool ChromeSystem::reserveWarmWindow()
+{
+    // tasks run in the order they were requested, so the pool will have the window by then,
+    // it may still be loading though, \see ChromeSystem::takeWarmWindow
+    if (ds_warmWindowCount == 0)
+    {
+        return false;
+    }
+
+    --ds_warmWindowCount;
+    return true;
+}
+
+Berkelium::Window* ChromeSystem::takeWarmWindow()
+{
+    // the oldest window is the most likely to have finished loading
+    for (std::vector<WarmWindow*>::iterator it = s_warmWindows.begin(); it != s_warmWindows.end(); ++it)
+    {
+        if (!(*it)->d_loaded)
+        {
+            continue;
+        }
+
+        Berkelium::Window* window = (*it)->d_window;
+        window->setDelegate(0);
+
+        CEGUI_DELETE_AO *it;
+        s_warmWindows.erase(it);
+
+        return window;
+    }
+
+    // a late about:blank onLoad would mark the widget's own navigation as loaded
+    s_unusedWarmWindowReservations.fetch_add(1, std::memory_order_relaxed);
+    return 0;
+}
+
+void ChromeSystem::requestWarmWindow()
+{
+    ++ds_warmWindowCount;
+
+    executeTask(CEGUI_NEW_AO CreateWarmWindowTask());
+}
+
+void ChromeSystem::createWarmWindow()
+{
+    static const char blankUrl[] = "about:blank";
+
+    Berkelium::Window* window = Berkelium::Window::create(ds_context);
+    // has to happen before navigating, see BerkeliumDelegate::createWindow
+    window->resize(1, 1);
+    s_warmWindows.push_back(CEGUI_NEW_AO WarmWindow(window));
+
+    window->navigateTo(blankUrl, sizeof(blankUrl) - 1);
+}
+
+void ChromeSystem::destroyWarmWindows()
+{
+    for (size_t i = 0; i < s_warmWindows.size(); ++i)
+    {
+        s_warmWindows[i]->d_window->setDelegate(0);
+        CEGUI_DELETE_AO s_warmWindows[i]->d_window;
+        CEGUI_DELETE_AO s_warmWindows[i];
+    }
+
+    s_warmWindows.clear();
 }
 
 }
@@ -0,0 +1,87 @@
+/***********************************************************************
+    filename:   CEGUIChromeTextureUploader.cpp
+    created:    16/10/2026
+    author:     Martin Preisler
+*************************************************************************/
+/***************************************************************************
+ *   Copyright (C) 2011 Martin Preisler
+ *
+ *   Permission is hereby granted, free of charge, to any person obtaining
+ *   a copy of this software and associated documentation files (the
+ *   "Software"), to deal in the Software without restriction, including
+ *   without limitation the rights to use, copy, modify, merge, publish,
+ *   distribute, sublicense, and/or sell copies of the Software, and to
+ *   permit persons to whom the Software is furnished to do so, subject to
+ *   the following conditions:
+ *
+ *   The above copyright notice and this permission notice shall be
+ *   included in all copies or substantial portions of the Software.
+ *
+ *   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ *   EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ *   MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ *   IN NO EVENT SHALL THE AUTHORS BE LIABLE FOR ANY CLAIM, DAMAGES OR
+ *   OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+ *   ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ *   OTHER DEALINGS IN THE SOFTWARE.
+ ***************************************************************************/
+
+#include "CEGUIChromeTextureUploader.h"
+
+#include "CEGUITexture.h"
+
+#include <cstring>
+
+namespace CEGUI
+{
+
+ChromeTextureUploader::ChromeTextureUploader()
+{}
+
+ChromeTextureUploader::~ChromeTextureUploader()
+{}
+
+void ChromeTextureUploader::blitFromMemory(Texture& texture, const void* source, size_t sourcePitch, const Rectf& area)
+{
+    const size_t bytesPerPixel = 4;
+
+    const size_t rowSize = static_cast<size_t>(area.getWidth()) * bytesPerPixel;
+    const size_t hig = static_cast<size_t>(area.getHeight());
+
+    if (rowSize == 0 || hig == 0)
+    {
+        return;
+    }
+
+    // already packed, nothing to do
+    if (sourcePitch == rowSize)
+    {
+        texture.blitFromMemory(const_cast<void*>(source), area);
+        return;
+    }
+
+    if (d_packBuffer.size() < rowSize * hig)
+    {
+        d_packBuffer.resize(rowSize * hig);
+    }
+
+    const uint8* input = static_cast<const uint8*>(source);
+    for (size_t jj = 0; jj < hig; ++jj)
+    {
+        memcpy(&d_packBuffer[jj * rowSize], input + jj * sourcePitch, rowSize);
+    }
+
+    texture.blitFromMemory(&d_packBuffer[0], area);
+}
+
+ChromePixelKernels::PixelLayout ChromeTextureUploader::getPixelLayout() const
+{
+    return ChromePixelKernels::PL_RGBA;
+}
+
+void ChromeTextureUploader::releasePackBuffer()
+{
+    PackBuffer().swap(d_packBuffer);
+}
+
+}
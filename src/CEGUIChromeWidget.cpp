@@ -28,35 +28,277 @@
 
 #include "CEGUIChromeWidget.h"
 #include "CEGUIChromeSystem.h"
+#include "CEGUIChromeTextureUploader.h"
+#include "CEGUIChromePaintPacket.h"
+#include "CEGUIChromeStagingArena.h"
+#include "CEGUIChromeBase64.h"
 
 #include "CEGUIGeometryBuffer.h"
 #include "CEGUIVertex.h"
 #include "CEGUITexture.h"
 #include "CEGUICoordConverter.h"
+#include "CEGUISystem.h"
+#include "CEGUIResourceProvider.h"
 
 #include <berkelium/Berkelium.hpp>
 #include <berkelium/Window.hpp>
 #include <berkelium/WindowDelegate.hpp>
 #include <berkelium/Rect.hpp>
+#include <berkelium/StringUtil.hpp>
 
 #include <iostream>
+#include <algorithm>
+#include <chrono>
+#include <atomic>
 
 namespace CEGUI
 {
 
+const uint ChromeWidget::CanvasTileSize = 256;
+
+//! how much the adaptive rendering detail ratio changes in one step
+static const float AdaptiveDetailStep = 0.25f;
+//! how long the adaptive rendering detail ratio stays put after a change, the repaint after resize is costly
+static const float AdaptiveDetailCooldown = 0.5f;
+//! the paint cost has to be below this portion of the budget before the ratio is raised again
+static const float AdaptiveDetailRaiseThreshold = 0.5f;
+//! how fast the smoothed paint cost follows the measured one
+static const float PaintCostSmoothing = 0.1f;
+
+//! monotonic time in seconds, used to measure paint cost
+static double getPaintCostTime()
+{
+    return std::chrono::duration<double>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+//! size of the header of one host message frame, 1 byte channel and 4 bytes little endian length
+static const size_t HostMessageHeaderSize = 5;
+
+//! script installing window.ceguiHost.post(channel, data) in the page, \see ChromeWidget::setHostMessagesEnabled
+static const char HostMessageBridgeScript[] =
+    "(function() {\n"
+    "    if (window.ceguiHost) return;\n"
+    "    var batch = [];\n"
+    "    var scheduled = false;\n"
+    "    function flush() {\n"
+    "        scheduled = false;\n"
+    "        var message = batch.join('');\n"
+    "        batch.length = 0;\n"
+    "        window.externalHost.postMessage(message);\n"
+    "    }\n"
+    "    function toByte(value) {\n"
+    "        return value & 255;\n"
+    "    }\n"
+    "    function toBytes(data) {\n"
+    "        if (typeof data === 'string') return unescape(encodeURIComponent(data));\n"
+    "        var ret = '';\n"
+    "        for (var i = 0; i < data.length; i += 4096)\n"
+    "            ret += String.fromCharCode.apply(null, Array.prototype.map.call(Array.prototype.slice.call(data, i, i + 4096), toByte));\n"
+    "        return ret;\n"
+    "    }\n"
+    "    window.ceguiHost = {\n"
+    "        post: function(channel, data) {\n"
+    "            var payload = toBytes(data);\n"
+    "            var n = payload.length;\n"
+    "            batch.push(String.fromCharCode(channel & 255, n & 255, (n >>> 8) & 255, (n >>> 16) & 255, (n >>> 24) & 255), payload);\n"
+    "            if (!scheduled) {\n"
+    "                scheduled = true;\n"
+    "                setTimeout(flush, 0);\n"
+    "            }\n"
+    "        }\n"
+    "    };\n"
+    "})();\n";
+
+/*!
+\brief unpacks a batch of host messages, every character carries one byte
+
+\return
+    false if there are characters that can't be bytes, the batch didn't come from the bridge then
+*/
+static bool decodeHostMessageBatch(const wchar_t* source, size_t length, uint8* target)
+{
+    for (size_t i = 0; i < length; ++i)
+    {
+        if (static_cast<unsigned long>(source[i]) > 0xFF)
+        {
+            return false;
+        }
+
+        target[i] = static_cast<uint8>(source[i]);
+    }
+
+    return true;
+}
+
 // the whole reason for this class is to avoid including Berkelium in the header
+// it owns the Berkelium window and lives on the thread that owns Berkelium
 class BerkeliumDelegate :
     public Berkelium::WindowDelegate,
     public AllocatedObject<BerkeliumDelegate>
 {
 public:
-    BerkeliumDelegate(ChromeWidget* target):
-        d_target(target)
+    BerkeliumDelegate(ChromeWidget* target, uint widgetId):
+        d_target(target),
+        d_widgetId(widgetId),
+        d_window(0),
+        d_width(0),
+        d_height(0),
+        d_ignorePartialPaint(true),
+        d_throttled(false),
+        d_navigation(0),
+        d_startedNavigation(0),
+        d_ownLoadPending(false),
+        d_pageNavigated(false),
+        d_loadedNavigation(0),
+        d_transparent(false),
+        d_hostMessagesEnabled(false)
     {}
 
     ~BerkeliumDelegate()
     {}
 
+    /*!
+    \brief creates the Berkelium window and replays everything recorded while there was none
+
+    \param warm
+        if true, the window is taken from the warm pool, \see ChromeSystem::reserveWarmWindow
+    */
+    void createWindow(bool warm)
+    {
+        const int width = d_width;
+        const int height = d_height;
+
+        d_window = warm ? ChromeSystem::takeWarmWindow() : 0;
+        if (!d_window)
+        {
+            // the reserved window is still loading about:blank
+            warm = false;
+            d_window = Berkelium::Window::create(ChromeSystem::getContext());
+        }
+        d_window->setDelegate(this);
+        d_ignorePartialPaint = true;
+        d_startedNavigation = 0;
+
+        if (warm)
+        {
+            // warm windows are resized before they navigate to about:blank
+            d_width = 1;
+            d_height = 1;
+        }
+        else
+        {
+            // this has to be done to ensure Berkelium paints at all
+            // (ever, if you do this after navigate/loadContent, it won't work)
+            resize(1, 1);
+        }
+
+        d_window->setTransparent(d_transparent);
+
+        if (width > 1 || height > 1)
+        {
+            resize(width, height);
+        }
+
+        if (!d_url.empty())
+        {
+            d_ownLoadPending = true;
+            d_pageNavigated.store(false, std::memory_order_relaxed);
+            d_window->navigateTo(d_url.c_str(), d_url.size());
+        }
+    }
+
+    void destroyWindow()
+    {
+        d_loadedNavigation.store(0, std::memory_order_relaxed);
+        d_ownLoadPending = false;
+
+        if (!d_window)
+        {
+            return;
+        }
+
+        d_window->setDelegate(0);
+        CEGUI_DELETE_AO d_window;
+        d_window = 0;
+    }
+
+    Berkelium::Window* getWindow() const
+    {
+        return d_window;
+    }
+
+    //! the size is recorded and applied when the window gets created if there is none
+    void resize(int width, int height)
+    {
+        d_width = width;
+        d_height = height;
+
+        if (d_window)
+        {
+            d_window->resize(width, height);
+        }
+    }
+
+    /*!
+    \brief the url is recorded and navigated to when the window gets created if there is none
+
+    \param navigation
+        generation of the navigation, \see BerkeliumDelegate::isLoaded
+    */
+    void navigateTo(const std::string& url, uint navigation)
+    {
+        d_url = url;
+        d_navigation = navigation;
+        d_startedNavigation = 0;
+        d_loadedNavigation.store(0, std::memory_order_relaxed);
+
+        if (d_window)
+        {
+            d_ownLoadPending = true;
+            d_pageNavigated.store(false, std::memory_order_relaxed);
+            d_window->navigateTo(d_url.c_str(), d_url.size());
+        }
+    }
+
+    //! the setting is recorded and applied when the window gets created if there is none
+    void setTransparent(bool transparent)
+    {
+        d_transparent = transparent;
+
+        if (d_window)
+        {
+            d_window->setTransparent(transparent);
+        }
+    }
+
+    /*!
+    \brief paints are dropped while throttled, may be called from any thread
+
+    Berkelium keeps running, we just don't copy or upload anything it paints.
+    */
+    void setThrottled(bool throttled)
+    {
+        d_throttled.store(throttled, std::memory_order_relaxed);
+    }
+
+    //! makes Chrome repaint the whole canvas, nothing painted before is let through until that happens
+    void requestFullRepaint()
+    {
+        if (!d_window)
+        {
+            // the window paints everything once it's created
+            return;
+        }
+
+        const int width = d_width;
+        const int height = d_height;
+
+        d_ignorePartialPaint = true;
+        // same trick as in createWindow, Berkelium has no other way to invalidate everything
+        resize(1, 1);
+        resize(width, height);
+    }
+
     virtual void onPaint(
         Berkelium::Window *win,
         const unsigned char *sourceBuffer,
@@ -66,7 +308,154 @@ public:
         int dx, int dy,
         const Berkelium::Rect &scrollRect)
     {
-        d_target->onPaint(win, sourceBuffer, sourceBufferRect, numCopyRects, copyRects, dx, dy, scrollRect);
+        if (d_throttled.load(std::memory_order_relaxed))
+        {
+            // nobody can see the widget, a full repaint is requested once somebody can
+            return;
+        }
+
+        if (d_ignorePartialPaint)
+        {
+            // until Chrome paints the whole canvas, partial paints would leave garbage around them
+            if (sourceBufferRect.left() != 0 ||
+                sourceBufferRect.top() != 0 ||
+                sourceBufferRect.width() != d_width ||
+                sourceBufferRect.height() != d_height)
+            {
+                return;
+            }
+
+            d_ignorePartialPaint = false;
+
+            deliverPaint(win, sourceBuffer, sourceBufferRect, 1, &sourceBufferRect, 0, 0, sourceBufferRect);
+            return;
+        }
+
+        deliverPaint(win, sourceBuffer, sourceBufferRect, numCopyRects, copyRects, dx, dy, scrollRect);
+    }
+
+    //! records the url a recreated window should show without navigating, the page was changed in place
+    void rememberUrl(const std::string& url)
+    {
+        d_url = url;
+    }
+
+    //! runs given UTF-8 script in the page, dropped if there is no window
+    void executeJavascript(const std::string& script)
+    {
+        if (!d_window)
+        {
+            return;
+        }
+
+        Berkelium::WideString wideScript = Berkelium::UTF8ToWide(
+            Berkelium::UTF8String::point(script.c_str(), script.size()));
+        d_window->executeJavascript(wideScript);
+        Berkelium::stringUtil_free(wideScript);
+    }
+
+    /*!
+    \brief checks whether given navigation finished loading, may be called from any thread
+
+    The main thread passes the generation of its last navigation, the navigation task may not
+    have run yet, in which case the previous page doesn't count as loaded.
+    */
+    bool isLoaded(uint navigation) const
+    {
+        return navigation != 0 && d_loadedNavigation.load(std::memory_order_relaxed) == navigation;
+    }
+
+    //! checks whether the last navigation finished loading, thread that owns Berkelium only
+    bool isLoaded() const
+    {
+        return isLoaded(d_navigation);
+    }
+
+    virtual void onStartLoading(Berkelium::Window *win, Berkelium::URLString newURL)
+    {
+        // anything that starts loading after we navigated belongs to our navigation
+        d_startedNavigation = d_navigation;
+
+        if (d_ownLoadPending)
+        {
+            d_ownLoadPending = false;
+        }
+        else
+        {
+            // a link, a location change or anything else the page did by itself
+            d_pageNavigated.store(true, std::memory_order_relaxed);
+        }
+    }
+
+    /*!
+    \brief checks whether the page loaded something we didn't navigate to, may be called from any thread
+
+    Reset by the next navigation we start.
+    */
+    bool hasPageNavigated() const
+    {
+        return d_pageNavigated.load(std::memory_order_relaxed);
+    }
+
+    virtual void onLoad(Berkelium::Window *win)
+    {
+        // the previous page may finish loading after we navigated away from it, that load isn't ours
+        if (d_startedNavigation != 0)
+        {
+            d_loadedNavigation.store(d_startedNavigation, std::memory_order_relaxed);
+        }
+
+        if (d_hostMessagesEnabled)
+        {
+            executeJavascript(HostMessageBridgeScript);
+        }
+    }
+
+    //! installs the host message bridge in every page loaded from now on
+    void setHostMessagesEnabled(bool enabled)
+    {
+        d_hostMessagesEnabled = enabled;
+
+        if (enabled && isLoaded())
+        {
+            executeJavascript(HostMessageBridgeScript);
+        }
+    }
+
+    virtual void onExternalHost(
+        Berkelium::Window *win,
+        Berkelium::WideString message,
+        Berkelium::URLString origin,
+        Berkelium::URLString target)
+    {
+        if (!d_hostMessagesEnabled || message.length() == 0)
+        {
+            return;
+        }
+
+        if (!ChromeSystem::isThreadedUpdateEnabled())
+        {
+            // the buffer keeps its capacity, steady streams of messages don't allocate
+            d_hostMessageBuffer.resize(message.length());
+            if (decodeHostMessageBatch(message.data(), message.length(), &d_hostMessageBuffer[0]))
+            {
+                d_target->onHostMessages(&d_hostMessageBuffer[0], d_hostMessageBuffer.size());
+            }
+
+            return;
+        }
+
+        ChromePaintPacket* packet = ChromeSystem::acquirePaintPacket();
+        packet->d_widgetId = d_widgetId;
+        packet->d_hostMessages.resize(message.length());
+
+        if (!decodeHostMessageBatch(message.data(), message.length(), &packet->d_hostMessages[0]))
+        {
+            packet->d_hostMessages.clear();
+        }
+
+        // even an empty packet has to go back to the pool through the main thread
+        ChromeSystem::queuePaintPacket(packet);
     }
 
     virtual void onUnresponsive(Window *win)
@@ -80,34 +469,248 @@ public:
     }
 
 private:
+    void deliverPaint(
+        Berkelium::Window *win,
+        const unsigned char *sourceBuffer,
+        const Berkelium::Rect &sourceBufferRect,
+        size_t numCopyRects,
+        const Berkelium::Rect *copyRects,
+        int dx, int dy,
+        const Berkelium::Rect &scrollRect)
+    {
+        if (!ChromeSystem::isThreadedUpdateEnabled())
+        {
+            d_target->onPaint(win, sourceBuffer, sourceBufferRect, numCopyRects, copyRects, dx, dy, scrollRect);
+            return;
+        }
+
+        // we are on the pump thread, the widget can't be touched from here, Berkelium's buffer
+        // is only valid during this call, so everything gets copied to a packet
+        const int bytesPerPixel = 4;
+        const size_t sourcePitch = sourceBufferRect.width() * bytesPerPixel;
+
+        ChromePaintPacket* packet = ChromeSystem::acquirePaintPacket();
+        packet->d_widgetId = d_widgetId;
+        packet->d_dx = dx;
+        packet->d_dy = dy;
+        packet->d_scrollRect = Rectf(scrollRect.left(), scrollRect.top(), scrollRect.right(), scrollRect.bottom());
+
+        size_t pixelsSize = 0;
+        for (size_t i = 0; i < numCopyRects; ++i)
+        {
+            pixelsSize += copyRects[i].width() * copyRects[i].height() * bytesPerPixel;
+        }
+        packet->d_pixels.resize(pixelsSize);
+
+        size_t offset = 0;
+        for (size_t i = 0; i < numCopyRects; ++i)
+        {
+            const size_t rowSize = copyRects[i].width() * bytesPerPixel;
+            const int hig = copyRects[i].height();
+
+            ChromePaintPacket::CopyRect copyRect;
+            copyRect.d_area = Rectf(copyRects[i].left(), copyRects[i].top(), copyRects[i].right(), copyRects[i].bottom());
+            copyRect.d_offset = offset;
+            packet->d_copyRects.push_back(copyRect);
+
+            const uint8* source = sourceBuffer +
+                (copyRects[i].left() - sourceBufferRect.left()) * bytesPerPixel +
+                (copyRects[i].top() - sourceBufferRect.top()) * sourcePitch;
+
+            for (int jj = 0; jj < hig; ++jj)
+            {
+                memcpy(packet->d_pixels.data() + offset, source, rowSize);
+
+                offset += rowSize;
+                source += sourcePitch;
+            }
+        }
+
+        ChromeSystem::queuePaintPacket(packet);
+    }
+
+    //! only touched when Berkelium is updated on the main thread
     ChromeWidget* d_target;
+    //! identifies the widget from other threads, \see ChromeSystem::registerWidget
+    uint d_widgetId;
+    Berkelium::Window* d_window;
+    //! size of the Berkelium window
+    int d_width;
+    //! \see BerkeliumDelegate::d_width
+    int d_height;
+    //! if true, we will ignore partial canvas painting and only let full repaint through
+    bool d_ignorePartialPaint;
+    //! if true, all paints are dropped, set from the main thread
+    std::atomic<bool> d_throttled;
+    //! generation of the last navigation, \see ChromeWidget::d_navigationGeneration
+    uint d_navigation;
+    //! generation of the navigation Chrome started loading, 0 until it does, \see BerkeliumDelegate::onStartLoading
+    uint d_startedNavigation;
+    //! if true, the next load that starts is the one we asked for
+    bool d_ownLoadPending;
+    //! \see BerkeliumDelegate::hasPageNavigated
+    std::atomic<bool> d_pageNavigated;
+    //! generation of the navigation that finished loading, 0 if none, read from the main thread
+    std::atomic<uint> d_loadedNavigation;
+    //! last url we were asked to navigate to
+    std::string d_url;
+    //! whether Chrome should render with transparent background
+    bool d_transparent;
+    //! if true, pages get the host message bridge and their messages are delivered
+    bool d_hostMessagesEnabled;
+    //! receives host messages when Berkelium is updated on the main thread
+    ChromePaintPacket::PixelBuffer d_hostMessageBuffer;
+};
+
+//! task running a function object, \see executeChromeTask
+template<typename F>
+class ChromeFunctionTask :
+    public ChromeTask
+{
+public:
+    ChromeFunctionTask(const F& function):
+        d_function(function)
+    {}
+
+    virtual void execute()
+    {
+        d_function();
+    }
+
+private:
+    F d_function;
 };
 
+//! runs given function object on the thread that owns Berkelium, right away if that's us
+template<typename F>
+static void executeChromeTask(const F& function)
+{
+    // anything we ask Berkelium to do will likely make it busy for a while
+    ChromeSystem::notifyActivity();
+
+    if (ChromeSystem::isThreadedUpdateEnabled())
+    {
+        ChromeSystem::executeTask(CEGUI_NEW_AO ChromeFunctionTask<F>(function));
+    }
+    else
+    {
+        function();
+    }
+}
+
+//! wraps given coordinate into [0, period)
+static inline float wrapCanvasCoordinate(float value, float period)
+{
+    const float ret = std::fmod(value, period);
+
+    return ret < 0.0f ? ret + period : ret;
+}
+
+//! appends 2 triangles forming given quad to the geometry buffer
+static void appendQuad(GeometryBuffer& geometry, const Rectf& position, const Rectf& uv, const ColourRect& colours)
+{
+    Vertex vbuffer[6];
+
+    // vertex 0 - top left
+    vbuffer[0].position   = Vector3f(position.left(), position.top(), 0.0f);
+    vbuffer[0].colour_val = colours.d_top_left;
+    vbuffer[0].tex_coords = Vector2f(uv.left(), uv.top());
+
+    // vertex 1 - bottom left
+    vbuffer[1].position   = Vector3f(position.left(), position.bottom(), 0.0f);
+    vbuffer[1].colour_val = colours.d_bottom_left;
+    vbuffer[1].tex_coords = Vector2f(uv.left(), uv.bottom());
+
+    // vertex 2 - bottom right
+    vbuffer[2].position   = Vector3f(position.right(), position.bottom(), 0.0f);
+    vbuffer[2].colour_val = colours.d_bottom_right;
+    vbuffer[2].tex_coords = Vector2f(uv.right(), uv.bottom());
+
+    // vertex 3 - top right
+    vbuffer[3].position   = Vector3f(position.right(), position.top(), 0.0f);
+    vbuffer[3].colour_val = colours.d_top_right;
+    vbuffer[3].tex_coords = Vector2f(uv.right(), uv.top());
+
+    // vertex 4 - top left
+    vbuffer[4].position   = Vector3f(position.left(), position.top(), 0.0f);
+    vbuffer[4].colour_val = colours.d_top_left;
+    vbuffer[4].tex_coords = Vector2f(uv.left(), uv.top());
+
+    // vertex 5 - bottom right
+    vbuffer[5].position   = Vector3f(position.right(), position.bottom(), 0.0f);
+    vbuffer[5].colour_val = colours.d_bottom_right;
+    vbuffer[5].tex_coords = Vector2f(uv.right(), uv.bottom());
+
+    geometry.appendGeometry(vbuffer, 6);
+}
+
+const String ChromeWidget::EventNamespace("ChromeWidget");
+const String ChromeWidget::EventHostMessage("HostMessage");
+
 ChromeWidget::ChromeWidget(const String& type, const String& name):
     Window(type, name),
 
     d_interactionMode(IM_NoInteraction),
     d_renderingDetailRatio(1.0f),
+    d_effectiveRenderingDetailRatio(1.0f),
+    d_renderingDetailAdaptiveEnabled(false),
+    d_renderingDetailCostBudget(0.002f),
+    d_renderingDetailMinimumRatio(0.5f),
+    d_renderingDetailSettleTime(1.0f),
+    d_paintCostAccumulator(0.0),
+    d_paintCost(0.0f),
+    d_renderingDetailSettleTimer(0.0f),
+    d_renderingDetailCooldown(0.0f),
     d_renderingResizeDelay(-1.0f),
-    d_renderingCanvasReserve(0.0f),
-    d_renderingCanvasMaxOverhead(0.2f),
     d_colourRect(Colour(1, 1, 1, 1)),
+    d_transparencyEnabled(false),
+    d_chromeWindowCreated(false),
+    d_freezeEnabled(false),
+    d_freezeDelay(2.0f),
+    d_frozen(false),
+    d_paintQuietTime(0.0f),
+    d_evicted(false),
+    d_lastVisibleTime(getPaintCostTime()),
+    d_javascriptQueueBytes(0),
+    d_javascriptBytesSent(0),
+    d_hostMessagesEnabled(false),
+    d_hostMessageCount(0),
+    d_hostMessageBytes(0),
+    d_payloadHash(0),
+    d_payloadSerial(0),
+    d_navigationGeneration(0),
+    d_navigationDeferred(false),
+    d_throttleWhenHiddenEnabled(false),
+    d_throttled(false),
+    d_throttleStartTime(0.0),
+    d_throttledTime(0.0),
 
     d_renderingResizeTimer(-1.0f),
     d_renderingResizeNeeded(true),
 
     d_renderOutputTexture(0),
-    d_scrollBuffer(CEGUI_NEW_ARRAY_PT(char, 1 * (1 + 1) * 4, AllocatorConfig<ChromeWidget>::Allocator)),
-    d_ignorePartialPaint(true)
+    d_nativeContentTexture(0),
+    d_renderingCanvasShadowBufferEnabled(true),
+    d_canvasBuffer(0),
+    d_canvasBufferSize(0),
+    d_canvasUploadsSaved(0),
+    d_renderingCanvasRingScrollEnabled(false),
+    d_canvasRingOffsetX(0),
+    d_canvasRingOffsetY(0),
+    d_renderingCanvasTiledEnabled(false),
+    d_canvasTileColumns(0),
+    d_canvasTileRows(0),
+    d_canvasTextureSize(1, 1)
 {
     ChromeSystem::ensureInitialised();
 
-    d_chromeWindow = Berkelium::Window::create(ChromeSystem::getContext());
-    d_berkeliumDelegate = CEGUI_NEW_AO BerkeliumDelegate(this);
-    d_chromeWindow->setDelegate(d_berkeliumDelegate);
-    // this has to be done to ensure Berkelium paints at all
-    // (ever, if you do this after navigate/loadContent, it won't work)
-    d_chromeWindow->resize(1, 1);
+    d_widgetId = ChromeSystem::registerWidget(this);
+    d_berkeliumDelegate = CEGUI_NEW_AO BerkeliumDelegate(this, d_widgetId);
+
+    if (!ChromeSystem::isLazyWindowCreationEnabled())
+    {
+        ensureChromeWindow();
+    }
 
     const String propertyOrigin("ChromeWidget");
     
@@ -129,6 +732,72 @@ ChromeWidget::ChromeWidget(const String& type, const String& name):
         1.0f
     );
 
+    CEGUI_DEFINE_PROPERTY(ChromeWidget, bool, "HostMessagesEnabled",
+        "If enabled, pages get window.ceguiHost.post(channel, data) and the messages they post are "
+        "fired as HostMessage events. Disabled by default.",
+        &ChromeWidget::setHostMessagesEnabled,
+        &ChromeWidget::isHostMessagesEnabled,
+        false
+    );
+
+    CEGUI_DEFINE_PROPERTY(ChromeWidget, bool, "FreezeWhenStatic",
+        "If enabled, the Berkelium window of a widget in IM_NoInteraction mode is destroyed once its page "
+        "has loaded and painting has been quiet for FreezeDelay, only the canvas texture is kept. "
+        "The window is recreated when the widget is resized, its content changes or interaction is enabled. "
+        "Disabled by default.",
+        &ChromeWidget::setFreezeEnabled,
+        &ChromeWidget::isFreezeEnabled,
+        false
+    );
+
+    CEGUI_DEFINE_PROPERTY(ChromeWidget, float, "FreezeDelay",
+        "For how many seconds painting has to be quiet before the widget freezes. Defaults to 2.0.",
+        &ChromeWidget::setFreezeDelay,
+        &ChromeWidget::getFreezeDelay,
+        2.0f
+    );
+
+    CEGUI_DEFINE_PROPERTY(ChromeWidget, bool, "ThrottleWhenHidden",
+        "If enabled, paints from Chrome are dropped while the widget is hidden, fully transparent, "
+        "clipped away or covered by an opaque Chrome widget and a full repaint is requested once "
+        "it can be seen again. Disabled by default.",
+        &ChromeWidget::setThrottleWhenHiddenEnabled,
+        &ChromeWidget::isThrottleWhenHiddenEnabled,
+        false
+    );
+
+    CEGUI_DEFINE_PROPERTY(ChromeWidget, bool, "RenderingDetailAdaptive",
+        "If enabled, the rendering detail ratio is lowered in steps when painting and uploading this widget takes "
+        "longer than RenderingDetailCostBudget per frame and raised again once the content settles. "
+        "RenderingDetailRatio is the highest ratio used. Disabled by default.",
+        &ChromeWidget::setRenderingDetailAdaptiveEnabled,
+        &ChromeWidget::isRenderingDetailAdaptiveEnabled,
+        false
+    );
+
+    CEGUI_DEFINE_PROPERTY(ChromeWidget, float, "RenderingDetailCostBudget",
+        "How many seconds per frame painting and uploading this widget may take in adaptive rendering detail mode. "
+        "Defaults to 0.002.",
+        &ChromeWidget::setRenderingDetailCostBudget,
+        &ChromeWidget::getRenderingDetailCostBudget,
+        0.002f
+    );
+
+    CEGUI_DEFINE_PROPERTY(ChromeWidget, float, "RenderingDetailMinimumRatio",
+        "The lowest rendering detail ratio the adaptive mode may go down to. Defaults to 0.5.",
+        &ChromeWidget::setRenderingDetailMinimumRatio,
+        &ChromeWidget::getRenderingDetailMinimumRatio,
+        0.5f
+    );
+
+    CEGUI_DEFINE_PROPERTY(ChromeWidget, float, "RenderingDetailSettleTime",
+        "How many seconds the paint cost has to stay well under the budget before the adaptive mode "
+        "raises the rendering detail ratio again. Defaults to 1.0.",
+        &ChromeWidget::setRenderingDetailSettleTime,
+        &ChromeWidget::getRenderingDetailSettleTime,
+        1.0f
+    );
+
     CEGUI_DEFINE_PROPERTY(ChromeWidget, float, "RenderingResizeDelay",
         "Higher values will speed things like drag resizing but rendering can be distorted/of low quality at times. "
         "The default behaviour is to size the rendering the first time update is called and leave it (-1.0f value)",
@@ -137,22 +806,77 @@ ChromeWidget::ChromeWidget(const String& type, const String& name):
         -1.0f
     );
 
-    CEGUI_DEFINE_PROPERTY(ChromeWidget, float, "RenderingCanvasReserve",
-        "You want to leave this at 0.0 for widgets that will never resize, it helps to have reserve with often resizing widgets. "
-        "Be aware that this must play well with RenderingCanvasOverhead because it his ratio is bigger than the allowed overhead, "
-        "you will trigger an infinite loop! And you have to make sure that doesn't happen, there are no checks for this!!",
-        &ChromeWidget::setRenderingCanvasReserve,
-        &ChromeWidget::getRenderingCanvasReserve,
+    CEGUI_DEFINE_PROPERTY(ChromeWidget, uint, "RenderingCanvasSizeQuantum",
+        "Canvas texture sizes are rounded up to multiples of this many pixels, so that small size changes "
+        "don't cause reallocations. Defaults to 64.",
+        &ChromeWidget::setRenderingCanvasSizeQuantum,
+        &ChromeWidget::getRenderingCanvasSizeQuantum,
+        64
+    );
+
+    CEGUI_DEFINE_PROPERTY(ChromeWidget, bool, "RenderingCanvasSizePowerOfTwo",
+        "If enabled, canvas texture sizes are rounded up to powers of two instead of multiples of the quantum. "
+        "Disabled by default.",
+        &ChromeWidget::setRenderingCanvasSizePowerOfTwo,
+        &ChromeWidget::isRenderingCanvasSizePowerOfTwo,
+        false
+    );
+
+    CEGUI_DEFINE_PROPERTY(ChromeWidget, float, "RenderingCanvasGrowHeadroom",
+        "How much extra space is allocated when the canvas texture grows, 0.1 means 10% more than necessary. "
+        "You want to leave this at 0.0 for widgets that will never resize. Defaults to 0.0.",
+        &ChromeWidget::setRenderingCanvasGrowHeadroom,
+        &ChromeWidget::getRenderingCanvasGrowHeadroom,
         0.0f
     );
 
-    CEGUI_DEFINE_PROPERTY(ChromeWidget, float, "RenderingCanvasMaxOverhead",
-        "Default is 0.2, meaning if the texture is 20% bigger than it should be (any of its sizes), we recreate it with a smaller size. "
-        "Be aware that this must play well with RenderingCanvasOverhead because it his ratio is bigger than the allowed overhead, "
-        "you will trigger an infinite loop! And you have to make sure that doesn't happen, there are no checks for this!!",
-        &ChromeWidget::setRenderingCanvasMaxOverhead,
-        &ChromeWidget::getRenderingCanvasMaxOverhead,
-        0.2f
+    CEGUI_DEFINE_PROPERTY(ChromeWidget, float, "RenderingCanvasShrinkThreshold",
+        "The canvas texture is shrunk once any of its sides is this much bigger than what would be allocated "
+        "for the current size, 0.25 means 25%. Defaults to 0.25.",
+        &ChromeWidget::setRenderingCanvasShrinkThreshold,
+        &ChromeWidget::getRenderingCanvasShrinkThreshold,
+        0.25f
+    );
+
+    CEGUI_DEFINE_PROPERTY(ChromeWidget, float, "RenderingCanvasShrinkDelay",
+        "How many seconds the canvas texture has to stay too big before it's shrunk. Defaults to 1.0.",
+        &ChromeWidget::setRenderingCanvasShrinkDelay,
+        &ChromeWidget::getRenderingCanvasShrinkDelay,
+        1.0f
+    );
+
+    CEGUI_DEFINE_PROPERTY(ChromeWidget, float, "RenderingCanvasFullUploadThreshold",
+        "Painted areas are accumulated and uploaded to the canvas texture when the widget is drawn. Overlapping "
+        "and neighbouring areas are merged, once they cover this ratio of the canvas, the whole canvas is uploaded at once. "
+        "Defaults to 0.75, 1.0 disables this.",
+        &ChromeWidget::setRenderingCanvasFullUploadThreshold,
+        &ChromeWidget::getRenderingCanvasFullUploadThreshold,
+        0.75f
+    );
+
+    CEGUI_DEFINE_PROPERTY(ChromeWidget, bool, "RenderingCanvasShadowBufferEnabled",
+        "If enabled, a CPU side copy of the canvas is kept and all painting and scrolling happens in it, "
+        "the canvas texture is only ever written to. Costs width * height * 4 bytes of memory. "
+        "If disabled, paints are uploaded right away and scrolling has to read the texture back.",
+        &ChromeWidget::setRenderingCanvasShadowBufferEnabled,
+        &ChromeWidget::isRenderingCanvasShadowBufferEnabled,
+        true
+    );
+
+    CEGUI_DEFINE_PROPERTY(ChromeWidget, bool, "RenderingCanvasRingScrollEnabled",
+        "If enabled, the canvas texture wraps around its edges like a ring and scrolling just moves the origin, "
+        "only the newly exposed strip gets uploaded. Works only with the shadow buffer enabled. Disabled by default.",
+        &ChromeWidget::setRenderingCanvasRingScrollEnabled,
+        &ChromeWidget::isRenderingCanvasRingScrollEnabled,
+        false
+    );
+
+    CEGUI_DEFINE_PROPERTY(ChromeWidget, bool, "RenderingCanvasTiled",
+        "If enabled, the canvas is made of 256x256 textures, resizing the widget only creates or destroys the tiles "
+        "on the edges and keeps the rest. Works only with the shadow buffer enabled, disables ring scrolling. Disabled by default.",
+        &ChromeWidget::setRenderingCanvasTiledEnabled,
+        &ChromeWidget::isRenderingCanvasTiledEnabled,
+        false
     );
 
     CEGUI_DEFINE_PROPERTY(ChromeWidget, ColourRect, "ColourRect",
@@ -167,278 +891,1693 @@ ChromeWidget::~ChromeWidget()
 {
     if (d_renderOutputTexture)
     {
-        System::getSingleton().getRenderer()->destroyTexture(*d_renderOutputTexture);
+        ChromeSystem::releaseCanvasTexture(*d_renderOutputTexture);
         d_renderOutputTexture = 0;
     }
 
-    d_chromeWindow->setDelegate(0);
-    CEGUI_DELETE_AO d_berkeliumDelegate;
+    resizeCanvasTiles(Sizef(0, 0));
+
+    ChromeSystem::unregisterWidget(d_widgetId);
+
+    // the delegate owns the Berkelium window, both have to die on the thread that owns Berkelium
+    BerkeliumDelegate* delegate = d_berkeliumDelegate;
+    executeChromeTask([delegate]()
+        {
+            delegate->destroyWindow();
+            CEGUI_DELETE_AO delegate;
+        });
     d_berkeliumDelegate = 0;
 
-    CEGUI_DELETE_AO d_chromeWindow;
-    d_chromeWindow = 0;
+    for (size_t i = 0; i < d_pendingPaintPackets.size(); ++i)
+    {
+        ChromeSystem::releasePaintPacket(d_pendingPaintPackets[i]);
+    }
+    d_pendingPaintPackets.clear();
 
-    CEGUI_DELETE_AO [] d_scrollBuffer;
-    d_scrollBuffer = 0;
+    if (d_canvasBuffer)
+    {
+        CEGUI_DELETE_ARRAY_PT(d_canvasBuffer, uint8, d_canvasBufferSize, AllocatorConfig<ChromeWidget>::Allocator);
+        d_canvasBuffer = 0;
+    }
 }
 
 void ChromeWidget::setInteractionMode(InteractionMode mode)
 {
     d_interactionMode = mode;
-}
 
-ChromeWidget::InteractionMode ChromeWidget::getInteractionMode() const
+    if (mode != IM_NoInteraction)
+    {
+        // Chrome has to be around to react to the input
+        thaw();
+    }
+}
+
+ChromeWidget::InteractionMode ChromeWidget::getInteractionMode() const
 {
     return d_interactionMode;
 }
 
 void ChromeWidget::setTransparencyEnabled(bool enabled)
 {
-    d_chromeWindow->setTransparent(enabled);
+    d_transparencyEnabled = enabled;
+    thaw();
+
+    BerkeliumDelegate* delegate = d_berkeliumDelegate;
+    executeChromeTask([delegate, enabled]() { delegate->setTransparent(enabled); });
 }
 
-void ChromeWidget::setRenderingDetailRatio(float ratio)
+void ChromeWidget::ensureChromeWindow()
 {
-    d_renderingDetailRatio = ratio;
+    // native content doesn't need Chrome at all
+    if (d_chromeWindowCreated || d_nativeContentTexture)
+    {
+        return;
+    }
 
-    resizeRenderingCanvas();
+    d_chromeWindowCreated = true;
+    d_frozen = false;
+    d_paintQuietTime = 0.0f;
+
+    if (d_navigationDeferred)
+    {
+        // the page was changed in place, the window has to come back with what it showed
+        d_navigationDeferred = false;
+        onDeferredNavigationNeeded();
+    }
+
+    const bool warm = ChromeSystem::reserveWarmWindow();
+    BerkeliumDelegate* delegate = d_berkeliumDelegate;
+    executeChromeTask([delegate, warm]() { delegate->createWindow(warm); });
 }
 
-float ChromeWidget::getRenderingDetailRatio() const
+bool ChromeWidget::isChromeWindowCreated() const
 {
-    return d_renderingDetailRatio;
+    return d_chromeWindowCreated;
 }
 
-void ChromeWidget::setRenderingResizeDelay(float seconds)
+void ChromeWidget::setFreezeEnabled(bool enabled)
 {
-    d_renderingResizeDelay = seconds;
+    d_freezeEnabled = enabled;
+
+    if (!enabled)
+    {
+        thaw();
+    }
 }
 
-float ChromeWidget::getRenderingResizeDelay() const
+bool ChromeWidget::isFreezeEnabled() const
 {
-    return d_renderingResizeDelay;
+    return d_freezeEnabled;
 }
 
-void ChromeWidget::setRenderingCanvasReserve(float ratio)
+void ChromeWidget::setFreezeDelay(float seconds)
 {
-    d_renderingCanvasReserve = ratio;
-    // process it when we next render
-    d_renderingResizeNeeded = true;
+    d_freezeDelay = seconds;
 }
 
-float ChromeWidget::getRenderingCanvasReserve() const
+float ChromeWidget::getFreezeDelay() const
 {
-    return d_renderingCanvasReserve;
+    return d_freezeDelay;
 }
 
-void ChromeWidget::setRenderingCanvasMaxOverhead(float ratio)
+bool ChromeWidget::isFrozen() const
 {
-    d_renderingCanvasMaxOverhead = ratio;
-    // process it when we next render
-    d_renderingResizeNeeded = true;
+    return d_frozen;
+}
+
+void ChromeWidget::updateFreezing(float elapsed)
+{
+    if (d_throttled)
+    {
+        // paints are being dropped, the canvas is quiet because it's stale, not because it settled
+        d_paintQuietTime = 0.0f;
+        return;
+    }
+
+    d_paintQuietTime += elapsed;
+
+    if (d_frozen || !isRenderingCanvasSettled())
+    {
+        return;
+    }
+
+    onRenderingCanvasSettled();
+
+    if (!d_freezeEnabled || d_interactionMode != IM_NoInteraction)
+    {
+        return;
+    }
+
+    // the canvas holds everything Chrome painted, nothing will change until we thaw
+    releaseChromeWindow();
 }
 
-float ChromeWidget::getRenderingCanvasMaxOverhead() const
+bool ChromeWidget::isRenderingCanvasSettled() const
 {
-    return d_renderingCanvasMaxOverhead;
+    return d_chromeWindowCreated && d_berkeliumDelegate->isLoaded(d_navigationGeneration) &&
+        d_paintQuietTime >= d_freezeDelay &&
+        hasRenderingCanvas() && d_pendingPaintPackets.empty() &&
+        !d_renderingResizeNeeded && d_renderingResizeTimer < 0.0f;
 }
 
-void ChromeWidget::setColourRect(const ColourRect& rect)
+bool ChromeWidget::restoreRenderingCanvas()
 {
-    d_colourRect = rect;
+    return false;
+}
 
-    invalidate();
+void ChromeWidget::onRenderingCanvasSettled()
+{}
+
+void ChromeWidget::releaseChromeWindow()
+{
+    d_frozen = true;
+    d_chromeWindowCreated = false;
+
+    BerkeliumDelegate* delegate = d_berkeliumDelegate;
+    executeChromeTask([delegate]() { delegate->destroyWindow(); });
 }
 
-ColourRect ChromeWidget::getColourRect() const
+double ChromeWidget::getLastVisibleTime() const
 {
-    return d_colourRect;
+    return d_lastVisibleTime;
 }
 
-void ChromeWidget::populateGeometryBuffer()
+size_t ChromeWidget::getTextureMemoryUsage() const
+{
+    if (d_renderOutputTexture)
+    {
+        const Sizef size = d_renderOutputTexture->getSize();
+        return static_cast<size_t>(size.d_width) * static_cast<size_t>(size.d_height) * 4;
+    }
+
+    return d_canvasTiles.size() * CanvasTileSize * CanvasTileSize * 4;
+}
+
+bool ChromeWidget::isEvicted() const
+{
+    return d_evicted;
+}
+
+void ChromeWidget::evict(bool dropTexture)
+{
+    d_evicted = true;
+
+    if (d_chromeWindowCreated)
+    {
+        releaseChromeWindow();
+    }
+
+    // the window is going away, what it painted last would only bring the canvas back
+    for (size_t i = 0; i < d_pendingPaintPackets.size(); ++i)
+    {
+        ChromeSystem::releasePaintPacket(d_pendingPaintPackets[i]);
+    }
+    d_pendingPaintPackets.clear();
+
+    if (!dropTexture)
+    {
+        return;
+    }
+
+    // the window is gone, so nothing can paint into the canvas until we are restored,
+    // pooling the textures wouldn't free any memory
+    releaseRenderingCanvas(true);
+}
+
+void ChromeWidget::releaseRenderingCanvas(bool destroyTextures)
+{
+    if (d_renderOutputTexture)
+    {
+        if (destroyTextures)
+        {
+            ChromeSystem::destroyCanvasTexture(*d_renderOutputTexture);
+        }
+        else
+        {
+            ChromeSystem::releaseCanvasTexture(*d_renderOutputTexture);
+        }
+        d_renderOutputTexture = 0;
+    }
+
+    if (destroyTextures)
+    {
+        for (size_t i = 0; i < d_canvasTiles.size(); ++i)
+        {
+            ChromeSystem::destroyCanvasTexture(*d_canvasTiles[i]);
+        }
+
+        d_canvasTiles.clear();
+        d_canvasTileColumns = 0;
+        d_canvasTileRows = 0;
+    }
+
+    resizeCanvasTiles(Sizef(0, 0));
+
+    if (d_canvasBuffer)
+    {
+        CEGUI_DELETE_ARRAY_PT(d_canvasBuffer, uint8, d_canvasBufferSize, AllocatorConfig<ChromeWidget>::Allocator);
+        d_canvasBuffer = 0;
+        d_canvasBufferSize = 0;
+    }
+
+    d_canvasDirtyRegion.clear();
+    d_renderingResizeNeeded = true;
+}
+
+void ChromeWidget::restoreEvicted()
 {
-    if (!d_renderOutputTexture)
+    if (!d_evicted)
+    {
+        return;
+    }
+
+    d_evicted = false;
+
+    if (hasRenderingCanvas())
+    {
+        // the canvas survived, the window paints over it once it's back
+        thaw();
+    }
+    else
     {
+        // creates the canvas and the window, Chrome repaints everything
         resizeRenderingCanvas();
     }
+}
 
-    Vertex vbuffer[6];
+void ChromeWidget::thaw()
+{
+    if (d_frozen)
+    {
+        ensureChromeWindow();
+    }
+}
 
-    Sizef pixelSize = getPixelSize();
-    const Sizef alteredPixelSize = pixelSize * d_renderingDetailRatio;
+void ChromeWidget::setThrottleWhenHiddenEnabled(bool enabled)
+{
+    d_throttleWhenHiddenEnabled = enabled;
 
-    ColourRect colourRect(d_colourRect);
-    colourRect.modulateAlpha(getEffectiveAlpha());
+    updateThrottling();
+}
 
-    if (alteredPixelSize.d_width * alteredPixelSize.d_height == 0)
+bool ChromeWidget::isThrottleWhenHiddenEnabled() const
+{
+    return d_throttleWhenHiddenEnabled;
+}
+
+bool ChromeWidget::isThrottled() const
+{
+    return d_throttled;
+}
+
+double ChromeWidget::getThrottledTime() const
+{
+    return d_throttled ? d_throttledTime + (getPaintCostTime() - d_throttleStartTime) : d_throttledTime;
+}
+
+bool ChromeWidget::isHiddenFromView() const
+{
+    if (!isEffectiveVisible() || getEffectiveAlpha() <= 0.0f)
     {
-        d_geometry->reset();
-        return; // guard from division by zero, also it doesn't really make sense to render anyways
+        return true;
     }
 
-    const float rightUV = alteredPixelSize.d_width / d_renderOutputTexture->getSize().d_width;
-    const float bottomUV = alteredPixelSize.d_height / d_renderOutputTexture->getSize().d_height;
+    const Rectf clipper(getOuterRectClipper());
+    if (clipper.getWidth() <= 0.0f || clipper.getHeight() <= 0.0f)
+    {
+        // clipped away by the parent entirely
+        return true;
+    }
 
-    // vertex 0 - top left
-    vbuffer[0].position   = Vector3f(0.0f, 0.0f, 0.0f);
-    vbuffer[0].colour_val = colourRect.d_top_left;
-    vbuffer[0].tex_coords = Vector2f(0.0f, 0.0f);
+    const Window* parent = getParent();
+    if (!parent)
+    {
+        return false;
+    }
 
-    // vertex 1 - bottom left
-    vbuffer[1].position   = Vector3f(0.0f, pixelSize.d_height, 0.0f);
-    vbuffer[1].colour_val = colourRect.d_bottom_left;
-    vbuffer[1].tex_coords = Vector2f(0.0f, bottomUV);
+    // we only know that Chrome widgets are opaque, so only those can cover us
+    const Rectf area(getUnclippedOuterRect());
+    const size_t siblingCount = parent->getChildCount();
+    for (size_t i = 0; i < siblingCount; ++i)
+    {
+        const ChromeWidget* sibling = dynamic_cast<const ChromeWidget*>(parent->getChildAtIdx(i));
 
-    // vertex 2 - bottom right
-    vbuffer[2].position   = Vector3f(pixelSize.d_width, pixelSize.d_height, 0.0f);
-    vbuffer[2].colour_val = colourRect.d_bottom_right;
-    vbuffer[2].tex_coords = Vector2f(rightUV, bottomUV);
+        if (!sibling || sibling == this || !sibling->isOpaque() || !sibling->isInFront(*this))
+        {
+            continue;
+        }
 
-    // vertex 3 - top right
-    vbuffer[3].position   = Vector3f(pixelSize.d_width, 0.0f, 0.0f);
-    vbuffer[3].colour_val = colourRect.d_top_right;
-    vbuffer[3].tex_coords = Vector2f(rightUV, 0.0f);
+        const Rectf siblingArea(sibling->getUnclippedOuterRect());
+        if (siblingArea.left() <= area.left() && siblingArea.top() <= area.top() &&
+            siblingArea.right() >= area.right() && siblingArea.bottom() >= area.bottom())
+        {
+            return true;
+        }
+    }
 
-    // vertex 4 - top left
-    vbuffer[4].position   = Vector3f(0.0f, 0.0f, 0.0f);
-    vbuffer[4].colour_val = colourRect.d_top_left;
-    vbuffer[4].tex_coords = Vector2f(0.0f, 0.0f);
+    return false;
+}
+
+bool ChromeWidget::isOpaque() const
+{
+    // native content is drawn at its own size and may have alpha, it can't cover anybody
+    return !d_nativeContentTexture && isEffectiveVisible() && !d_transparencyEnabled && getEffectiveAlpha() >= 1.0f &&
+        d_colourRect.d_top_left.getAlpha() >= 1.0f && d_colourRect.d_top_right.getAlpha() >= 1.0f &&
+        d_colourRect.d_bottom_left.getAlpha() >= 1.0f && d_colourRect.d_bottom_right.getAlpha() >= 1.0f;
+}
+
+void ChromeWidget::updateThrottling()
+{
+    const bool throttled = d_throttleWhenHiddenEnabled && isHiddenFromView();
+
+    if (throttled == d_throttled)
+    {
+        return;
+    }
+
+    d_throttled = throttled;
+
+    BerkeliumDelegate* delegate = d_berkeliumDelegate;
+
+    if (throttled)
+    {
+        d_throttleStartTime = getPaintCostTime();
+
+        // takes effect right away, packets already on their way still get applied
+        delegate->setThrottled(true);
+    }
+    else
+    {
+        d_throttledTime += getPaintCostTime() - d_throttleStartTime;
+
+        // a window has to exist for the repaint to happen at all
+        thaw();
+
+        // the canvas is stale, everything we dropped has to be painted again
+        executeChromeTask([delegate]()
+            {
+                delegate->setThrottled(false);
+                delegate->requestFullRepaint();
+            });
+    }
+}
+
+void ChromeWidget::setRenderingDetailRatio(float ratio)
+{
+    d_renderingDetailRatio = ratio;
+    d_effectiveRenderingDetailRatio = ratio;
+    d_renderingDetailSettleTimer = 0.0f;
+
+    resizeRenderingCanvas();
+}
+
+float ChromeWidget::getRenderingDetailRatio() const
+{
+    return d_renderingDetailRatio;
+}
+
+float ChromeWidget::getEffectiveRenderingDetailRatio() const
+{
+    return d_effectiveRenderingDetailRatio;
+}
+
+void ChromeWidget::setRenderingDetailAdaptiveEnabled(bool enabled)
+{
+    d_renderingDetailAdaptiveEnabled = enabled;
+
+    if (!enabled && d_effectiveRenderingDetailRatio != d_renderingDetailRatio)
+    {
+        d_effectiveRenderingDetailRatio = d_renderingDetailRatio;
+
+        resizeRenderingCanvas();
+    }
+}
+
+bool ChromeWidget::isRenderingDetailAdaptiveEnabled() const
+{
+    return d_renderingDetailAdaptiveEnabled;
+}
+
+void ChromeWidget::setRenderingDetailCostBudget(float seconds)
+{
+    d_renderingDetailCostBudget = seconds;
+}
+
+float ChromeWidget::getRenderingDetailCostBudget() const
+{
+    return d_renderingDetailCostBudget;
+}
+
+void ChromeWidget::setRenderingDetailMinimumRatio(float ratio)
+{
+    d_renderingDetailMinimumRatio = ratio;
+}
+
+float ChromeWidget::getRenderingDetailMinimumRatio() const
+{
+    return d_renderingDetailMinimumRatio;
+}
+
+void ChromeWidget::setRenderingDetailSettleTime(float seconds)
+{
+    d_renderingDetailSettleTime = seconds;
+}
+
+float ChromeWidget::getRenderingDetailSettleTime() const
+{
+    return d_renderingDetailSettleTime;
+}
+
+float ChromeWidget::getRenderingPaintCost() const
+{
+    return d_paintCost;
+}
+
+void ChromeWidget::setRenderingResizeDelay(float seconds)
+{
+    d_renderingResizeDelay = seconds;
+}
+
+float ChromeWidget::getRenderingResizeDelay() const
+{
+    return d_renderingResizeDelay;
+}
+
+ChromeCanvasSizingPolicy& ChromeWidget::getRenderingCanvasSizingPolicy()
+{
+    return d_canvasSizingPolicy;
+}
+
+const ChromeCanvasSizingPolicy& ChromeWidget::getRenderingCanvasSizingPolicy() const
+{
+    return d_canvasSizingPolicy;
+}
+
+void ChromeWidget::setRenderingCanvasSizeQuantum(uint pixels)
+{
+    d_canvasSizingPolicy.setQuantum(pixels);
+}
+
+uint ChromeWidget::getRenderingCanvasSizeQuantum() const
+{
+    return d_canvasSizingPolicy.getQuantum();
+}
+
+void ChromeWidget::setRenderingCanvasSizePowerOfTwo(bool enabled)
+{
+    d_canvasSizingPolicy.setPowerOfTwoEnabled(enabled);
+}
+
+bool ChromeWidget::isRenderingCanvasSizePowerOfTwo() const
+{
+    return d_canvasSizingPolicy.isPowerOfTwoEnabled();
+}
+
+void ChromeWidget::setRenderingCanvasGrowHeadroom(float ratio)
+{
+    d_canvasSizingPolicy.setGrowHeadroom(ratio);
+}
+
+float ChromeWidget::getRenderingCanvasGrowHeadroom() const
+{
+    return d_canvasSizingPolicy.getGrowHeadroom();
+}
+
+void ChromeWidget::setRenderingCanvasShrinkThreshold(float ratio)
+{
+    d_canvasSizingPolicy.setShrinkThreshold(ratio);
+}
+
+float ChromeWidget::getRenderingCanvasShrinkThreshold() const
+{
+    return d_canvasSizingPolicy.getShrinkThreshold();
+}
+
+void ChromeWidget::setRenderingCanvasShrinkDelay(float seconds)
+{
+    d_canvasSizingPolicy.setShrinkDelay(seconds);
+}
+
+float ChromeWidget::getRenderingCanvasShrinkDelay() const
+{
+    return d_canvasSizingPolicy.getShrinkDelay();
+}
+
+size_t ChromeWidget::getRenderingCanvasReallocationCount() const
+{
+    return d_canvasSizingPolicy.getReallocationCount();
+}
+
+void ChromeWidget::setRenderingCanvasFullUploadThreshold(float ratio)
+{
+    d_canvasDirtyRegion.setCoverageThreshold(ratio);
+}
+
+float ChromeWidget::getRenderingCanvasFullUploadThreshold() const
+{
+    return d_canvasDirtyRegion.getCoverageThreshold();
+}
+
+void ChromeWidget::setRenderingCanvasShadowBufferEnabled(bool enabled)
+{
+    if (d_renderingCanvasShadowBufferEnabled == enabled)
+    {
+        return;
+    }
+
+    // whatever is pending has to get to the texture before we lose the buffer
+    flushCanvas();
+
+    d_renderingCanvasShadowBufferEnabled = enabled;
+
+    // (re)allocates the buffer and forces Chrome to repaint everything into it
+    if (hasRenderingCanvas())
+    {
+        resizeRenderingCanvas();
+    }
+}
+
+bool ChromeWidget::isRenderingCanvasShadowBufferEnabled() const
+{
+    return d_renderingCanvasShadowBufferEnabled;
+}
+
+void ChromeWidget::setRenderingCanvasRingScrollEnabled(bool enabled)
+{
+    if (d_renderingCanvasRingScrollEnabled == enabled)
+    {
+        return;
+    }
+
+    d_renderingCanvasRingScrollEnabled = enabled;
+
+    // unwrapping the canvas means moving everything, we just let Chrome repaint it
+    if (hasRenderingCanvas() && (d_canvasRingOffsetX != 0 || d_canvasRingOffsetY != 0))
+    {
+        resizeRenderingCanvas();
+    }
+}
+
+bool ChromeWidget::isRenderingCanvasRingScrollEnabled() const
+{
+    return d_renderingCanvasRingScrollEnabled;
+}
+
+bool ChromeWidget::isRenderingCanvasRingActive() const
+{
+    return d_renderingCanvasRingScrollEnabled && d_canvasBuffer && d_canvasTiles.empty();
+}
+
+void ChromeWidget::setRenderingCanvasTiledEnabled(bool enabled)
+{
+    if (d_renderingCanvasTiledEnabled == enabled)
+    {
+        return;
+    }
+
+    // whatever is pending has to get to the texture before we replace it
+    flushCanvas();
+
+    d_renderingCanvasTiledEnabled = enabled;
+
+    if (hasRenderingCanvas())
+    {
+        resizeRenderingCanvas();
+    }
+}
+
+bool ChromeWidget::isRenderingCanvasTiledEnabled() const
+{
+    return d_renderingCanvasTiledEnabled;
+}
+
+bool ChromeWidget::hasRenderingCanvas() const
+{
+    return d_renderOutputTexture || !d_canvasTiles.empty();
+}
+
+size_t ChromeWidget::getRenderingCanvasUploadsSaved() const
+{
+    return d_canvasUploadsSaved;
+}
+
+void ChromeWidget::setColourRect(const ColourRect& rect)
+{
+    d_colourRect = rect;
+
+    invalidate();
+}
+
+ColourRect ChromeWidget::getColourRect() const
+{
+    return d_colourRect;
+}
+
+void ChromeWidget::populateGeometryBuffer()
+{
+    if (d_nativeContentTexture)
+    {
+        populateNativeGeometryBuffer();
+        return;
+    }
+
+    if (!hasRenderingCanvas())
+    {
+        resizeRenderingCanvas();
+    }
+
+    Sizef pixelSize = getPixelSize();
+    const Sizef alteredPixelSize = pixelSize * d_effectiveRenderingDetailRatio;
+
+    ColourRect colourRect(d_colourRect);
+    colourRect.modulateAlpha(getEffectiveAlpha());
+
+    if (alteredPixelSize.d_width * alteredPixelSize.d_height == 0)
+    {
+        d_geometry->reset();
+        return; // guard from division by zero, also it doesn't really make sense to render anyways
+    }
+
+    if (!d_canvasTiles.empty())
+    {
+        populateTiledGeometryBuffer(colourRect);
+        return;
+    }
+
+    const Sizef& textureSize = d_canvasTextureSize;
+
+    // when ring scrolling, the canvas may wrap around the texture edges,
+    // each piece that doesn't wrap gets its own quad
+    Rectf canvasPieces[4];
+    Rectf texturePieces[4];
+    const size_t pieceCount = mapCanvasRect(
+        Rectf(0.0f, 0.0f, alteredPixelSize.d_width, alteredPixelSize.d_height),
+        canvasPieces, texturePieces);
+
+    d_geometry->reset();
+    d_geometry->setActiveTexture(d_renderOutputTexture);
+
+    for (size_t i = 0; i < pieceCount; ++i)
+    {
+        const Rectf& canvasPiece = canvasPieces[i];
+        const Rectf& texturePiece = texturePieces[i];
+
+        appendQuad(*d_geometry,
+            Rectf(canvasPiece.left() / d_effectiveRenderingDetailRatio, canvasPiece.top() / d_effectiveRenderingDetailRatio,
+                  canvasPiece.right() / d_effectiveRenderingDetailRatio, canvasPiece.bottom() / d_effectiveRenderingDetailRatio),
+            Rectf(texturePiece.left() / textureSize.d_width, texturePiece.top() / textureSize.d_height,
+                  texturePiece.right() / textureSize.d_width, texturePiece.bottom() / textureSize.d_height),
+            colourRect.getSubRectangle(
+                canvasPiece.left() / alteredPixelSize.d_width, canvasPiece.right() / alteredPixelSize.d_width,
+                canvasPiece.top() / alteredPixelSize.d_height, canvasPiece.bottom() / alteredPixelSize.d_height));
+    }
+}
+
+void ChromeWidget::populateNativeGeometryBuffer()
+{
+    d_geometry->reset();
+
+    const Sizef pixelSize = getPixelSize();
+    const Sizef& contentSize = d_nativeContentTexture->getOriginalDataSize();
+    const Sizef& textureSize = d_nativeContentTexture->getSize();
+
+    if (pixelSize.d_width * pixelSize.d_height == 0 || contentSize.d_width * contentSize.d_height == 0)
+    {
+        return;
+    }
+
+    // like Chrome's image documents, original size unless that doesn't fit
+    const float scale = std::min(1.0f, std::min(pixelSize.d_width / contentSize.d_width,
+                                                pixelSize.d_height / contentSize.d_height));
+
+    ColourRect colourRect(d_colourRect);
+    colourRect.modulateAlpha(getEffectiveAlpha());
+
+    d_geometry->setActiveTexture(d_nativeContentTexture);
+
+    appendQuad(*d_geometry,
+        Rectf(0.0f, 0.0f, contentSize.d_width * scale, contentSize.d_height * scale),
+        Rectf(0.0f, 0.0f, contentSize.d_width / textureSize.d_width, contentSize.d_height / textureSize.d_height),
+        colourRect);
+}
+
+void ChromeWidget::populateTiledGeometryBuffer(const ColourRect& colourRect)
+{
+    const Sizef alteredPixelSize = getPixelSize() * d_effectiveRenderingDetailRatio;
+
+    d_geometry->reset();
+
+    for (size_t row = 0; row < d_canvasTileRows; ++row)
+    {
+        for (size_t column = 0; column < d_canvasTileColumns; ++column)
+        {
+            Texture* tile = d_canvasTiles[row * d_canvasTileColumns + column];
+            const Sizef tileTextureSize = tile->getSize();
+
+            const float tileLeft = static_cast<float>(column * CanvasTileSize);
+            const float tileTop = static_cast<float>(row * CanvasTileSize);
+
+            // tiles on the edges are only partially covered by the canvas
+            const Rectf canvasPiece(tileLeft, tileTop,
+                std::min(tileLeft + CanvasTileSize, alteredPixelSize.d_width),
+                std::min(tileTop + CanvasTileSize, alteredPixelSize.d_height));
+
+            if (canvasPiece.getWidth() <= 0 || canvasPiece.getHeight() <= 0)
+            {
+                continue;
+            }
+
+            d_geometry->setActiveTexture(tile);
+
+            appendQuad(*d_geometry,
+                Rectf(canvasPiece.left() / d_effectiveRenderingDetailRatio, canvasPiece.top() / d_effectiveRenderingDetailRatio,
+                      canvasPiece.right() / d_effectiveRenderingDetailRatio, canvasPiece.bottom() / d_effectiveRenderingDetailRatio),
+                Rectf(0.0f, 0.0f,
+                      canvasPiece.getWidth() / tileTextureSize.d_width, canvasPiece.getHeight() / tileTextureSize.d_height),
+                colourRect.getSubRectangle(
+                    canvasPiece.left() / alteredPixelSize.d_width, canvasPiece.right() / alteredPixelSize.d_width,
+                    canvasPiece.top() / alteredPixelSize.d_height, canvasPiece.bottom() / alteredPixelSize.d_height));
+        }
+    }
+}
+
+void ChromeWidget::onPaint(
+        Berkelium::Window *win,
+        const unsigned char *sourceBuffer,
+        const Berkelium::Rect &sourceBufferRect,
+        size_t numCopyRects,
+        const Berkelium::Rect *copyRects,
+        int dx, int dy,
+        const Berkelium::Rect &scrollRect)
+{
+    const int bytesPerPixel = 4;
+    const double startTime = getPaintCostTime();
+
+    if (!hasRenderingCanvas())
+    {
+        resizeRenderingCanvas();
+    }
+
+    const size_t sourcePitch = sourceBufferRect.width() * bytesPerPixel;
+    const ChromePixelKernels::Conversion conversion = getCanvasPixelConversion();
+
+    // modified from the GLUT demo from Berkelium source
+
+    scrollCanvas(Rectf(scrollRect.left(), scrollRect.top(), scrollRect.right(), scrollRect.bottom()), dx, dy);
+
+    for (size_t i = 0; i < numCopyRects; i++) {
+        int top = copyRects[i].top() - sourceBufferRect.top();
+        int left = copyRects[i].left() - sourceBufferRect.left();
+
+        writeCanvasRect(sourceBuffer + left * bytesPerPixel + top * sourcePitch, sourcePitch,
+            Rectf(copyRects[i].left(), copyRects[i].top(), copyRects[i].right(), copyRects[i].bottom()),
+            conversion);
+    }
+
+    ChromeSystem::notifyActivity();
+    d_paintQuietTime = 0.0f;
+
+    // the texture gets updated in drawSelf, make sure that happens
+    invalidate();
+
+    d_paintCostAccumulator += getPaintCostTime() - startTime;
+}
+
+void ChromeWidget::navigateTo(const char* url, size_t length)
+{
+    d_navigationDeferred = false;
+    setNativeContentTexture(0);
+
+    if (ChromeSystem::isResourceURL(url, length))
+    {
+        String filename;
+        String resourceGroup;
+        ChromeSystem::parseResourceURL(url, length, filename, resourceGroup);
+
+        // a cached payload knows whether it's displayed already, a file url always navigates
+        navigateToResource(filename, resourceGroup);
+        return;
+    }
+
+    // only content addressed payloads can tell they are displayed already, a plain url
+    // may serve something else every time, so it always navigates
+    d_payloadHash = 0;
+    d_payloadSerial = 0;
+
+    // new content, the frozen canvas is obsolete
+    thaw();
+
+    // the url has to outlive this call when Berkelium is owned by the pump thread
+    const std::string urlCopy(url, length);
+
+    BerkeliumDelegate* delegate = d_berkeliumDelegate;
+    // the page is only loaded once this navigation finishes, even before the task runs
+    const uint navigation = ++d_navigationGeneration;
+    executeChromeTask([delegate, urlCopy, navigation]() { delegate->navigateTo(urlCopy, navigation); });
+
+    d_paintQuietTime = 0.0f;
+}
+
+void ChromeWidget::setNativeContentTexture(Texture* texture)
+{
+    if (texture == d_nativeContentTexture)
+    {
+        return;
+    }
+
+    Texture* const oldTexture = d_nativeContentTexture;
+    d_nativeContentTexture = texture;
+
+    if (texture)
+    {
+        if (d_chromeWindowCreated)
+        {
+            releaseChromeWindow();
+        }
+
+        // nothing to thaw, the widget shows the texture until it navigates somewhere
+        d_frozen = false;
+        d_payloadHash = 0;
+        d_payloadSerial = 0;
+
+        for (size_t i = 0; i < d_pendingPaintPackets.size(); ++i)
+        {
+            ChromeSystem::releasePaintPacket(d_pendingPaintPackets[i]);
+        }
+        d_pendingPaintPackets.clear();
+
+        releaseRenderingCanvas();
+    }
+    else
+    {
+        // Chrome is back, it needs the canvas and the window sized again
+        d_renderingResizeNeeded = true;
+    }
+
+    if (oldTexture)
+    {
+        onNativeContentTextureReleased(*oldTexture);
+    }
+
+    invalidate();
+}
+
+Texture* ChromeWidget::getNativeContentTexture() const
+{
+    return d_nativeContentTexture;
+}
+
+void ChromeWidget::onNativeContentTextureReleased(Texture&)
+{}
+
+void ChromeWidget::rememberNavigation(const char* url, size_t length)
+{
+    d_payloadHash = 0;
+    d_payloadSerial = 0;
+    d_navigationDeferred = false;
+
+    const std::string urlCopy(url, length);
+
+    BerkeliumDelegate* delegate = d_berkeliumDelegate;
+    executeChromeTask([delegate, urlCopy]() { delegate->rememberUrl(urlCopy); });
+}
+
+void ChromeWidget::deferNavigation()
+{
+    d_payloadHash = 0;
+    d_payloadSerial = 0;
+    d_navigationDeferred = true;
+}
+
+void ChromeWidget::onDeferredNavigationNeeded()
+{}
+
+bool ChromeWidget::hasPageNavigatedAway() const
+{
+    return d_berkeliumDelegate->hasPageNavigated();
+}
+
+void ChromeWidget::executeJavascript(const char* script, size_t length)
+{
+    const std::string scriptCopy(script, length);
+
+    BerkeliumDelegate* delegate = d_berkeliumDelegate;
+    executeChromeTask([delegate, scriptCopy]() { delegate->executeJavascript(scriptCopy); });
+
+    d_paintQuietTime = 0.0f;
+}
+
+uint ChromeWidget::getNavigationGeneration() const
+{
+    return d_navigationGeneration;
+}
+
+bool ChromeWidget::isChromeContentLoaded() const
+{
+    return d_chromeWindowCreated && !d_frozen && d_berkeliumDelegate->isLoaded(d_navigationGeneration);
+}
+
+void ChromeWidget::queueJavascript(const String& script)
+{
+    JavascriptCommand command;
+    command.d_script = script.c_str();
+
+    d_javascriptQueueBytes += command.d_script.size();
+    d_javascriptQueue.push_back(command);
+}
+
+void ChromeWidget::queueJavascript(const String& key, const String& script)
+{
+    const std::string keyString(key.c_str());
+    const JavascriptQueueKeyMap::iterator it = d_javascriptQueueKeys.find(keyString);
+
+    if (it != d_javascriptQueueKeys.end())
+    {
+        // last write wins, the command keeps its place in the queue
+        std::string& queued = d_javascriptQueue[it->second].d_script;
+
+        d_javascriptQueueBytes -= queued.size();
+        queued = script.c_str();
+        d_javascriptQueueBytes += queued.size();
+        return;
+    }
+
+    JavascriptCommand command;
+    command.d_key = keyString;
+    command.d_script = script.c_str();
+
+    d_javascriptQueueKeys[keyString] = d_javascriptQueue.size();
+    d_javascriptQueueBytes += command.d_script.size();
+    d_javascriptQueue.push_back(command);
+}
+
+size_t ChromeWidget::getJavascriptQueueDepth() const
+{
+    return d_javascriptQueue.size();
+}
+
+size_t ChromeWidget::getJavascriptQueueBytes() const
+{
+    return d_javascriptQueueBytes;
+}
+
+size_t ChromeWidget::getJavascriptBytesSent() const
+{
+    return d_javascriptBytesSent;
+}
+
+size_t ChromeWidget::flushJavascriptQueue()
+{
+    d_javascriptBytesSent = 0;
+
+    if (d_javascriptQueue.empty() || d_evicted)
+    {
+        // evicted widgets keep their scripts until they are restored
+        return 0;
+    }
+
+    if (!isChromeContentLoaded())
+    {
+        // the scripts change the page, a frozen widget can't stay frozen
+        thaw();
+        return 0;
+    }
+
+    // every script goes through its own indirect eval, so it's parsed on its own and runs in the global
+    // scope, in svg documents too, one that fails mustn't drop the rest of the batch
+    static const char scriptPrefix[] = "try{(0,eval)(";
+    static const char scriptSuffix[] = ")}catch(e){console.error(e)}\n";
+
+    std::string script;
+    script.reserve(d_javascriptQueueBytes +
+        d_javascriptQueue.size() * (sizeof(scriptPrefix) + sizeof(scriptSuffix)));
+
+    for (size_t i = 0; i < d_javascriptQueue.size(); ++i)
+    {
+        const std::string& queued = d_javascriptQueue[i].d_script;
+
+        script += scriptPrefix;
+        appendJavascriptString(script, queued.c_str(), queued.size());
+        script += scriptSuffix;
+    }
+
+    d_javascriptQueue.clear();
+    d_javascriptQueueKeys.clear();
+    d_javascriptQueueBytes = 0;
+
+    executeJavascript(script.c_str(), script.size());
+    d_javascriptBytesSent = script.size();
+
+    // the scripts may have changed the page, navigating to the same payload has to reload it
+    d_payloadHash = 0;
+    d_payloadSerial = 0;
+
+    return d_javascriptBytesSent;
+}
+
+void ChromeWidget::appendJavascriptString(std::string& script, const char* text, size_t length)
+{
+    script += '\'';
+
+    for (size_t i = 0; i < length; ++i)
+    {
+        const char c = text[i];
+
+        switch (c)
+        {
+            case '\\': script += "\\\\"; break;
+            case '\'': script += "\\'"; break;
+            case '\n': script += "\\n"; break;
+            case '\r': script += "\\r"; break;
+            // \0 followed by a digit would be an octal escape
+            case '\0': script += "\\x00"; break;
+            default:
+                // U+2028 and U+2029 end lines in JavaScript string literals
+                if (c == '\xE2' && i + 2 < length && text[i + 1] == '\x80' &&
+                    (text[i + 2] == '\xA8' || text[i + 2] == '\xA9'))
+                {
+                    script += text[i + 2] == '\xA8' ? "\\u2028" : "\\u2029";
+                    i += 2;
+                }
+                else
+                {
+                    script += c;
+                }
+                break;
+        }
+    }
+
+    script += '\'';
+}
+
+void ChromeWidget::setHostMessagesEnabled(bool enabled)
+{
+    d_hostMessagesEnabled = enabled;
+
+    BerkeliumDelegate* delegate = d_berkeliumDelegate;
+    executeChromeTask([delegate, enabled]() { delegate->setHostMessagesEnabled(enabled); });
+}
+
+bool ChromeWidget::isHostMessagesEnabled() const
+{
+    return d_hostMessagesEnabled;
+}
+
+size_t ChromeWidget::getHostMessageCount() const
+{
+    return d_hostMessageCount;
+}
+
+size_t ChromeWidget::getHostMessageBytes() const
+{
+    return d_hostMessageBytes;
+}
+
+void ChromeWidget::onHostMessages(const uint8* data, size_t size)
+{
+    // one args object for the whole batch, handlers mustn't keep the data pointer
+    ChromeHostMessageEventArgs args(this);
+    size_t offset = 0;
+
+    while (size - offset >= HostMessageHeaderSize)
+    {
+        const uint8* header = data + offset;
+        const size_t length = static_cast<size_t>(header[1]) |
+            (static_cast<size_t>(header[2]) << 8) |
+            (static_cast<size_t>(header[3]) << 16) |
+            (static_cast<size_t>(header[4]) << 24);
+
+        offset += HostMessageHeaderSize;
+
+        if (length > size - offset)
+        {
+            // truncated frame, the rest of the batch can't be trusted
+            break;
+        }
+
+        args.d_channel = header[0];
+        args.d_data = data + offset;
+        args.d_size = length;
+        args.handled = 0;
+
+        ++d_hostMessageCount;
+        d_hostMessageBytes += length;
+
+        onHostMessage(args);
+
+        offset += length;
+    }
+}
+
+void ChromeWidget::onHostMessage(ChromeHostMessageEventArgs& e)
+{
+    fireEvent(EventHostMessage, e, EventNamespace);
+}
+
+void ChromeWidget::queuePaintPacket(ChromePaintPacket* packet)
+{
+    if (d_nativeContentTexture || d_evicted)
+    {
+        // left over from the window we destroyed
+        ChromeSystem::releasePaintPacket(packet);
+        return;
+    }
+
+    if (packet->d_copyRects.empty() && packet->d_dx == 0 && packet->d_dy == 0)
+    {
+        // host messages are delivered right away, we are updating, not drawing
+        if (!packet->d_hostMessages.empty())
+        {
+            onHostMessages(&packet->d_hostMessages[0], packet->d_hostMessages.size());
+        }
+
+        ChromeSystem::releasePaintPacket(packet);
+        return;
+    }
+
+    d_pendingPaintPackets.push_back(packet);
+    d_paintQuietTime = 0.0f;
+    ChromeSystem::notifyActivity();
+
+    // the packet gets applied in drawSelf, make sure that happens
+    invalidate();
+}
+
+void ChromeWidget::applyPendingPaintPackets()
+{
+    if (d_pendingPaintPackets.empty())
+    {
+        return;
+    }
+
+    const double startTime = getPaintCostTime();
+
+    for (size_t i = 0; i < d_pendingPaintPackets.size(); ++i)
+    {
+        onPaint(*d_pendingPaintPackets[i]);
+        ChromeSystem::releasePaintPacket(d_pendingPaintPackets[i]);
+    }
+
+    d_pendingPaintPackets.clear();
+
+    d_paintCostAccumulator += getPaintCostTime() - startTime;
+}
+
+void ChromeWidget::onPaint(const ChromePaintPacket& packet)
+{
+    const int bytesPerPixel = 4;
+
+    if (!hasRenderingCanvas())
+    {
+        resizeRenderingCanvas();
+    }
+
+    const ChromePixelKernels::Conversion conversion = getCanvasPixelConversion();
+
+    scrollCanvas(packet.d_scrollRect, packet.d_dx, packet.d_dy);
+
+    for (size_t i = 0; i < packet.d_copyRects.size(); ++i)
+    {
+        const ChromePaintPacket::CopyRect& copyRect = packet.d_copyRects[i];
+
+        if (copyRect.d_area.getWidth() <= 0.0f || copyRect.d_area.getHeight() <= 0.0f)
+        {
+            // empty rects don't have any pixels in the packet
+            continue;
+        }
+
+        writeCanvasRect(packet.d_pixels.data() + copyRect.d_offset,
+            static_cast<size_t>(copyRect.d_area.getWidth()) * bytesPerPixel, copyRect.d_area, conversion);
+    }
+}
+
+void ChromeWidget::scrollCanvas(const Rectf& scrollRect, int dx, int dy)
+{
+    if (dx == 0 && dy == 0)
+    {
+        return;
+    }
+
+    const Sizef alteredPixelSize = getPixelSize() * d_effectiveRenderingDetailRatio;
+
+    if (isRenderingCanvasRingActive() &&
+        2 * scrollRect.getWidth() * scrollRect.getHeight() >=
+            floor(alteredPixelSize.d_width) * floor(alteredPixelSize.d_height))
+    {
+        // most of the canvas scrolls, it's cheaper to move the ring origin
+        scrollCanvasRing(scrollRect, dx, dy);
+        return;
+    }
+
+    // scroll_rect contains the Rect we need to move
+    // First we figure out where the the data is moved to by translating it,
+    // next we figure out where they intersect, giving the scrolled region
+    const Rectf scrolledSharedRect(
+        std::max(scrollRect.left(), scrollRect.left() - dx),
+        std::max(scrollRect.top(), scrollRect.top() - dy),
+        std::min(scrollRect.right(), scrollRect.right() - dx),
+        std::min(scrollRect.bottom(), scrollRect.bottom() - dy));
+
+    // Only do scrolling if they have non-zero intersection
+    if (scrolledSharedRect.getWidth() > 0 && scrolledSharedRect.getHeight() > 0)
+    {
+        scrollCanvasRect(scrolledSharedRect, dx, dy);
+    }
+}
+
+ChromePixelKernels::Conversion ChromeWidget::getCanvasPixelConversion() const
+{
+    // Chrome gives us premultiplied BGRA, without transparency alpha is always 255 and
+    // premultiplied is the same as straight, no need to unpremultiply anything
+    return ChromePixelKernels::getConversion(
+        d_transparencyEnabled ? ChromePixelKernels::PL_BGRAPremultiplied : ChromePixelKernels::PL_BGRA,
+        ChromeSystem::getTextureUploader().getPixelLayout());
+}
+
+void ChromeWidget::writeCanvasRect(const uint8* source, size_t sourcePitch, const Rectf& area,
+                                   ChromePixelKernels::Conversion conversion)
+{
+    const int bytesPerPixel = 4;
+
+    const Sizef& textureSize = d_canvasTextureSize;
+
+    // Berkelium may still paint with the old size right after we resized the canvas
+    const int left = std::max(0, static_cast<int>(area.left()));
+    const int top = std::max(0, static_cast<int>(area.top()));
+    const int right = std::min(static_cast<int>(textureSize.d_width), static_cast<int>(area.right()));
+    const int bottom = std::min(static_cast<int>(textureSize.d_height), static_cast<int>(area.bottom()));
+
+    if (right <= left || bottom <= top)
+    {
+        return;
+    }
+
+    source += (top - static_cast<int>(area.top())) * sourcePitch +
+              (left - static_cast<int>(area.left())) * bytesPerPixel;
+
+    Rectf canvasPieces[4];
+    Rectf texturePieces[4];
+    const size_t pieceCount = mapCanvasRect(Rectf(left, top, right, bottom), canvasPieces, texturePieces);
+
+    for (size_t i = 0; i < pieceCount; ++i)
+    {
+        writeTextureRect(
+            source + (static_cast<int>(canvasPieces[i].top()) - top) * sourcePitch +
+                     (static_cast<int>(canvasPieces[i].left()) - left) * bytesPerPixel,
+            sourcePitch, texturePieces[i], conversion);
+    }
+}
+
+void ChromeWidget::writeTextureRect(const uint8* source, size_t sourcePitch, const Rectf& area,
+                                    ChromePixelKernels::Conversion conversion)
+{
+    const int bytesPerPixel = 4;
+
+    const Sizef& textureSize = d_canvasTextureSize;
+    const size_t canvasPitch = static_cast<size_t>(textureSize.d_width) * bytesPerPixel;
+
+    const size_t left = static_cast<size_t>(area.left());
+    const size_t top = static_cast<size_t>(area.top());
+    const size_t wid = static_cast<size_t>(area.right()) - left;
+    const size_t hig = static_cast<size_t>(area.bottom()) - top;
+    const size_t rowSize = wid * bytesPerPixel;
+
+    if (!d_canvasBuffer)
+    {
+        // without the shadow buffer, pixels go straight from Berkelium's buffer to the texture,
+        // unless we have to convert them, Berkelium's buffer is read only
+        if (conversion != ChromePixelKernels::PC_Copy)
+        {
+            uint8* staging = ChromeSystem::getStagingArena().acquire(rowSize * hig);
+            ChromePixelKernels::convert(conversion, staging, rowSize, source, sourcePitch, wid, hig);
+
+            source = staging;
+            sourcePitch = rowSize;
+        }
+
+        uploadTextureRect(source, sourcePitch, area);
+        return;
+    }
+
+    ChromePixelKernels::convert(conversion,
+        d_canvasBuffer + top * canvasPitch + left * bytesPerPixel, canvasPitch, source, sourcePitch, wid, hig);
+
+    d_canvasDirtyRegion.addRect(area);
+}
+
+void ChromeWidget::readCanvasRect(uint8* destination, size_t destinationPitch, const Rectf& area) const
+{
+    const int bytesPerPixel = 4;
+
+    const size_t canvasPitch = static_cast<size_t>(d_canvasTextureSize.d_width) * bytesPerPixel;
+
+    Rectf canvasPieces[4];
+    Rectf texturePieces[4];
+    const size_t pieceCount = mapCanvasRect(area, canvasPieces, texturePieces);
+
+    for (size_t i = 0; i < pieceCount; ++i)
+    {
+        const size_t rowSize = static_cast<size_t>(texturePieces[i].getWidth()) * bytesPerPixel;
+        const size_t hig = static_cast<size_t>(texturePieces[i].getHeight());
+
+        uint8* output = destination +
+            static_cast<size_t>(canvasPieces[i].top() - area.top()) * destinationPitch +
+            static_cast<size_t>(canvasPieces[i].left() - area.left()) * bytesPerPixel;
+        const uint8* input = d_canvasBuffer +
+            static_cast<size_t>(texturePieces[i].top()) * canvasPitch +
+            static_cast<size_t>(texturePieces[i].left()) * bytesPerPixel;
+
+        for (size_t jj = 0; jj < hig; ++jj)
+        {
+            memcpy(output, input, rowSize);
+
+            output += destinationPitch;
+            input += canvasPitch;
+        }
+    }
+}
+
+void ChromeWidget::markCanvasDirty(const Rectf& area)
+{
+    Rectf canvasPieces[4];
+    Rectf texturePieces[4];
+    const size_t pieceCount = mapCanvasRect(area, canvasPieces, texturePieces);
+
+    for (size_t i = 0; i < pieceCount; ++i)
+    {
+        d_canvasDirtyRegion.addRect(texturePieces[i]);
+    }
+}
+
+size_t ChromeWidget::mapCanvasRect(const Rectf& area, Rectf* canvasPieces, Rectf* texturePieces) const
+{
+    const Sizef& textureSize = d_canvasTextureSize;
+
+    // where does the area start in the texture and how much of it fits before we wrap
+    const float textureLeft = wrapCanvasCoordinate(area.left() + d_canvasRingOffsetX, textureSize.d_width);
+    const float textureTop = wrapCanvasCoordinate(area.top() + d_canvasRingOffsetY, textureSize.d_height);
+    const float firstWidth = std::min(area.getWidth(), textureSize.d_width - textureLeft);
+    const float firstHeight = std::min(area.getHeight(), textureSize.d_height - textureTop);
+
+    size_t pieceCount = 0;
+
+    for (int row = 0; row < 2; ++row)
+    {
+        const float pieceTop = row == 0 ? area.top() : area.top() + firstHeight;
+        const float pieceBottom = row == 0 ? area.top() + firstHeight : area.bottom();
+        const float pieceTextureTop = row == 0 ? textureTop : 0.0f;
+
+        if (pieceBottom <= pieceTop)
+        {
+            continue;
+        }
+
+        for (int column = 0; column < 2; ++column)
+        {
+            const float pieceLeft = column == 0 ? area.left() : area.left() + firstWidth;
+            const float pieceRight = column == 0 ? area.left() + firstWidth : area.right();
+            const float pieceTextureLeft = column == 0 ? textureLeft : 0.0f;
+
+            if (pieceRight <= pieceLeft)
+            {
+                continue;
+            }
+
+            canvasPieces[pieceCount] = Rectf(pieceLeft, pieceTop, pieceRight, pieceBottom);
+            texturePieces[pieceCount] = Rectf(
+                pieceTextureLeft, pieceTextureTop,
+                pieceTextureLeft + (pieceRight - pieceLeft), pieceTextureTop + (pieceBottom - pieceTop));
+            ++pieceCount;
+        }
+    }
+
+    return pieceCount;
+}
+
+void ChromeWidget::scrollCanvasRect(const Rectf& area, int dx, int dy)
+{
+    const int bytesPerPixel = 4;
+
+    const Sizef& textureSize = d_canvasTextureSize;
+    const size_t canvasPitch = static_cast<size_t>(textureSize.d_width) * bytesPerPixel;
+
+    // Berkelium may still scroll with the old size right after we resized the canvas,
+    // both the source and the destination have to fit
+    const int left = std::max(std::max(0, -dx), static_cast<int>(area.left()));
+    const int top = std::max(std::max(0, -dy), static_cast<int>(area.top()));
+    const int right = std::min(static_cast<int>(textureSize.d_width) - std::max(0, dx), static_cast<int>(area.right()));
+    const int bottom = std::min(static_cast<int>(textureSize.d_height) - std::max(0, dy), static_cast<int>(area.bottom()));
+
+    if (right <= left || bottom <= top)
+    {
+        return;
+    }
+
+    const int wid = right - left;
+    const int hig = bottom - top;
+
+    if (d_canvasBuffer)
+    {
+        // the canvas buffer always holds what the texture holds, so we just move
+        // the rows around in place and let the next flush upload the result.
+        // When moving down we have to go bottom up to avoid overwriting rows
+        // we haven't moved yet.
+        const int firstRow = dy > 0 ? hig - 1 : 0;
+        const int inc = dy > 0 ? -1 : 1;
+
+        for (int jj = firstRow; jj >= 0 && jj < hig; jj += inc)
+        {
+            moveCanvasRow(top + jj, left, right, dx, dy);
+        }
+
+        markCanvasDirty(Rectf(left + dx, top + dy, right + dx, bottom + dy));
+        return;
+    }
+
+    // without the shadow buffer we have to read the whole texture back,
+    // the scrolled area is then packed right after it
+    const size_t textureBytes = canvasPitch * static_cast<size_t>(textureSize.d_height);
+    const size_t rowSize = static_cast<size_t>(wid) * bytesPerPixel;
+
+    uint8* inputBuffer = ChromeSystem::getStagingArena().acquire(textureBytes + rowSize * hig);
+    uint8* outputBuffer = inputBuffer + textureBytes;
+
+    d_renderOutputTexture->blitToMemory(inputBuffer);
+
+    // Annoyingly, OpenGL doesn't provide convenient primitives, so
+    // we manually copy out the region
+    for (int jj = 0; jj < hig; ++jj)
+    {
+        memcpy(
+            outputBuffer + jj * rowSize,
+            inputBuffer + (top + jj) * canvasPitch + left * bytesPerPixel,
+            rowSize
+        );
+    }
+
+    uploadTextureRect(outputBuffer, rowSize, Rectf(left + dx, top + dy, right + dx, bottom + dy));
+}
+
+void ChromeWidget::moveCanvasRow(int y, int left, int right, int dx, int dy)
+{
+    const int bytesPerPixel = 4;
+
+    const Sizef& textureSize = d_canvasTextureSize;
+    const int textureWidth = static_cast<int>(textureSize.d_width);
+    const size_t canvasPitch = static_cast<size_t>(textureWidth) * bytesPerPixel;
+
+    uint8* sourceRow = d_canvasBuffer + canvasPitch *
+        static_cast<size_t>(wrapCanvasCoordinate(y + d_canvasRingOffsetY, textureSize.d_height));
+    uint8* destinationRow = d_canvasBuffer + canvasPitch *
+        static_cast<size_t>(wrapCanvasCoordinate(y + dy + d_canvasRingOffsetY, textureSize.d_height));
+
+    // source and destination may wrap around the ring at different places, we move
+    // the row in pieces that don't wrap at all, going against the direction of the move
+    // so that we never overwrite pixels we haven't moved yet.
+    // Without ring scrolling this is just one memmove.
+    if (dx > 0)
+    {
+        int end = right;
+        while (end > left)
+        {
+            const int sourceEnd = static_cast<int>(wrapCanvasCoordinate(end - 1 + d_canvasRingOffsetX, textureSize.d_width)) + 1;
+            const int destinationEnd = static_cast<int>(wrapCanvasCoordinate(end - 1 + dx + d_canvasRingOffsetX, textureSize.d_width)) + 1;
+            const int length = std::min(end - left, std::min(sourceEnd, destinationEnd));
+
+            memmove(destinationRow + (destinationEnd - length) * bytesPerPixel,
+                    sourceRow + (sourceEnd - length) * bytesPerPixel,
+                    length * bytesPerPixel);
+
+            end -= length;
+        }
+    }
+    else
+    {
+        int start = left;
+        while (start < right)
+        {
+            const int sourceStart = static_cast<int>(wrapCanvasCoordinate(start + d_canvasRingOffsetX, textureSize.d_width));
+            const int destinationStart = static_cast<int>(wrapCanvasCoordinate(start + dx + d_canvasRingOffsetX, textureSize.d_width));
+            const int length = std::min(right - start, std::min(textureWidth - sourceStart, textureWidth - destinationStart));
 
-    // vertex 5 - bottom right
-    vbuffer[5].position   = Vector3f(pixelSize.d_width, pixelSize.d_height, 0.0f);
-    vbuffer[5].colour_val = colourRect.d_bottom_right;
-    vbuffer[5].tex_coords = Vector2f(rightUV, bottomUV);
+            memmove(destinationRow + destinationStart * bytesPerPixel,
+                    sourceRow + sourceStart * bytesPerPixel,
+                    length * bytesPerPixel);
 
-    d_geometry->reset();
-    d_geometry->setActiveTexture(d_renderOutputTexture);
-    d_geometry->appendGeometry(vbuffer, 6);
+            start += length;
+        }
+    }
 }
 
-void ChromeWidget::onPaint(
-        Berkelium::Window *win,
-        const unsigned char *sourceBuffer,
-        const Berkelium::Rect &sourceBufferRect,
-        size_t numCopyRects,
-        const Berkelium::Rect *copyRects,
-        int dx, int dy,
-        const Berkelium::Rect &scrollRect)
+void ChromeWidget::scrollCanvasRing(const Rectf& area, int dx, int dy)
 {
     const int bytesPerPixel = 4;
 
-    if (!d_renderOutputTexture)
+    const Sizef alteredPixelSize = getPixelSize() * d_effectiveRenderingDetailRatio;
+    const Sizef& textureSize = d_canvasTextureSize;
+    const float canvasWidth = std::min(floorf(alteredPixelSize.d_width), textureSize.d_width);
+    const float canvasHeight = std::min(floorf(alteredPixelSize.d_height), textureSize.d_height);
+
+    const float left = std::max(0.0f, area.left());
+    const float top = std::max(0.0f, area.top());
+    const float right = std::min(canvasWidth, area.right());
+    const float bottom = std::min(canvasHeight, area.bottom());
+
+    // moving the origin scrolls the whole canvas but only the area should scroll,
+    // so we stash the rest of the canvas (usually just the scrollbars) and put it back after
+    Rectf stash[4];
+    size_t stashCount = 0;
+
+    if (top > 0.0f)
+        stash[stashCount++] = Rectf(0.0f, 0.0f, canvasWidth, top);
+    if (bottom < canvasHeight)
+        stash[stashCount++] = Rectf(0.0f, bottom, canvasWidth, canvasHeight);
+    if (left > 0.0f && bottom > top)
+        stash[stashCount++] = Rectf(0.0f, top, left, bottom);
+    if (right < canvasWidth && bottom > top)
+        stash[stashCount++] = Rectf(right, top, canvasWidth, bottom);
+
+    size_t stashSize = 0;
+    for (size_t i = 0; i < stashCount; ++i)
     {
-        resizeRenderingCanvas();
+        stashSize += static_cast<size_t>(stash[i].getWidth()) * static_cast<size_t>(stash[i].getHeight()) * bytesPerPixel;
     }
 
-    const Sizef alteredPixelSize = getPixelSize() * d_renderingDetailRatio;
-    const Sizef textureSize = d_renderOutputTexture->getSize();
-
-    // modified from the GLUT demo from Berkelium source
+    uint8* const stashMemory = ChromeSystem::getStagingArena().acquire(stashSize);
 
-    if (d_ignorePartialPaint)
+    uint8* stashBuffer = stashMemory;
+    for (size_t i = 0; i < stashCount; ++i)
     {
-        if (sourceBufferRect.left() == 0 &&
-            sourceBufferRect.top() == 0 &&
-            sourceBufferRect.right() == static_cast<size_t>(floor(alteredPixelSize.d_width)) &&
-            sourceBufferRect.bottom() == static_cast<size_t>(floor(alteredPixelSize.d_height)))
-        {
-            d_renderOutputTexture->blitFromMemory(const_cast<unsigned char*>(sourceBuffer),
-                Rectf(sourceBufferRect.left(), sourceBufferRect.top(), sourceBufferRect.right(), sourceBufferRect.bottom()));
-            d_ignorePartialPaint = false;
-        }
+        const size_t rowSize = static_cast<size_t>(stash[i].getWidth()) * bytesPerPixel;
 
-        return;
+        readCanvasRect(stashBuffer, rowSize, stash[i]);
+        stashBuffer += rowSize * static_cast<size_t>(stash[i].getHeight());
     }
 
-    if (dx != 0 || dy != 0)
+    // content moves by dx, dy, so canvas pixel at x, y is where x - dx, y - dy used to be
+    d_canvasRingOffsetX = static_cast<int>(wrapCanvasCoordinate(static_cast<float>(d_canvasRingOffsetX - dx), textureSize.d_width));
+    d_canvasRingOffsetY = static_cast<int>(wrapCanvasCoordinate(static_cast<float>(d_canvasRingOffsetY - dy), textureSize.d_height));
+
+    stashBuffer = stashMemory;
+    for (size_t i = 0; i < stashCount; ++i)
     {
-        // scroll_rect contains the Rect we need to move
-        // First we figure out where the the data is moved to by translating it
-        Berkelium::Rect scrolledRect = scrollRect.translate(-dx, -dy);
-        // Next we figure out where they intersect, giving the scrolled
-        // region
-        Berkelium::Rect scrolledSharedRect = scrollRect.intersect(scrolledRect);
-        // Only do scrolling if they have non-zero intersection
-        if (scrolledSharedRect.width() > 0 && scrolledSharedRect.height() > 0)
-        {
-            // And the scroll is performed by moving shared_rect by (dx,dy)
-            Berkelium::Rect sharedRect = scrolledSharedRect.translate(dx, dy);
+        const size_t rowSize = static_cast<size_t>(stash[i].getWidth()) * bytesPerPixel;
 
-            const int wid = scrolledSharedRect.width();
-            const int hig = scrolledSharedRect.height();
-            
-            int inc = 1;
-            char* outputBuffer = d_scrollBuffer;
-            // source data is offset by 1 line to prevent memcpy aliasing
-            // In this case, it can happen if dy == 0 and dx != 0.
-            char* inputBuffer = d_scrollBuffer + (static_cast<size_t>(textureSize.d_width) * 1 * bytesPerPixel);
-            int jj = 0;
-            if (dy > 0)
-            {
-                // Here, we need to shift the buffer around so that we start in the
-                // extra row at the end, and then copy in reverse so that we
-                // don't clobber source data before copying it.
-                outputBuffer = d_scrollBuffer + (
-                    (scrolledSharedRect.top() + hig + 1) * static_cast<size_t>(textureSize.d_width)
-                    - hig * wid) * bytesPerPixel;
-                inputBuffer = d_scrollBuffer;
-                inc = -1;
-                jj = hig-1;
-            }
+        // already converted, it comes from the canvas
+        writeCanvasRect(stashBuffer, rowSize, stash[i], ChromePixelKernels::PC_Copy);
+        stashBuffer += rowSize * static_cast<size_t>(stash[i].getHeight());
+    }
 
-            d_renderOutputTexture->blitToMemory(static_cast<char*>(inputBuffer));
-
-            // Annoyingly, OpenGL doesn't provide convenient primitives, so
-            // we manually copy out the region to the beginning of the
-            // buffer
-            for(; jj < hig && jj >= 0; jj += inc) {
-                memcpy(
-                    outputBuffer + (jj * wid) * bytesPerPixel,
-                    inputBuffer +
-                        ((scrolledSharedRect.top() + jj) * static_cast<size_t>(textureSize.d_width)
-                        + scrolledSharedRect.left()) * bytesPerPixel,
-                    wid * bytesPerPixel
-                );
-            }
+    // the newly exposed strip comes in copy rects, nothing else needs uploading,
+    // we just have to redo the geometry with the new origin
+    invalidate();
+}
 
-            d_renderOutputTexture->blitFromMemory(outputBuffer,
-                Rectf(sharedRect.left(), sharedRect.top(), sharedRect.right(), sharedRect.bottom()));
-        }
+void ChromeWidget::flushCanvas()
+{
+    if (!hasRenderingCanvas() || d_canvasDirtyRegion.isEmpty())
+    {
+        return;
     }
-    
-    for (size_t i = 0; i < numCopyRects; i++) {
-        int wid = copyRects[i].width();
-        int hig = copyRects[i].height();
-        int top = copyRects[i].top() - sourceBufferRect.top();
-        int left = copyRects[i].left() - sourceBufferRect.left();
-        
-        for(int jj = 0; jj < hig; jj++) {
-            memcpy(
-                d_scrollBuffer + jj * wid * bytesPerPixel,
-                sourceBuffer + (left + (jj + top) * sourceBufferRect.width()) * bytesPerPixel,
-                wid * bytesPerPixel
-            );
-        }
 
-        d_renderOutputTexture->blitFromMemory(d_scrollBuffer,
-            Rectf(copyRects[i].left(), copyRects[i].top(), copyRects[i].right(), copyRects[i].bottom()));
+    const double startTime = getPaintCostTime();
+
+    const ChromeDirtyRegion::RectList& rects = d_canvasDirtyRegion.getRects();
+    for (ChromeDirtyRegion::RectList::const_iterator it = rects.begin(); it != rects.end(); ++it)
+    {
+        uploadCanvasRect(*it);
     }
 
-    d_ignorePartialPaint = false;
+    d_canvasUploadsSaved += d_canvasDirtyRegion.getAddedRectCount() - rects.size();
+    d_canvasDirtyRegion.clear();
+
+    d_paintCostAccumulator += getPaintCostTime() - startTime;
+}
+
+void ChromeWidget::uploadCanvasRect(const Rectf& area)
+{
+    const int bytesPerPixel = 4;
+
+    const size_t canvasPitch = static_cast<size_t>(d_canvasTextureSize.d_width) * bytesPerPixel;
+
+    const uint8* source = d_canvasBuffer +
+        static_cast<size_t>(area.top()) * canvasPitch +
+        static_cast<size_t>(area.left()) * bytesPerPixel;
+
+    uploadTextureRect(source, canvasPitch, area);
 }
 
 void ChromeWidget::onActivated(ActivationEventArgs& e)
 {
     Window::onActivated(e);
 
-    d_chromeWindow->focus();
+    BerkeliumDelegate* delegate = d_berkeliumDelegate;
+    executeChromeTask([delegate]()
+        {
+            if (Berkelium::Window* window = delegate->getWindow())
+            {
+                window->focus();
+            }
+        });
 }
 
 void ChromeWidget::onDeactivated(ActivationEventArgs& e)
 {
     Window::onDeactivated(e);
 
-    d_chromeWindow->unfocus();
+    BerkeliumDelegate* delegate = d_berkeliumDelegate;
+    executeChromeTask([delegate]()
+        {
+            if (Berkelium::Window* window = delegate->getWindow())
+            {
+                window->unfocus();
+            }
+        });
+}
+
+void ChromeWidget::onShown(WindowEventArgs& e)
+{
+    Window::onShown(e);
+
+    if (isEffectiveVisible())
+    {
+        restoreEvicted();
+
+        if (!d_frozen)
+        {
+            ensureChromeWindow();
+        }
+    }
+
+    updateThrottling();
+}
+
+void ChromeWidget::onHidden(WindowEventArgs& e)
+{
+    Window::onHidden(e);
+
+    // we may not get updated while hidden, so throttle right away
+    updateThrottling();
 }
 
 void ChromeWidget::onSized(WindowEventArgs& e)
@@ -471,10 +2610,19 @@ void ChromeWidget::onMouseMove(MouseEventArgs& e)
         Vector2f mousePosition(e.position - getUnclippedInnerRect().getPosition());
 
         // fix up the position if render output size and real widget size differ
-        mousePosition.d_x *= d_renderingDetailRatio;
-        mousePosition.d_y *= d_renderingDetailRatio;
+        mousePosition.d_x *= d_effectiveRenderingDetailRatio;
+        mousePosition.d_y *= d_effectiveRenderingDetailRatio;
 
-        d_chromeWindow->mouseMoved(mousePosition.d_x, mousePosition.d_y);
+        BerkeliumDelegate* delegate = d_berkeliumDelegate;
+        const int x = static_cast<int>(mousePosition.d_x);
+        const int y = static_cast<int>(mousePosition.d_y);
+        executeChromeTask([delegate, x, y]()
+            {
+                if (Berkelium::Window* window = delegate->getWindow())
+                {
+                    window->mouseMoved(x, y);
+                }
+            });
     }
 }
 
@@ -485,18 +2633,32 @@ void ChromeWidget::onMouseButtonDown(MouseEventArgs& e)
     if (d_interactionMode == IM_MouseOnlyInteraction ||
         d_interactionMode == IM_FullInteraction)
     {
+        int button = -1;
+
         switch (e.button)
         {
         case LeftButton:
-            d_chromeWindow->mouseButton(0, true);
+            button = 0;
             break;
         case MiddleButton:
-            d_chromeWindow->mouseButton(1, true);
+            button = 1;
             break;
         case RightButton:
-            d_chromeWindow->mouseButton(2, true);
+            button = 2;
             break;
         }
+
+        if (button != -1)
+        {
+            BerkeliumDelegate* delegate = d_berkeliumDelegate;
+            executeChromeTask([delegate, button]()
+                {
+                    if (Berkelium::Window* window = delegate->getWindow())
+                    {
+                        window->mouseButton(button, true);
+                    }
+                });
+        }
     }
 }
 
@@ -507,18 +2669,32 @@ void ChromeWidget::onMouseButtonUp(MouseEventArgs& e)
     if (d_interactionMode == IM_MouseOnlyInteraction ||
         d_interactionMode == IM_FullInteraction)
     {
+        int button = -1;
+
         switch (e.button)
         {
         case LeftButton:
-            d_chromeWindow->mouseButton(0, false);
+            button = 0;
             break;
         case MiddleButton:
-            d_chromeWindow->mouseButton(1, false);
+            button = 1;
             break;
         case RightButton:
-            d_chromeWindow->mouseButton(2, false);
+            button = 2;
             break;
         }
+
+        if (button != -1)
+        {
+            BerkeliumDelegate* delegate = d_berkeliumDelegate;
+            executeChromeTask([delegate, button]()
+                {
+                    if (Berkelium::Window* window = delegate->getWindow())
+                    {
+                        window->mouseButton(button, false);
+                    }
+                });
+        }
     }
 }
 
@@ -526,8 +2702,38 @@ void ChromeWidget::updateSelf(float elapsed)
 {
     Window::updateSelf(elapsed);
 
-    // sync Berkelium processes
-    ChromeSystem::update();
+    // sync Berkelium processes, the system makes sure this happens just once per frame
+    ChromeSystem::scheduledUpdate();
+
+    if (isEffectiveVisible())
+    {
+        restoreEvicted();
+
+        if (!d_chromeWindowCreated && !d_frozen)
+        {
+            ensureChromeWindow();
+        }
+    }
+
+    updateFreezing(elapsed);
+
+    // alpha, clipping and other widgets covering us can change without telling us
+    updateThrottling();
+
+    if (!d_pendingPaintPackets.empty() && !isEffectiveVisible())
+    {
+        // we won't get drawn, don't let the packets pile up
+        applyPendingPaintPackets();
+    }
+
+    updateAdaptiveRenderingDetail(elapsed);
+
+    d_canvasSizingPolicy.update(elapsed);
+
+    if (d_canvasSizingPolicy.isShrinkDue())
+    {
+        d_renderingResizeNeeded = true;
+    }
 
     if (d_renderingResizeDelay > 0.0 && d_renderingResizeTimer >= 0.0)
     {
@@ -541,61 +2747,229 @@ void ChromeWidget::updateSelf(float elapsed)
     }
 }
 
+void ChromeWidget::updateAdaptiveRenderingDetail(float elapsed)
+{
+    // what we spent painting and uploading since the last update is this frame's cost
+    d_paintCost += (static_cast<float>(d_paintCostAccumulator) - d_paintCost) * PaintCostSmoothing;
+    d_paintCostAccumulator = 0.0;
+
+    if (!d_renderingDetailAdaptiveEnabled)
+    {
+        return;
+    }
+
+    if (d_renderingDetailCooldown > 0.0f)
+    {
+        d_renderingDetailCooldown -= elapsed;
+        return;
+    }
+
+    const float minimumRatio = std::min(d_renderingDetailMinimumRatio, d_renderingDetailRatio);
+    float ratio = d_effectiveRenderingDetailRatio;
+
+    if (d_paintCost > d_renderingDetailCostBudget)
+    {
+        // over budget, drop the detail right away
+        ratio = std::max(ratio - AdaptiveDetailStep, minimumRatio);
+        d_renderingDetailSettleTimer = 0.0f;
+    }
+    else if (d_paintCost < d_renderingDetailCostBudget * AdaptiveDetailRaiseThreshold &&
+             ratio < d_renderingDetailRatio)
+    {
+        // the content has to stay calm for a while before we raise the detail again
+        d_renderingDetailSettleTimer += elapsed;
+
+        if (d_renderingDetailSettleTimer >= d_renderingDetailSettleTime)
+        {
+            ratio = std::min(ratio + AdaptiveDetailStep, d_renderingDetailRatio);
+            d_renderingDetailSettleTimer = 0.0f;
+        }
+    }
+    else
+    {
+        d_renderingDetailSettleTimer = 0.0f;
+    }
+
+    if (ratio != d_effectiveRenderingDetailRatio)
+    {
+        d_effectiveRenderingDetailRatio = ratio;
+        d_renderingDetailCooldown = AdaptiveDetailCooldown;
+
+        resizeRenderingCanvas();
+    }
+}
+
 void ChromeWidget::drawSelf(const RenderingContext& ctx)
 {
+    d_lastVisibleTime = getPaintCostTime();
+
+    restoreEvicted();
+
     if (d_renderingResizeNeeded)
     {
         resizeRenderingCanvas();
     }
 
+    applyPendingPaintPackets();
+
+    flushCanvas();
+
     Window::drawSelf(ctx);
 }
 
 void ChromeWidget::resizeRenderingCanvas()
 {
+    if (d_nativeContentTexture)
+    {
+        // the native content is drawn straight from its texture
+        d_renderingResizeTimer = -1.0f;
+        d_renderingResizeNeeded = false;
+        invalidate();
+        return;
+    }
+
     //const Size pixelSize = getPixelSize();
-    const Sizef alteredPixelSize = getPixelSize() * d_renderingDetailRatio;
-    size_t oldScrollBufferSize = 1 * (1 + 1) * 4;
+    const Sizef alteredPixelSize = getPixelSize() * d_effectiveRenderingDetailRatio;
+    const Sizef oldTextureSize = d_canvasTextureSize;
+    const bool tiled = d_renderingCanvasTiledEnabled && d_renderingCanvasShadowBufferEnabled;
+    // if true, the canvas content survives the resize and Chrome doesn't have to repaint everything
+    bool contentKept = false;
 
-    Renderer* renderer = System::getSingleton().getRenderer();
+    if (tiled)
+    {
+        if (d_renderOutputTexture)
+        {
+            ChromeSystem::releaseCanvasTexture(*d_renderOutputTexture);
+            d_renderOutputTexture = 0;
+        }
+        else if (!d_canvasTiles.empty() && d_canvasBuffer)
+        {
+            // whatever is pending has to reach the tiles we keep
+            flushCanvas();
+            contentKept = true;
+        }
 
-    if (d_renderOutputTexture)
+        resizeCanvasTiles(alteredPixelSize);
+
+        d_canvasTextureSize = Sizef(static_cast<float>(d_canvasTileColumns * CanvasTileSize),
+                                    static_cast<float>(d_canvasTileRows * CanvasTileSize));
+    }
+    else
     {
-        const Sizef size = d_renderOutputTexture->getSize();
-        oldScrollBufferSize = size.d_width * (size.d_height + 1) * 4;
+        resizeCanvasTiles(Sizef(0, 0));
 
-        if (size.d_width < alteredPixelSize.d_width ||
-            size.d_height < alteredPixelSize.d_height)
+        if (d_renderOutputTexture &&
+            d_canvasSizingPolicy.evaluate(alteredPixelSize, d_renderOutputTexture->getSize()) !=
+                ChromeCanvasSizingPolicy::D_Keep)
         {
-            // we will have to recreate the texture because the canvas won't fit anymore
-            renderer->destroyTexture(*d_renderOutputTexture);
+            // the canvas doesn't fit anymore or the texture has been too big for long enough
+            ChromeSystem::releaseCanvasTexture(*d_renderOutputTexture);
             d_renderOutputTexture = 0;
         }
-        else if (size.d_width > alteredPixelSize.d_width * (1.0f + d_renderingCanvasMaxOverhead) ||
-                 size.d_height > alteredPixelSize.d_height * (1.0f + d_renderingCanvasMaxOverhead))
+
+        if (!d_renderOutputTexture)
         {
-            // this time the texture is too big, max overhead has been surpassed
-            renderer->destroyTexture(*d_renderOutputTexture);
-            d_renderOutputTexture = 0;
+            const Sizef allocationSize = d_canvasSizingPolicy.getAllocationSize(alteredPixelSize);
+
+            d_renderOutputTexture = &ChromeSystem::acquireCanvasTexture(alteredPixelSize,
+                allocationSize, d_canvasSizingPolicy.getMaximumSize(alteredPixelSize));
+            d_canvasSizingPolicy.notifyAllocated(allocationSize, d_renderOutputTexture->getSize());
         }
+
+        // the renderer is free to give us a bigger texture than we asked for
+        d_canvasTextureSize = d_renderOutputTexture->getSize();
     }
 
-    if (!d_renderOutputTexture)
+    // the shadow buffer has to match the texture (or the tile grid) exactly
+    const size_t canvasBufferSize = d_renderingCanvasShadowBufferEnabled ?
+        static_cast<size_t>(d_canvasTextureSize.d_width) * static_cast<size_t>(d_canvasTextureSize.d_height) * 4 : 0;
+
+    if (d_canvasBufferSize != canvasBufferSize || d_canvasTextureSize != oldTextureSize)
     {
-        const Sizef texSize = alteredPixelSize * (1.0f + d_renderingCanvasReserve);
-        d_renderOutputTexture = &renderer->createTexture(getName() + "/Texture", texSize);
+        uint8* oldCanvasBuffer = d_canvasBuffer;
+        const size_t oldCanvasBufferSize = d_canvasBufferSize;
+
+        d_canvasBuffer = 0;
+        d_canvasBufferSize = canvasBufferSize;
+
+        if (d_canvasBufferSize > 0)
+        {
+            d_canvasBuffer = CEGUI_NEW_ARRAY_PT(uint8, d_canvasBufferSize, AllocatorConfig<ChromeWidget>::Allocator);
+            // merged dirty areas can contain pixels Chrome hasn't painted yet
+            memset(d_canvasBuffer, 0, d_canvasBufferSize);
+
+            if (contentKept && oldCanvasBuffer)
+            {
+                // the tiles we kept still show this, the shadow buffer has to match them
+                const size_t oldPitch = static_cast<size_t>(oldTextureSize.d_width) * 4;
+                const size_t newPitch = static_cast<size_t>(d_canvasTextureSize.d_width) * 4;
+                const size_t rowSize = std::min(oldPitch, newPitch);
+                const size_t rows = static_cast<size_t>(std::min(oldTextureSize.d_height, d_canvasTextureSize.d_height));
+
+                for (size_t jj = 0; jj < rows; ++jj)
+                {
+                    memcpy(d_canvasBuffer + jj * newPitch, oldCanvasBuffer + jj * oldPitch, rowSize);
+                }
+            }
+        }
 
-        CEGUI_DELETE_ARRAY_PT(d_scrollBuffer, char, oldScrollBufferSize, AllocatorConfig<ChromeWidget>::Allocator);
-        // FIXME: Size<int>
-        d_scrollBuffer = CEGUI_NEW_ARRAY_PT(char, static_cast<unsigned int>(texSize.d_width * (texSize.d_height + 1) * 4), AllocatorConfig<ChromeWidget>::Allocator);
+        if (oldCanvasBuffer)
+        {
+            CEGUI_DELETE_ARRAY_PT(oldCanvasBuffer, uint8, oldCanvasBufferSize, AllocatorConfig<ChromeWidget>::Allocator);
+        }
     }
 
-    // 1, 1 to force a full redraw (we destroyed the old texture, so we lost all data)
-    d_chromeWindow->resize(1, 1);
+    // anything pending is obsolete, Chrome will repaint everything after the resize
+    d_canvasDirtyRegion.setBounds(d_canvasTextureSize);
+    d_canvasRingOffsetX = 0;
+    d_canvasRingOffsetY = 0;
+
+    if (!contentKept && restoreRenderingCanvas())
+    {
+        // whatever the old window painted would spoil the restored canvas
+        for (size_t i = 0; i < d_pendingPaintPackets.size(); ++i)
+        {
+            ChromeSystem::releasePaintPacket(d_pendingPaintPackets[i]);
+        }
+        d_pendingPaintPackets.clear();
+
+        if (d_freezeEnabled && d_interactionMode == IM_NoInteraction)
+        {
+            // the canvas is complete without Chrome, the widget stays frozen until Chrome is needed
+            if (d_chromeWindowCreated)
+            {
+                releaseChromeWindow();
+            }
+
+            d_frozen = true;
+        }
+        else
+        {
+            // the canvas is shown right away, but input still needs the page in Chrome
+            thaw();
+        }
+    }
+    else
+    {
+        // the frozen canvas doesn't fit anymore, Chrome has to paint it again
+        thaw();
+    }
 
     // I do floor(..) to ensure we never ever overflow our target texture
-    d_chromeWindow->resize(floor(alteredPixelSize.d_width),
-                           floor(alteredPixelSize.d_height));
+    const int canvasWidth = static_cast<int>(floor(alteredPixelSize.d_width));
+    const int canvasHeight = static_cast<int>(floor(alteredPixelSize.d_height));
+
+    BerkeliumDelegate* delegate = d_berkeliumDelegate;
+    executeChromeTask([delegate, canvasWidth, canvasHeight, contentKept]()
+        {
+            if (!contentKept)
+            {
+                // 1, 1 to force a full redraw (we destroyed the old texture, so we lost all data)
+                delegate->resize(1, 1);
+            }
+
+            delegate->resize(canvasWidth, canvasHeight);
+        });
 
     invalidate();
 
@@ -604,85 +2978,220 @@ void ChromeWidget::resizeRenderingCanvas()
     d_renderingResizeNeeded = false;
 }
 
-void ChromeWidget::base64_encode(String& ret, uint8 const* bytes_to_encode, size_t in_len)
+void ChromeWidget::resizeCanvasTiles(const Sizef& canvasSize)
 {
-/* 
-    base64.cpp and base64.h
-
-    Copyright (C) 2004-2008 Ren Nyffenegger
+    const size_t columns = canvasSize.d_width > 0 && canvasSize.d_height > 0 ?
+        std::max<size_t>(1, static_cast<size_t>(ceil(canvasSize.d_width / CanvasTileSize))) : 0;
+    const size_t rows = columns > 0 ?
+        std::max<size_t>(1, static_cast<size_t>(ceil(canvasSize.d_height / CanvasTileSize))) : 0;
 
-    This source code is provided 'as-is', without any express or implied
-    warranty. In no event will the author be held liable for any damages
-    arising from the use of this software.
-
-    Permission is granted to anyone to use this software for any purpose,
-    including commercial applications, and to alter it and redistribute it
-    freely, subject to the following restrictions:
+    if (columns == d_canvasTileColumns && rows == d_canvasTileRows)
+    {
+        return;
+    }
 
-    1. The origin of this source code must not be misrepresented; you must not
-        claim that you wrote the original source code. If you use this source code
-        in a product, an acknowledgment in the product documentation would be
-        appreciated but is not required.
+    const Sizef tileSize(static_cast<float>(CanvasTileSize), static_cast<float>(CanvasTileSize));
+    TileList tiles(columns * rows, static_cast<Texture*>(0));
 
-    2. Altered source versions must be plainly marked as such, and must not be
-        misrepresented as being the original source code.
+    // keep the tiles that are still in the grid, only the edges change
+    for (size_t row = 0; row < d_canvasTileRows; ++row)
+    {
+        for (size_t column = 0; column < d_canvasTileColumns; ++column)
+        {
+            Texture* tile = d_canvasTiles[row * d_canvasTileColumns + column];
 
-    3. This notice may not be removed or altered from any source distribution.
+            if (row < rows && column < columns)
+            {
+                tiles[row * columns + column] = tile;
+            }
+            else
+            {
+                ChromeSystem::releaseCanvasTexture(*tile);
+            }
+        }
+    }
 
-    Ren Nyffenegger rene.nyffenegger@adp-gmbh.ch
+    for (size_t row = 0; row < rows; ++row)
+    {
+        for (size_t column = 0; column < columns; ++column)
+        {
+            if (!tiles[row * columns + column])
+            {
+                tiles[row * columns + column] = &ChromeSystem::acquireCanvasTexture(tileSize, tileSize, tileSize);
+            }
+        }
+    }
 
-    With very minor changes by Martin Preisler
-*/
+    d_canvasTiles.swap(tiles);
+    d_canvasTileColumns = columns;
+    d_canvasTileRows = rows;
+}
 
-    static const String base64_chars("ABCDEFGHIJKLMNOPQRSTUVWXYZ"
-                                     "abcdefghijklmnopqrstuvwxyz"
-                                     "0123456789+/");
+void ChromeWidget::uploadTextureRect(const uint8* source, size_t sourcePitch, const Rectf& area)
+{
+    const int bytesPerPixel = 4;
 
-    // we don't clear since we want the headers to stay in ret
-    //ret.clear();
-    // the size will definitely be at least size of the data,
-    // furthermore we are aiming for the average case overhead
-    // which is 37%
-    ret.reserve(static_cast<String::size_type>(ceil(in_len * 1.37f)));
+    if (d_canvasTiles.empty())
+    {
+        ChromeSystem::getTextureUploader().blitFromMemory(*d_renderOutputTexture, source, sourcePitch, area);
+        return;
+    }
 
-    int i = 0;
-    int j = 0;
-    unsigned char char_array_3[3];
-    unsigned char char_array_4[4];
+    // the area can span several tiles, each gets its part
+    const size_t firstColumn = static_cast<size_t>(area.left()) / CanvasTileSize;
+    const size_t firstRow = static_cast<size_t>(area.top()) / CanvasTileSize;
+    const size_t lastColumn = std::min(static_cast<size_t>(area.right() - 1) / CanvasTileSize, d_canvasTileColumns - 1);
+    const size_t lastRow = std::min(static_cast<size_t>(area.bottom() - 1) / CanvasTileSize, d_canvasTileRows - 1);
 
-    while (in_len--)
+    for (size_t row = firstRow; row <= lastRow; ++row)
     {
-        char_array_3[i++] = *(bytes_to_encode++);
-        if (i == 3)
+        for (size_t column = firstColumn; column <= lastColumn; ++column)
         {
-            char_array_4[0] = (char_array_3[0] & 0xfc) >> 2;
-            char_array_4[1] = ((char_array_3[0] & 0x03) << 4) + ((char_array_3[1] & 0xf0) >> 4);
-            char_array_4[2] = ((char_array_3[1] & 0x0f) << 2) + ((char_array_3[2] & 0xc0) >> 6);
-            char_array_4[3] = char_array_3[2] & 0x3f;
+            const float tileLeft = static_cast<float>(column * CanvasTileSize);
+            const float tileTop = static_cast<float>(row * CanvasTileSize);
+
+            const Rectf piece(
+                std::max(area.left(), tileLeft),
+                std::max(area.top(), tileTop),
+                std::min(area.right(), tileLeft + CanvasTileSize),
+                std::min(area.bottom(), tileTop + CanvasTileSize));
+
+            if (piece.getWidth() <= 0 || piece.getHeight() <= 0)
+            {
+                continue;
+            }
 
-            for(i = 0; (i <4) ; i++)
-                ret += base64_chars[char_array_4[i]];
+            const uint8* pieceSource = source +
+                static_cast<size_t>(piece.top() - area.top()) * sourcePitch +
+                static_cast<size_t>(piece.left() - area.left()) * bytesPerPixel;
 
-            i = 0;
+            ChromeSystem::getTextureUploader().blitFromMemory(*d_canvasTiles[row * d_canvasTileColumns + column],
+                pieceSource, sourcePitch,
+                Rectf(piece.left() - tileLeft, piece.top() - tileTop, piece.right() - tileLeft, piece.bottom() - tileTop));
         }
     }
+}
+
+const char* ChromeWidget::buildDataURI(const char* header, const uint8* data, size_t size, size_t& length)
+{
+    const size_t headerLength = strlen(header);
+    length = headerLength + ChromeBase64::getEncodedSize(size);
+
+    // the URI only lives until it's handed to navigateTo, which copies it
+    char* ret = reinterpret_cast<char*>(ChromeSystem::getStagingArena().acquire(length));
+    memcpy(ret, header, headerLength);
+    ChromeBase64::encode(ret + headerLength, data, size);
+
+    return ret;
+}
+
+void ChromeWidget::navigateToResource(const String& filename, const String& resourceGroup, const char* mimeType)
+{
+    std::string url;
+    if (!mimeType && ChromeSystem::getResourceFileURL(filename, resourceGroup, url))
+    {
+        // Chrome streams the file itself and resolves relative links against it
+        navigateTo(url.c_str(), url.size());
+        return;
+    }
+
+    const std::string header(std::string("data:") +
+        (mimeType ? mimeType : ChromeSystem::getMimeType(filename)) + ";base64,");
+
+    // an unchanged file doesn't even have to be read again
+    ChromeSystem::PayloadHash hash;
+    if (ChromeSystem::findResourcePayloadHash(filename, resourceGroup, header.c_str(), hash) &&
+        navigateToCachedPayload(hash))
+    {
+        return;
+    }
+
+    RawDataContainer file;
+    System::getSingleton().getResourceProvider()->
+        loadRawDataContainer(filename, file, resourceGroup);
+
+    navigateToData(header.c_str(), file.getDataPtr(), file.getSize());
+
+    System::getSingleton().getResourceProvider()->
+        unloadRawDataContainer(file);
+
+    if (d_payloadHash != 0)
+    {
+        ChromeSystem::storeResourcePayloadHash(filename, resourceGroup, header.c_str(), d_payloadHash);
+    }
+}
+
+bool ChromeWidget::navigateToCachedPayload(ChromeSystem::PayloadHash hash)
+{
+    uint serial;
+    const std::string* payload = ChromeSystem::findPayload(hash, serial);
+    if (!payload)
+    {
+        return false;
+    }
+
+    navigateToPayload(hash, serial, *payload);
+
+    return true;
+}
+
+void ChromeWidget::navigateToPayload(ChromeSystem::PayloadHash hash, uint serial, const std::string& payload)
+{
+    if (hasPageNavigatedAway())
+    {
+        // the page moved on by itself, whatever we navigated to last isn't displayed anymore
+        d_payloadHash = 0;
+        d_payloadSerial = 0;
+    }
+
+    // the serial tells whether this is still the very payload the widget navigated to
+    if (serial == d_payloadSerial)
+    {
+        return;
+    }
+
+    navigateTo(payload.data(), payload.size());
+    d_payloadHash = hash;
+    d_payloadSerial = serial;
+}
 
-    if (i)
+void ChromeWidget::navigateToData(const char* header, const uint8* data, size_t size)
+{
+    if (ChromeSystem::getPayloadCacheCapacity() > 0)
     {
-        for(j = i; j < 3; j++)
-            char_array_3[j] = '\0';
+        const ChromeSystem::PayloadHash hash = ChromeSystem::hashPayload(header, data, size);
+
+        uint serial;
+        const std::string* cached = ChromeSystem::findPayload(hash, header, data, size, serial);
+        if (cached)
+        {
+            navigateToPayload(hash, serial, *cached);
+            return;
+        }
 
-        char_array_4[0] = (char_array_3[0] & 0xfc) >> 2;
-        char_array_4[1] = ((char_array_3[0] & 0x03) << 4) + ((char_array_3[1] & 0xf0) >> 4);
-        char_array_4[2] = ((char_array_3[1] & 0x0f) << 2) + ((char_array_3[2] & 0xc0) >> 6);
-        char_array_4[3] = char_array_3[2] & 0x3f;
+        // encoded right into the string the cache keeps
+        const size_t headerLength = strlen(header);
+        std::string payload(headerLength + ChromeBase64::getEncodedSize(size), '\0');
+        memcpy(&payload[0], header, headerLength);
+        ChromeBase64::encode(&payload[headerLength], data, size);
 
-        for (j = 0; (j < i + 1); j++)
-            ret += base64_chars[char_array_4[j]];
+        cached = ChromeSystem::storePayload(hash, data, size, payload, serial);
+        if (cached)
+        {
+            navigateToPayload(hash, serial, *cached);
+        }
+        else
+        {
+            navigateTo(payload.data(), payload.size());
+        }
 
-        while((i++ < 3))
-            ret += '=';
+        return;
     }
+
+    size_t length;
+    const char* url = buildDataURI(header, data, size, length);
+
+    navigateTo(url, length);
 }
 
 }